@@ -927,7 +927,7 @@ void AlnRes::printQuals(
  * Add all of the cells involved in the given alignment to the database.
  */
 void RedundantAlns::add(const AlnRes& res) {
-	assert(!cells_.empty());
+	assert_gt(npos_, 0);
 	TRefOff left = res.refoff(), right;
 	const size_t len = res.readExtentRows();
         const size_t alignmentStart = res.trimmedLeft(true);
@@ -936,7 +936,7 @@ void RedundantAlns::add(const AlnRes& res) {
 	}
 	const EList<Edit>& ned = res.ned();
 	size_t nedidx = 0;
-	assert_leq(len, cells_.size());
+	assert_leq(len, npos_);
 	// For each row...
 	for(size_t i = alignmentStart; i < alignmentStart + len; i++) {
 		size_t diff = 1;  // amount to shift to right for next round
@@ -963,7 +963,7 @@ void RedundantAlns::add(const AlnRes& res) {
 		for(TRefOff j = left; j < right; j++) {
 			// Add to db
 			RedundantCell c(res.refid(), res.fw(), j, i);
-			ASSERT_ONLY(bool ret =) cells_[i].insert(c);
+			ASSERT_ONLY(bool ret =) cells_.insert(c);
 			assert(ret);
 		}
 		left = right + diff - 1;
@@ -978,7 +978,7 @@ void RedundantAlns::add(const AlnRes& res) {
  * one of the cells in the database.
  */
 bool RedundantAlns::overlap(const AlnRes& res) {
-	assert(!cells_.empty());
+	assert_gt(npos_, 0);
 	TRefOff left = res.refoff(), right;
 	const size_t len = res.readExtentRows();
         const size_t alignmentStart = res.trimmedLeft(true);
@@ -989,7 +989,7 @@ bool RedundantAlns::overlap(const AlnRes& res) {
 	size_t nedidx = 0;
 	// For each row...
 	bool olap = false;
-	assert_leq(len, cells_.size());
+	assert_leq(len, npos_);
 	for(size_t i = alignmentStart; i < alignmentStart + len; i++) {
 		size_t diff = 1;  // amount to shift to right for next round
 		right = left + 1;
@@ -1015,7 +1015,7 @@ bool RedundantAlns::overlap(const AlnRes& res) {
 		for(TRefOff j = left; j < right; j++) {
 			// Add to db
 			RedundantCell c(res.refid(), res.fw(), j, i);
-			if(cells_[i].contains(c)) {
+			if(cells_.contains(c)) {
 				olap = true;
 				break;
 			}
@@ -36,6 +36,11 @@ typedef int64_t TAlScore;
 #define VALID_SCORE(x)      ((x) > MIN_I64)
 #define INVALIDATE_SCORE(x) ((x) = MIN_I64)
 
+// Initial capacity of an AlnRes's edit lists.  Most alignments have only a
+// few edits, and -k/-a runs keep many AlnRes objects live at once, so start
+// small and let the lists grow as needed.
+#define RES_EDITS_INIT 16
+
 /**
  * A generic score object for an alignment.  Used for accounting during
  * SW and elsewhere.  Encapsulates the score, the number of N positions
@@ -796,8 +801,8 @@ class AlnRes {
 public:
 
 	AlnRes() :
-		ned_(RES_CAT),
-		aed_(RES_CAT)
+		ned_(RES_EDITS_INIT, RES_CAT),
+		aed_(RES_EDITS_INIT, RES_CAT)
 	{
 		reset();
 	}
@@ -806,6 +811,19 @@ public:
 	 * Clear all contents.
 	 */
 	void reset();
+
+	/**
+	 * Take over the contents of o, including its edit buffers, without
+	 * copying the edits.  o is left with empty edit lists.
+	 */
+	void xfer(AlnRes& o) {
+		EList<Edit> ned(RES_CAT), aed(RES_CAT);
+		ned.xfer(o.ned_);
+		aed.xfer(o.aed_);
+		*this = o; // edit lists are empty now, so this is cheap
+		ned_.xfer(ned);
+		aed_.xfer(aed);
+	}
 	
 	/**
 	 * Reverse all edit lists.
@@ -1411,7 +1429,19 @@ public:
 	 * Return the number of reference Ns covered by the alignment.
 	 */
 	size_t refNs() const { return refns_; }
-	
+
+	/**
+	 * Add off to the id of the reference sequence aligned to, translating
+	 * an id local to one index of an index set into an id in the set's
+	 * combined list of references.
+	 */
+	void shiftRefId(TRefId off) {
+		refcoord_.setRef(refcoord_.ref() + off);
+		Coord up = refival_.upstream();
+		up.setRef(up.ref() + off);
+		refival_.setUpstream(up);
+	}
+
 	/**
 	 * Clip away portions of the alignment that are outside the given bounds.
 	 * Clipping is soft if soft == true, hard otherwise.
@@ -1549,6 +1579,15 @@ protected:
 	size_t      trim3p_;       // # bases trimmed from 3p end by local alignment
 };
 
+/**
+ * Let EList move AlnRes objects with xfer() when it expands, rather than
+ * copying their edit lists.
+ */
+template<>
+struct HasXfer<AlnRes> {
+	enum { value = true };
+};
+
 /**
  * Unique ID for a cell in the overall DP table.  This is a helpful concept
  * because of our definition of "redundnant".  Two alignments are redundant iff
@@ -1622,6 +1661,16 @@ struct RedundantCell {
 			rdoff == c.rdoff;
 	}
 
+	/**
+	 * Return a hash of this cell for use with EHashSet.
+	 */
+	inline uint64_t hash() const {
+		uint64_t h = (uint64_t)rfoff;
+		h = h * 0x100000001B3llu + (uint64_t)rfid;
+		h = h * 0x100000001B3llu + (uint64_t)rdoff;
+		return (h << 1) | (fw ? 1 : 0);
+	}
+
 	TRefId  rfid;  // reference id
 	bool    fw;    // orientation
 	TRefOff rfoff; // column
@@ -1634,28 +1683,27 @@ struct RedundantCell {
  * of others.
  *
  * Adding cells to and checking cell against this data structure can get rather
- * slow when there are many alignments in play.  Dividing the burden over
- * read-position bins helps some.
+ * slow when there are many alignments in play (e.g. -k 200 or -a), so cells
+ * are kept in a hash set rather than in sorted per-read-position lists.
+ * Clearing between reads is O(1).
  */
 class RedundantAlns {
 
 public:
 
-	RedundantAlns(int cat = DP_CAT) : cells_(cat) { }
+	RedundantAlns(int cat = DP_CAT) : cells_(cat), npos_(0) { }
 
 	/**
 	 * Empty the cell database.
 	 */
-	void reset() { cells_.clear(); }
+	void reset() { cells_.clear(); npos_ = 0; }
 	
 	/**
-	 * Initialize and set the list of sets to equal the read length.
+	 * Initialize for a read with the given number of positions.
 	 */
 	void init(size_t npos) {
-		cells_.resize(npos);
-		for(size_t i = 0; i < npos; i++) {
-			cells_[i].clear();
-		}
+		cells_.clear();
+		npos_ = npos;
 	}
 
 	/**
@@ -1671,7 +1719,8 @@ public:
 
 protected:
 
-	EList<ESet<RedundantCell> > cells_;
+	EHashSet<RedundantCell> cells_; // all cells used by alignments so far
+	size_t                  npos_;  // # read positions
 };
 
 typedef uint64_t TNumAlns;
@@ -21,6 +21,7 @@
 #include "aligner_seed.h"
 #include "search_globals.h"
 #include "bt2_idx.h"
+#include "ftab2.h"
 
 using namespace std;
 
@@ -366,6 +367,49 @@ SeedAligner::instantiateSeq(
 	}
 }
 
+/**
+ * Return the offset in [0, per) at which to start extracting seeds of
+ * length len from the read so that as many seeds as possible are free of
+ * Ns and, among those offsets, the seeds' lowest qualities add up to as
+ * much as possible.  Only offsets that leave room for the first seed are
+ * considered; ties go to the smallest offset.
+ */
+size_t SeedAligner::adaptiveSeedOffset(
+	const Read& read, // read to align
+	int len,          // seed length
+	int per)          // interval between seeds
+{
+	const int rdlen = (int)read.length();
+	if(rdlen <= len || per <= 1) {
+		return 0;
+	}
+	const int maxoff = min<int>(per - 1, rdlen - len);
+	size_t bestOff = 0, bestFree = 0, bestQual = 0;
+	for(int off = 0; off <= maxoff; off++) {
+		size_t nfree = 0, qsum = 0;
+		for(int d = off; d + len <= rdlen; d += per) {
+			int minq = std::numeric_limits<int>::max();
+			for(int i = d; i < d + len; i++) {
+				if((int)read.patFw[i] > 3) {
+					minq = -1;
+					break;
+				}
+				minq = min<int>(minq, (int)read.qual[i] - 33);
+			}
+			if(minq >= 0) {
+				nfree++;
+				qsum += (size_t)minq;
+			}
+		}
+		if(off == 0 || nfree > bestFree || (nfree == bestFree && qsum > bestQual)) {
+			bestOff = (size_t)off;
+			bestFree = nfree;
+			bestQual = qsum;
+		}
+	}
+	return bestOff;
+}
+
 /**
  * We assume that all seeds are the same length.
  *
@@ -575,6 +619,186 @@ void SeedAligner::searchAllSeeds(
 	met.bweds += bwedits_;
 }
 
+/**
+ * Seed the read with maximal exact matches rather than fixed-length seeds.
+ * On each strand we walk leftward from the 3' end: from end position e we
+ * extend leftward through the forward index, using mapBiLFEx to keep the
+ * mirror-index range in step, until the match can't be extended, reaches
+ * 32 bp or reaches the 5' end.  The next match ends just before the
+ * character that stopped this one (or right where it started, if it hit
+ * the length cap), so seeds tile the read and an error ends a seed rather
+ * than spoiling one.  Matches shorter than minlen are dropped, as are
+ * matches occurring more than maxocc times, unless all of them do (e.g.
+ * the read lies in a repeat longer than 32 bp with more than maxocc
+ * copies); then the least frequent ones are kept so the read still gets
+ * seed hits to extend.
+ *
+ * Seeds are installed in 'sr' as if instantiated at their own offsets, one
+ * offset per seed, so that SwDriver can extend them like any other seeds.
+ */
+size_t SeedAligner::searchSmems(
+	const Ebwt* ebwtFw,          // BWT index
+	const Ebwt* ebwtBw,          // BWT' index
+	const Read& read,            // read to align
+	int minlen,                  // minimum seed length
+	size_t maxocc,               // max # occurrences for a seed
+	bool nofw,                   // don't align forward read
+	bool norc,                   // don't align revcomp read
+	AlignmentCacheIface& cache,  // local seed alignment cache
+	SeedResults& sr,             // holds all the seed hits
+	SeedSearchMetrics& met,      // metrics
+	PerReadMetrics& prm)         // per-read metrics
+{
+	assert(ebwtFw != NULL);
+	assert(ebwtFw->isInMemory());
+	const size_t maxlen = 32; // longest cacheable key
+	const size_t rdlen = read.length();
+	bwops_ = 0;
+	smems_.clear();
+	offIdx2off_.clear();
+	TIndexOffU t[4], b[4], tp[4], bp[4];
+	SideLocus tloc, bloc;
+	for(int fwi = 0; fwi < 2; fwi++) {
+		bool fw = (fwi == 0);
+		if((fw && nofw) || (!fw && norc)) {
+			continue;
+		}
+		const BTDnaString& seq = fw ? read.patFw : read.patRc;
+		size_t e = rdlen;
+		while(e >= (size_t)minlen && e > 0) {
+			int c = seq[e-1];
+			if(c > 3) {
+				e--;
+				continue;
+			}
+			TIndexOffU top = ebwtFw->fchr()[c], bot = ebwtFw->fchr()[c+1];
+			TIndexOffU topb = top, botb = bot;
+			if(bot <= top) {
+				e--;
+				continue;
+			}
+			bool stale = false; // mirror range not tracked past a 1-elt range
+			size_t st = e - 1;
+			INIT_LOCS(top, bot, tloc, bloc, *ebwtFw);
+			while(st > 0 && e - st < maxlen) {
+				int rdc = seq[st-1];
+				if(rdc > 3) {
+					break;
+				}
+				bwops_++;
+				if(bloc.valid()) {
+					t[0] = t[1] = t[2] = t[3] = b[0] = b[1] = b[2] = b[3] = 0;
+					tp[0] = tp[1] = tp[2] = tp[3] = topb;
+					bp[0] = bp[1] = bp[2] = bp[3] = botb;
+					ebwtFw->mapBiLFEx(tloc, bloc, t, b, tp, bp);
+					SANITY_CHECK_4TUP(t, b, tp, bp);
+					if(b[rdc] <= t[rdc]) {
+						break;
+					}
+					top = t[rdc]; bot = b[rdc];
+					topb = tp[rdc]; botb = bp[rdc];
+				} else {
+					TIndexOffU ntop = ebwtFw->mapLF1(top, tloc, rdc);
+					if(ntop == OFF_MASK) {
+						break;
+					}
+					top = ntop; bot = top + 1;
+					stale = true;
+				}
+				st--;
+				INIT_LOCS(top, bot, tloc, bloc, *ebwtFw);
+			}
+			size_t len = e - st;
+			if(len >= (size_t)minlen) {
+				if(stale) {
+					// Look the reversed match up in the mirror index
+					topb = botb = 0;
+					if(ebwtBw != NULL) {
+						tmpdnastr_.clear();
+						for(size_t i = e; i > st; i--) {
+							tmpdnastr_.append(seq[i-1]);
+						}
+						ebwtBw->contains(tmpdnastr_, &topb, &botb);
+						bwops_ += len;
+					}
+				}
+				smems_.expand();
+				SmemSeed& sm = smems_.back();
+				sm.fw = fw;
+				sm.depth = (uint32_t)(fw ? st : rdlen - e);
+				sm.len = (uint32_t)len;
+				sm.topf = top; sm.botf = bot;
+				sm.topb = topb; sm.botb = botb;
+				offIdx2off_.push_back(sm.depth);
+			}
+			if(st == 0) {
+				break;
+			}
+			// Skip the character that stopped us, unless the cap did
+			e = (len >= maxlen) ? st : st - 1;
+		}
+	}
+	prm.nSdFmops += bwops_;
+	met.bwops += bwops_;
+	if(smems_.empty()) {
+		return 0;
+	}
+	// Drop matches occurring more than maxocc times, or, if they all do,
+	// all but the least frequent
+	size_t minocc = std::numeric_limits<size_t>::max();
+	for(size_t i = 0; i < smems_.size(); i++) {
+		minocc = min<size_t>(minocc, (size_t)(smems_[i].botf - smems_[i].topf));
+	}
+	const size_t occlim = max<size_t>(maxocc, minocc);
+	size_t nkept = 0;
+	for(size_t i = 0; i < smems_.size(); i++) {
+		if((size_t)(smems_[i].botf - smems_[i].topf) <= occlim) {
+			smems_[nkept] = smems_[i];
+			offIdx2off_[nkept] = offIdx2off_[i];
+			nkept++;
+		}
+	}
+	smems_.resize(nkept);
+	offIdx2off_.resize(nkept);
+	sr.reset(read, offIdx2off_, smems_.size());
+	size_t ooms = 0;
+	for(size_t i = 0; i < smems_.size(); i++) {
+		const SmemSeed& sm = smems_[i];
+		BTDnaString& sseq = sr.seqs(sm.fw)[i];
+		BTString& squal = sr.quals(sm.fw)[i];
+		instantiateSeq(read, sseq, squal, (int)sm.len, (int)sm.depth, sm.fw);
+		QVal qv;
+		int ret = cache.beginAlign(sseq, squal, qv);
+		if(ret == -1) {
+			ooms++;
+			continue;
+		}
+		if(ret == 0) {
+			if(!cache.addOnTheFly(sseq, sm.topf, sm.botf, sm.topb, sm.botb)) {
+				ooms++;
+			}
+			qv = cache.finishAlign();
+		}
+		met.seedsearch++;
+		if(qv.valid()) {
+			sr.add(qv, cache.current(), (uint32_t)i, sm.fw);
+		}
+	}
+	prm.nSeedRanges = sr.numRanges();
+	prm.nSeedElts = sr.numElts();
+	prm.nSeedRangesFw = sr.numRangesFw();
+	prm.nSeedRangesRc = sr.numRangesRc();
+	prm.nSeedEltsFw = sr.numEltsFw();
+	prm.nSeedEltsRc = sr.numEltsRc();
+	prm.seedMedian = (uint64_t)(sr.medianHitsPerSeed() + 0.5);
+	prm.seedMean = (uint64_t)sr.averageHitsPerSeed();
+	met.possearch += smems_.size();
+	met.nrange += sr.numRanges();
+	met.nelt += sr.numElts();
+	met.ooms += ooms;
+	return smems_.size();
+}
+
 bool SeedAligner::sanityPartial(
 	const Ebwt*        ebwtFw, // BWT index
 	const Ebwt*        ebwtBw, // BWT' index
@@ -636,6 +860,7 @@ size_t SeedAligner::exactSweep(
 		const BTDnaString& seq = fw ? read.patFw : read.patRc;
 		assert(!seq.empty());
 		int ftabLen = ebwt.eh().ftabChars();
+		const Ftab2* ftab2 = ebwt.ftab2();
 		size_t dep = 0;
 		size_t nedit = 0;
 		bool done = false;
@@ -643,7 +868,10 @@ size_t SeedAligner::exactSweep(
 			top = bot = 0;
 			size_t left = len - dep;
 			assert_gt(left, 0);
-			bool doFtab = ftabLen > 1 && left >= (size_t)ftabLen;
+			// Jump further with the second-level ftab if the bucket has one
+			bool doFtab2 = ftab2 != NULL && left >= (size_t)ftab2->chars() &&
+				ftab2->loHi(ebwt, seq, len - dep - ftab2->chars(), top, bot);
+			bool doFtab = !doFtab2 && ftabLen > 1 && left >= (size_t)ftabLen;
 			if(doFtab) {
 				// Does N interfere with use of Ftab?
 				for(size_t i = 0; i < (size_t)ftabLen; i++) {
@@ -654,7 +882,10 @@ size_t SeedAligner::exactSweep(
 					}
 				}
 			}
-			if(doFtab) {
+			if(doFtab2) {
+				// Used second-level ftab
+				dep += (size_t)ftab2->chars();
+			} else if(doFtab) {
 				// Use ftab
 				ebwt.ftabLoHi(seq, len - dep - ftabLen, false, top, bot);
 				dep += (size_t)ftabLen;
@@ -1432,9 +1663,23 @@ SeedAligner::searchSeedBi(
 		off = s.steps[0];
 		bool ltr = off > 0;
 		off = abs(off)-1;
-		// Check whether/how far we can jump using ftab or fchr
+		// Check whether/how far we can jump using the second-level ftab,
+		// ftab or fchr.  The second level must have split the bucket in
+		// both indexes.
 		int ftabLen = ebwtFw_->eh().ftabChars();
-		if(ftabLen > 1 && ftabLen <= s.maxjump) {
+		const Ftab2* ftab2f = ebwtFw_->ftab2();
+		const Ftab2* ftab2b = ebwtBw_ != NULL ? ebwtBw_->ftab2() : NULL;
+		int ftab2Len = ftab2f != NULL ? ftab2f->chars() : 0;
+		int off2 = ltr ? off : off - ftab2Len + 1;
+		if(ftab2f != NULL && ftab2b != NULL && ftab2Len <= s.maxjump &&
+		   ftab2Len == ftab2b->chars() &&
+		   ftab2f->loHi(*ebwtFw_, *seq_, off2, topf, botf) &&
+		   ftab2b->loHi(*ebwtBw_, *seq_, off2, topb, botb))
+		{
+			assert_eq(botf-topf, botb-topb);
+			if(botf - topf == 0) return true;
+			step += ftab2Len;
+		} else if(ftabLen > 1 && ftabLen <= s.maxjump) {
 			if(!ltr) {
 				assert_geq(off+1, ftabLen-1);
 				off = off - ftabLen + 1;
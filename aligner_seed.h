@@ -947,6 +947,27 @@ public:
 	 * Return the number of different seed offsets possible.
 	 */
 	size_t numOffs() const { return numOffs_; }
+
+	/**
+	 * Return the size of the largest set of non-overlapping seed offsets,
+	 * for seeds of length len, at which a seed was instantiated on every
+	 * strand searched.  An alignment that none of the seeds found must
+	 * have an edit in each of these seeds.
+	 */
+	size_t numDisjointSeeds(int len, bool nofw, bool norc) const {
+		size_t n = 0;
+		uint32_t end = 0;
+		for(size_t i = 0; i < numOffs_; i++) {
+			if((!nofw && isFw_[i].empty()) || (!norc && isRc_[i].empty())) {
+				continue;
+			}
+			if(n == 0 || offIdx2off_[i] >= end) {
+				n++;
+				end = offIdx2off_[i] + (uint32_t)len;
+			}
+		}
+		return n;
+	}
 	
 	/**
 	 * Return the read from which seeds were extracted, aligned.
@@ -1368,6 +1389,20 @@ protected:
 class Ebwt;
 struct SideLocus;
 
+/**
+ * An exact-match seed of variable length found by searchSmems(), along with
+ * its BW ranges in both indexes.
+ */
+struct SmemSeed {
+	bool       fw;    // from the forward read?
+	uint32_t   depth; // offset of the seed's window from 5' end of fw read
+	uint32_t   len;   // length of the match
+	TIndexOffU topf;  // top in BWT
+	TIndexOffU botf;  // bot in BWT
+	TIndexOffU topb;  // top in BWT'
+	TIndexOffU botb;  // bot in BWT'
+};
+
 /**
  * Encapsulates a sumamry of what the searchAllSeeds aligner did.
  */
@@ -1444,7 +1479,7 @@ public:
 	/**
 	 * Initialize with index.
 	 */
-	SeedAligner() : edits_(AL_CAT), offIdx2off_(AL_CAT) { }
+	SeedAligner() : edits_(AL_CAT), offIdx2off_(AL_CAT), smems_(AL_CAT) { }
 
 	/**
 	 * Given a read and a few coordinates that describe a substring of the
@@ -1459,6 +1494,17 @@ public:
 		int depth,        // seed's 0-based offset from 5' end
 		bool fw) const;   // seed's orientation
 
+	/**
+	 * Return the offset in [0, per) at which to start extracting seeds of
+	 * length len from the read so that as many seeds as possible are free
+	 * of Ns and, among those offsets, the seeds' lowest qualities add up
+	 * to as much as possible.
+	 */
+	static size_t adaptiveSeedOffset(
+		const Read& read, // read to align
+		int len,          // seed length
+		int per);         // interval between seeds
+
 	/**
 	 * Iterate through the seeds that cover the read and initiate a
 	 * search for each seed.
@@ -1490,6 +1536,27 @@ public:
 		SeedSearchMetrics& met,     // metrics
 		PerReadMetrics& prm);       // per-read metrics
 
+	/**
+	 * Seed the read with maximal exact matches rather than fixed-length
+	 * seeds, walking leftward from the 3' end of each strand.  Each seed is
+	 * the longest exact match ending at its position, up to 32 bp (the
+	 * longest key the seed cache can hold); matches shorter than minlen or
+	 * occurring more than maxocc times are dropped.  Seeds and their hits
+	 * are installed in 'sr'.  Returns the number of seeds.
+	 */
+	size_t searchSmems(
+		const Ebwt* ebwtFw,         // BWT index
+		const Ebwt* ebwtBw,         // BWT' index
+		const Read& read,           // read to align
+		int minlen,                 // minimum seed length
+		size_t maxocc,              // max # occurrences for a seed
+		bool nofw,                  // don't align forward read
+		bool norc,                  // don't align revcomp read
+		AlignmentCacheIface& cache, // local seed alignment cache
+		SeedResults& sr,            // holds all the seed hits
+		SeedSearchMetrics& met,     // metrics
+		PerReadMetrics& prm);       // per-read metrics
+
 	/**
 	 * Sanity-check a partial alignment produced during oneMmSearch.
 	 */
@@ -1621,6 +1688,7 @@ protected:
 	EList<Edit> edits_;        // temporary place to sort edits
 	AlignmentCacheIface *ca_;  // local alignment cache for seed alignments
 	EList<uint32_t> offIdx2off_;// offset idx to read offset map, set up instantiateSeeds()
+	EList<SmemSeed> smems_;    // seeds found by searchSmems()
 	uint64_t bwops_;           // Burrows-Wheeler operations
 	uint64_t bwedits_;         // Burrows-Wheeler edits
 	BTDnaString tmprfdnastr_;  // used in reportHit
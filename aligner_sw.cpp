@@ -58,6 +58,8 @@ void SwAligner::initRead(
 	sseI16fwBuilt_ = false;  // built fw query profile, 16-bit score
 	sseI16rcBuilt_ = false;  // built rc query profile, 16-bit score
 #endif
+	bpFwBuilt_ = false;      // built fw bit-parallel match masks
+	bpRcBuilt_ = false;      // built rc bit-parallel match masks
 	if(dpLog_ != NULL) {
 		if(!firstRead_) {
 			(*dpLog_) << '\n';
@@ -491,6 +493,160 @@ int SwAligner::ungappedAlign(
 	return 1;
 }
 
+/**
+ * Build the per-character match bitmasks used by bitParallelFilter().  Read
+ * Ns are treated as wildcards, which can only make the computed edit distance
+ * smaller.  Also determine the smallest penalty that any single edit (a
+ * mismatch at one of this read's positions or one character of a gap) can
+ * incur.
+ */
+void SwAligner::buildBitParallelPeq(bool fw) {
+	const BTDnaString& rd = fw ? *rdfw_ : *rdrc_;
+	const BTString&    qu = fw ? *qufw_ : *qurc_;
+	EList<uint64_t>&  peq = fw ? bpPeqFw_ : bpPeqRc_;
+	const size_t rdlen = rdf_ - rdi_;
+	const size_t nwords = (rdlen + 63) >> 6;
+	peq.resize(nwords * 4);
+	peq.fillZero();
+	int minpen = min(sc_->readGapExtend(), sc_->refGapExtend());
+	for(size_t i = 0; i < rdlen; i++) {
+		int c = (int)rd[rdi_ + i];
+		uint64_t bit = ((uint64_t)1 << (i & 63));
+		size_t w = i >> 6;
+		if(c > 3) {
+			// N matches everything
+			for(size_t j = 0; j < 4; j++) {
+				peq[j * nwords + w] |= bit;
+			}
+		} else {
+			peq[c * nwords + w] |= bit;
+			minpen = min(minpen, sc_->mm(c, (int)qu[rdi_ + i] - 33));
+		}
+	}
+	bpMinPen_ = minpen;
+}
+
+/**
+ * Advance one 64-row block of the Myers bit-vector edit distance computation
+ * by one column.  'hin' is the horizontal delta entering the top of the block
+ * and the return value is the horizontal delta at row 'hbit' of the block.
+ */
+static inline int bpAdvanceBlock(
+	uint64_t& pv,   // in/out: +1 vertical deltas
+	uint64_t& mv,   // in/out: -1 vertical deltas
+	uint64_t  eq,   // match mask for this column's reference character
+	int       hin,  // horizontal delta coming in at the top
+	uint64_t  hbit) // row at which to measure outgoing horizontal delta
+{
+	uint64_t hinNeg = (hin < 0) ? 1 : 0;
+	uint64_t hinPos = (hin > 0) ? 1 : 0;
+	uint64_t xv = eq | mv;
+	eq |= hinNeg;
+	uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+	uint64_t ph = mv | ~(xh | pv);
+	uint64_t mh = pv & xh;
+	int hout = 0;
+	if((ph & hbit) != 0) hout = 1;
+	if((mh & hbit) != 0) hout = -1;
+	ph = (ph << 1) | hinPos;
+	mh = (mh << 1) | hinNeg;
+	pv = mh | ~(xv | ph);
+	mv = ph & xv;
+	return hout;
+}
+
+/**
+ * Compute the minimum edit distance between the read and any substring of the
+ * reference window set up by the last call to initRef(), using the
+ * bit-parallel algorithm of Myers (1999) with Ns as wildcards.  Every edit in
+ * an end-to-end alignment costs at least bpMinPen_, so if even the minimal
+ * number of edits puts the score below minsc_, there can be no valid
+ * alignment in the window and the DP fill can be skipped.
+ *
+ * Returns false iff no alignment in the window can score >= minsc_.
+ */
+bool SwAligner::bitParallelFilter() {
+	assert(initedRead() && initedRef());
+	if(!sc_->monotone) {
+		// Soft clipping makes the edit distance an unreliable bound
+		return true;
+	}
+	bool& built = fw_ ? bpFwBuilt_ : bpRcBuilt_;
+	if(!built) {
+		buildBitParallelPeq(fw_);
+		built = true;
+	}
+	if(bpMinPen_ <= 0) {
+		return true;
+	}
+	const size_t rdlen = rdf_ - rdi_;
+	const TAlScore perfect = sc_->perfectScore(rdlen);
+	assert_geq(perfect, minsc_);
+	const TAlScore maxEdits = (perfect - minsc_) / bpMinPen_;
+	if(maxEdits >= (TAlScore)rdlen) {
+		return true;
+	}
+	const size_t nwords = (rdlen + 63) >> 6;
+	const uint64_t *peq = (fw_ ? bpPeqFw_ : bpPeqRc_).ptr();
+	const uint64_t hibit = ((uint64_t)1 << 63);
+	const uint64_t lastbit = ((uint64_t)1 << ((rdlen - 1) & 63));
+	bpPv_.resize(nwords);
+	bpMv_.resize(nwords);
+	bpPv_.fill(~(uint64_t)0);
+	bpMv_.fillZero();
+	uint64_t *pv = bpPv_.ptr();
+	uint64_t *mv = bpMv_.ptr();
+	// Distance for the last row in the current column; the alignment may
+	// start in any column, so the top row is all 0s
+	TAlScore dist = (TAlScore)rdlen;
+	for(TRefOff j = rfi_; j < rff_; j++) {
+		int m = (int)rf_[j];
+		int h = 0;
+		for(size_t w = 0; w < nwords; w++) {
+			uint64_t eq = ~(uint64_t)0;
+			if(m <= 15) {
+				eq = 0;
+				if((m & 1) != 0) eq |= peq[w];
+				if((m & 2) != 0) eq |= peq[nwords + w];
+				if((m & 4) != 0) eq |= peq[2 * nwords + w];
+				if((m & 8) != 0) eq |= peq[3 * nwords + w];
+			}
+			h = bpAdvanceBlock(
+				pv[w],
+				mv[w],
+				eq,
+				h,
+				(w == nwords - 1) ? lastbit : hibit);
+		}
+		dist += h;
+		if(dist <= maxEdits) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * An end-to-end alignment must reach the bottom row by the last column, so
+ * a partial alignment at row r of column c has ncol-c-1 columns left in
+ * which to consume the remaining nrow-r-1 read characters.  Any excess has
+ * to be consumed by a reference gap, which costs at least refGapExtend()
+ * per character.  Return the first column at which even a new alignment,
+ * starting in row 0 just to its right, would need a gap costing more than
+ * the whole score budget; in column c past that point, only rows
+ * >= c - xdropcol can still reach the bottom row.
+ */
+size_t SwAligner::end2EndXdropCol() const {
+	assert(sc_->monotone);
+	const int64_t ncol = (int64_t)(rff_ - rfi_);
+	const int64_t nrow = (int64_t)dpRows();
+	const int64_t budget = max<int64_t>(-minsc_, 0);
+	assert_gt(sc_->refGapExtend(), 0);
+	// Shortest reference gap whose cost exceeds the budget
+	const int64_t kmin = budget / sc_->refGapExtend() + 1;
+	return (size_t)max<int64_t>(ncol - 1 - nrow + kmin, 0);
+}
+
 /**
  * Align read 'rd' to reference using read & reference information given
  * last time init() was called.
@@ -521,12 +677,21 @@ bool SwAligner::align(
 					gathered = true;
 				}
 			} else {
-				best = alignNucleotidesEnd2EndSseU8(flag, false);
+				// If the matrix is too big to stay in cache, try a
+				// score-only fill first and fill in the full matrix only if
+				// it finds a score that reaches minsc_
+				if(dpRows() * (size_t)(rff_ - rfi_) >= SCORE_ONLY_MIN_CELLS) {
+					best = alignNucleotidesEnd2EndSseU8(flag, false, true);
+				}
+				if(flag == 0) {
+					best = alignNucleotidesEnd2EndSseU8(flag, false, false);
+				}
 #ifndef NDEBUG
 				int flagtmp = 0;
 				TAlScore besttmp = alignGatherEE8(flagtmp, true); // debug
 				assert_eq(flagtmp, flag);
-				assert_eq(besttmp, best);
+				// X-drop may stop a failing fill before the gather kernel does
+				assert(flag != 0 || besttmp == best);
 #endif
 			}
 			sse8succ_ = (flag == 0);
@@ -557,7 +722,8 @@ bool SwAligner::align(
 				int flagtmp = 0;
 				TAlScore besttmp = alignGatherEE16(flagtmp, true);
 				assert_eq(flagtmp, flag);
-				assert_eq(besttmp, best);
+				// X-drop may stop a failing fill before the gather kernel does
+				assert(flag != 0 || besttmp == best);
 #endif
 			}
 			sse16succ_ = (flag == 0);
@@ -565,7 +731,14 @@ bool SwAligner::align(
 	} else {
 		// Local
 		flag = -2;
-		if(enable8_ && !readSse16_) {
+		// A local alignment scoring minsc_ or more can't fit in 8 bits, and
+		// once one window has saturated for this read, its other windows
+		// almost always do too.  Either way, go straight to 16 bits rather
+		// than filling the 8-bit matrix up to the saturating column first.
+		if(enable8_ && (readSse16_ || minsc_ >= 255)) {
+			SSEMetrics& met = extend_ ? sseU8ExtendMet_ : sseU8MateMet_;
+			met.dpskip++;
+		} else if(enable8_) {
 			// 8-bit local
 			if(checkpointed) {
 				best = alignGatherLoc8(flag, false);
@@ -581,6 +754,9 @@ bool SwAligner::align(
 				assert_eq(best, besttmp);
 #endif
 			}
+			if(flag == -2) {
+				readSse16_ = true;
+			}
 		}
 		if(flag == -2) {
 			// 16-bit local
@@ -3236,3 +3412,263 @@ int main(int argc, char **argv) {
 		seed);
 }
 #endif /*MAIN_ALIGNER_SW*/
+
+#ifdef MAIN_BP_FILTER
+
+#include "dp_framer.h"
+#include "random_source.h"
+
+int gGapBarrier;
+
+/**
+ * Frame a seed-extension DP problem for 'read' aligned at reference offset
+ * 'off' (assuming no gaps), the way SwDriver does, then run both the
+ * bit-parallel filter and the full DP.  Returns the filter's decision and
+ * sets 'aligned' to the DP's.  Exits with an error if the filter rejects a
+ * problem the DP finds a valid alignment for.
+ */
+static bool bpFilterCase(
+	SwAligner& sw,
+	const BTDnaString& read,
+	const BTString& qual,
+	const BTDnaString& ref,
+	int64_t off,
+	const Scoring& sc,
+	bool& aligned)
+{
+	BTDnaString readrc = read;
+	readrc.reverseComp();
+	BTString qualrc = qual;
+	qualrc.reverse();
+	const size_t rdlen = read.length();
+	const int64_t reflen = (int64_t)ref.length();
+	TAlScore minsc = sc.scoreMin.f<TAlScore>((double)rdlen);
+	int readGaps = sc.maxReadGaps(minsc, rdlen);
+	int refGaps = sc.maxRefGaps(minsc, rdlen);
+	int64_t nceil = sc.nCeil.f<int64_t>((double)rdlen);
+	DynProgFramer dpframe(false);
+	DPRect rect;
+	dpframe.frameSeedExtensionRect(
+		off, rdlen, reflen, (size_t)readGaps, (size_t)refGaps, nceil, 15, rect);
+	// Reference masks for the rectangle plus one char to the right; Ns off
+	// the ends, as in SwAligner::initRef()
+	EList<char> rf;
+	for(int64_t i = rect.refl; i <= rect.refr + 1; i++) {
+		int c = (i < 0 || i >= reflen) ? 4 : (int)ref[(size_t)i];
+		rf.push_back((char)(1 << c));
+	}
+	sw.initRead(read, readrc, qual, qualrc, 0, rdlen, sc);
+	sw.initRef(
+		true,            // fw
+		0,               // refidx
+		rect,            // DP rectangle
+		rf.ptr(),        // reference masks
+		0,               // first ref char
+		rf.size() - 1,   // last ref char (excl)
+		reflen,          // reference length
+		sc,              // scoring scheme
+		minsc,           // minimum score
+		true,            // use 8-bit SSE if possible
+		2000,            // checkpointing min length
+		4,               // checkpoint interval log2
+		false,           // triangular mini-fills
+		true);           // seed extension
+	bool pass = sw.bitParallelFilter();
+	TAlScore best = std::numeric_limits<TAlScore>::min();
+	aligned = sw.align(best);
+	if(aligned && !pass) {
+		cerr << "FAILED: filter rejected a problem with a valid alignment" << endl;
+		cerr << "  read: " << read.toZBuf() << endl;
+		throw 1;
+	}
+	return pass;
+}
+
+/**
+ * Return a random sequence of length 'len'.
+ */
+static void bpRandSeq(RandomSource& rnd, size_t len, BTDnaString& s) {
+	s.resize(len);
+	for(size_t i = 0; i < len; i++) {
+		s.set(rnd.nextU2(), i);
+	}
+}
+
+/**
+ * Copy 'len' chars of 'ref' starting at 'off' into 'read', then apply
+ * 'nmm' mismatches, and 'nins' inserted and 'ndel' deleted read
+ * characters, at random positions away from the ends.
+ */
+static void bpMutate(
+	RandomSource& rnd,
+	const BTDnaString& ref,
+	size_t off,
+	size_t len,
+	size_t nmm,
+	size_t nins,
+	size_t ndel,
+	BTDnaString& read)
+{
+	read.resize(len);
+	for(size_t i = 0; i < len; i++) {
+		read.set(ref[off + i], i);
+	}
+	EList<bool> mm;
+	mm.resize(len);
+	mm.fill(false);
+	assert_leq(nmm, len - 16);
+	for(size_t i = 0; i < nmm; i++) {
+		size_t p = 8 + rnd.nextU32() % (len - 16);
+		while(mm[p]) {
+			p = 8 + rnd.nextU32() % (len - 16);
+		}
+		mm[p] = true;
+		read.set((read[p] + 1 + rnd.nextU32() % 3) & 3, p);
+	}
+	for(size_t i = 0; i < nins; i++) {
+		size_t p = 8 + rnd.nextU32() % (read.length() - 16);
+		read.insert(rnd.nextU2(), p);
+	}
+	for(size_t i = 0; i < ndel; i++) {
+		size_t p = 8 + rnd.nextU32() % (read.length() - 16);
+		read.remove(p);
+	}
+}
+
+/**
+ * Make a Scoring object with the default end-to-end settings, except for
+ * the given read and reference gap penalties.
+ */
+static Scoring bpScoring(int rdOpen, int rdExt, int rfOpen, int rfExt) {
+	SimpleFunc scoreMin, nCeil;
+	scoreMin.init(SIMPLE_FUNC_LINEAR, DEFAULT_MIN_CONST, DEFAULT_MIN_LINEAR);
+	nCeil.init(SIMPLE_FUNC_LINEAR, DEFAULT_N_CEIL_CONST, DEFAULT_N_CEIL_LINEAR);
+	return Scoring(
+		DEFAULT_MATCH_BONUS,
+		DEFAULT_MM_PENALTY_TYPE,
+		DEFAULT_MM_PENALTY_MAX,
+		DEFAULT_MM_PENALTY_MIN,
+		scoreMin,
+		nCeil,
+		DEFAULT_N_PENALTY_TYPE,
+		DEFAULT_N_PENALTY,
+		DEFAULT_N_CAT_PAIR,
+		rdOpen,
+		rfOpen,
+		rdExt,
+		rfExt,
+		gGapBarrier);
+}
+
+/**
+ * Check that the bit-parallel filter never rejects a DP problem the full DP
+ * finds an alignment for, and that it does reject problems with far too
+ * many edits.
+ */
+int main(int argc, char **argv) {
+	gGapBarrier = 4;
+	RandomSource rnd(77);
+	SwAligner sw(NULL);
+	BTDnaString ref, read;
+	bpRandSeq(rnd, 2000, ref);
+	BTString qual;
+	bool aligned = false;
+	// Default penalties: MX 6, read/ref gaps 5+3; 100 bp reads need a score
+	// of -60 or better, and each edit costs at least 3
+	Scoring sc = bpScoring(5, 3, 5, 3);
+
+	cerr << "Test bit-parallel filter on mismatches and indels...";
+	{
+		struct {
+			size_t nmm, nins, ndel;
+			bool dpAligned;  // expected DP result
+			bool filtPass;   // expected filter result
+		} cases[] = {
+			{  0, 0, 0, true,  true  },
+			{  5, 0, 0, true,  true  },
+			{ 12, 0, 0, false, true  }, // 72 penalty, but only 12 edits
+			{ 40, 0, 0, false, false }, // over 20 edits
+			{  0, 1, 0, true,  true  },
+			{  0, 0, 1, true,  true  },
+			{  2, 1, 1, true,  true  },
+			{  0, 0, 25, false, false },
+			{  0, 25, 0, false, false },
+		};
+		qual.resize(100);
+		qual.fill('I');
+		for(size_t i = 0; i < sizeof(cases)/sizeof(cases[0]); i++) {
+			size_t nmm = cases[i].nmm, nins = cases[i].nins, ndel = cases[i].ndel;
+			bpMutate(rnd, ref, 500, 100 - nins + ndel, nmm, nins, ndel, read);
+			assert_eq(100, read.length());
+			bool pass = bpFilterCase(sw, read, qual, ref, 500, sc, aligned);
+			if(aligned != cases[i].dpAligned || pass != cases[i].filtPass) {
+				cerr << "FAILED case " << i << ": DP " << aligned
+				     << ", filter " << pass << endl;
+				throw 1;
+			}
+		}
+	}
+	cerr << "PASSED" << endl;
+
+	cerr << "Test bit-parallel filter with cheap gap extensions...";
+	{
+		// An extension penalty of 1 is below the smallest mismatch
+		// penalty, so 25 extra read chars in one gap (5 + 25) still align
+		Scoring scExt = bpScoring(5, 1, 5, 1);
+		qual.resize(100);
+		qual.fill('I');
+		for(size_t i = 0; i < 100; i++) {
+			read.set(ref[700 + i], i);
+		}
+		read.resize(100);
+		BTDnaString ins;
+		bpRandSeq(rnd, 25, ins);
+		for(size_t i = 0; i < 25; i++) {
+			read.insert(ins[i], 50);
+		}
+		read.resize(100);
+		bool pass = bpFilterCase(sw, read, qual, ref, 700, scExt, aligned);
+		if(!pass) {
+			cerr << "FAILED: filter rejected a cheap long gap" << endl;
+			throw 1;
+		}
+	}
+	cerr << "PASSED" << endl;
+
+	cerr << "Test bit-parallel filter against DP on random edits...";
+	{
+		Scoring scs[] = {
+			bpScoring(5, 3, 5, 3),
+			bpScoring(5, 1, 5, 2),
+			bpScoring(2, 2, 8, 1)
+		};
+		size_t nrej = 0, ndp = 0;
+		for(size_t i = 0; i < 3000; i++) {
+			const Scoring& s = scs[i % 3];
+			size_t len = 30 + rnd.nextU32() % 170;
+			size_t off = 100 + rnd.nextU32() % 1500;
+			size_t nmm = rnd.nextU32() % (len / 2);
+			size_t nins = rnd.nextU32() % 4;
+			size_t ndel = rnd.nextU32() % 4;
+			bpMutate(rnd, ref, off, len, nmm, nins, ndel, read);
+			qual.resize(read.length());
+			for(size_t j = 0; j < qual.length(); j++) {
+				qual.set(33 + rnd.nextU32() % 41, j);
+			}
+			if(rnd.nextU32() % 8 == 0) {
+				read.set(4, rnd.nextU32() % read.length()); // N
+			}
+			bool pass = bpFilterCase(sw, read, qual, ref, (int64_t)off, s, aligned);
+			if(!pass) nrej++;
+			if(aligned) ndp++;
+		}
+		if(nrej == 0 || ndp == 0) {
+			cerr << "FAILED: " << nrej << " rejected, " << ndp << " aligned" << endl;
+			throw 1;
+		}
+	}
+	cerr << "PASSED" << endl;
+	return 0;
+}
+
+#endif /*MAIN_BP_FILTER*/
@@ -91,6 +91,10 @@
 							(int)(*qu_)[rdi_ + d] - 33)
 #define N_SNP_PEN(c) (((int)rf_[rfi_ + c] > 15) ? sc_->n(30) : sc_->penSnp)
 
+// End-to-end 8-bit matrices with at least this many cells (about 512 KB of
+// E/F/H/TMP bytes) get a score-only fill before the full fill
+#define SCORE_ONLY_MIN_CELLS (128 * 1024)
+
 /**
  * SwAligner
  * =========
@@ -209,6 +213,10 @@ public:
 		sseU8rc_(DP_CAT),
 		sseI16fw_(DP_CAT),
 		sseI16rc_(DP_CAT),
+		bpPeqFw_(DP_CAT),
+		bpPeqRc_(DP_CAT),
+		bpPv_(DP_CAT),
+		bpMv_(DP_CAT),
 		state_(STATE_UNINIT),
 		initedRead_(false),
 		readSse16_(false),
@@ -319,6 +327,15 @@ public:
 		TAlScore                minsc,  // minimum score
 		SwResult&               res);   // put alignment result here
 
+	/**
+	 * Use a bit-parallel (Myers) edit distance computation to decide whether
+	 * any alignment in the rectangle given to the last initRef() call could
+	 * possibly score >= minsc.  Returns false iff it is certain that none can,
+	 * in which case the caller need not call align().  Only end-to-end
+	 * problems are filtered; local problems always pass.
+	 */
+	bool bitParallelFilter();
+
 	/**
 	 * Align read 'rd' to reference using read & reference information given
 	 * last time init() was called.  Uses dynamic programming.
@@ -447,10 +464,13 @@ protected:
 	 * vector instructions.  Return the score of the best alignment found, or
 	 * the minimum integer if an alignment could not be found.  Flag is set to
 	 * 0 if an alignment is found, -1 if no valid alignment is found, or -2 if
-	 * the score saturated at any point during alignment.
+	 * the score saturated at any point during alignment.  If scoreOnly is
+	 * true, the 8-bit end-to-end fill keeps no matrix for backtracing and
+	 * stops as soon as the score reaches the minimum.
 	 */
 	TAlScore alignNucleotidesEnd2EndSseU8(  // unsigned 8-bit elements
-		int& flag, bool debug);
+		int& flag, bool debug, bool scoreOnly);
+	
 	TAlScore alignNucleotidesLocalSseU8(    // unsigned 8-bit elements
 		int& flag, bool debug);
 	TAlScore alignNucleotidesEnd2EndSseI16( // signed 16-bit elements
@@ -502,6 +522,21 @@ protected:
 	 */
 	void buildQueryProfileEnd2EndSseI16(bool fw);
 	void buildQueryProfileLocalSseI16(bool fw);
+
+	/**
+	 * Build the per-character match bitmasks (Peq) used by the bit-parallel
+	 * filter.  Bit i of word w for character c is set iff read character
+	 * 64*w+i is c or N.
+	 */
+	void buildBitParallelPeq(bool fw);
+
+	/**
+	 * Return the first DP column (relative to rfi_) after which a new
+	 * end-to-end alignment can no longer start and still score >= minsc_.
+	 * Beyond it, only cells in rows >= (col - xdropcol) can still reach the
+	 * bottom row.
+	 */
+	size_t end2EndXdropCol() const;
 	
 	bool gatherCellsNucleotidesLocalSseU8(TAlScore best);
 	bool gatherCellsNucleotidesEnd2EndSseU8(TAlScore best);
@@ -609,6 +644,14 @@ protected:
 	bool                sseU8rcBuilt_;   // built rc query profile, 8-bit score
 	bool                sseI16fwBuilt_;  // built fw query profile, 16-bit score
 	bool                sseI16rcBuilt_;  // built rc query profile, 16-bit score
+	
+	EList<uint64_t>     bpPeqFw_;   // bit-parallel match masks, fw read
+	EList<uint64_t>     bpPeqRc_;   // bit-parallel match masks, rc read
+	EList<uint64_t>     bpPv_;      // bit-parallel +1 vertical deltas
+	EList<uint64_t>     bpMv_;      // bit-parallel -1 vertical deltas
+	bool                bpFwBuilt_; // built fw match masks
+	bool                bpRcBuilt_; // built rc match masks
+	int                 bpMinPen_;  // smallest penalty any one edit can incur
 
 	SSEMetrics			sseU8ExtendMet_;
 	SSEMetrics			sseU8MateMet_;
@@ -119,7 +119,7 @@ struct SwMetrics {
 	void reset() {
 		sws = swcups = swrows = swskiprows = swskip = swsucc = swfail = swbts =
 		sws10 = sws5 = sws3 =
-		rshit = ungapsucc = ungapfail = ungapnodec = 0;
+		rshit = ungapsucc = ungapfail = ungapnodec = bpfilt = 0;
 		exatts = exranges = exrows = exsucc = exooms = 0;
 		mm1atts = mm1ranges = mm1rows = mm1succ = mm1ooms = 0;
 		sdatts = sdranges = sdrows = sdsucc = sdooms = 0;
@@ -231,6 +231,7 @@ struct SwMetrics {
 		ungapsucc  += r.ungapsucc;
 		ungapfail  += r.ungapfail;
 		ungapnodec += r.ungapnodec;
+		bpfilt     += r.bpfilt;
 		exatts     += r.exatts;
 		exranges   += r.exranges;
 		exrows     += r.exrows;
@@ -270,6 +271,7 @@ struct SwMetrics {
 	uint64_t ungapsucc;  // # DP problems avoided b/c seed hit was redundant
 	uint64_t ungapfail;  // # DP problems avoided b/c seed hit was redundant
 	uint64_t ungapnodec; // # DP problems avoided b/c seed hit was redundant
+	uint64_t bpfilt;     // # DP problems avoided b/c bit-parallel filter failed
 
 	uint64_t exatts;     // total # attempts at exact-hit end-to-end aln
 	uint64_t exranges;   // total # ranges returned by exact-hit queries
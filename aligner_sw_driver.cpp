@@ -287,6 +287,14 @@ bool SwDriver::eeSaTups(
             }
 		}
 	}
+	// Note whether maxelt kept us from considering some of the hits
+	size_t eetot = tot;
+	for(size_t i = 0; i < sh.mm1EEHits().size(); i++) {
+		eetot += sh.mm1EEHits()[i].size();
+	}
+	if(eetot > nelt_out) {
+		sampled_ = true;
+	}
 	return true;
 }
 
@@ -605,6 +613,9 @@ void SwDriver::prioritizeSATups(
 	}
 	assert_leq(nsmall, nrange);
 	nelt_out = nelt; // return the total number of elements
+	if(nelt > maxelt) {
+		sampled_ = true; // we'll only get to some of them
+	}
 	assert_eq(nrange, satpos.size());
 	satpos.sort();
 	if(keepWhole) {
@@ -769,6 +780,7 @@ int SwDriver::extendSeeds(
 	int nceil,                   // maximum # Ns permitted in reference portion
 	size_t maxhalf,  	         // max width in either direction for DP tables
 	bool doUngapped,             // do ungapped alignment
+	bool doBpFilter,             // bit-parallel filter before DP fill
 	size_t maxIters,             // stop after this many seed-extend loop iters
 	size_t maxUg,                // stop after this many ungaps
 	size_t maxDp,                // stop after this many dps
@@ -803,6 +815,7 @@ int SwDriver::extendSeeds(
 
 	DynProgFramer dpframe(!gReportOverhangs);
 	swa.reset();
+	sampled_ = false;
 
 	// Initialize a set of GroupWalks, one for each seed.  Also, intialize the
 	// accompanying lists of reference seed hits (satups*)
@@ -1134,7 +1147,13 @@ int SwDriver::extendSeeds(
 					// Now fill the dynamic programming matrix and return true iff
 					// there is at least one valid alignment
 					TAlScore bestCell = std::numeric_limits<TAlScore>::min();
-					found = swa.align(bestCell);
+					if(doBpFilter && !swa.bitParallelFilter()) {
+						// Too many edits for any alignment to reach minsc
+						swmSeed.bpfilt++;
+						found = false;
+					} else {
+						found = swa.align(bestCell);
+					}
 					swmSeed.tallyGappedDp(readGaps, refGaps);
 					prm.nExDps++;
 					if(!found) {
@@ -1404,6 +1423,7 @@ int SwDriver::extendSeedsPaired(
 	bool norc,                   // don't align revcomp read
 	size_t maxhalf,              // max width in either direction for DP tables
 	bool doUngapped,             // do ungapped alignment
+	bool doBpFilter,             // bit-parallel filter before DP fill
 	size_t maxIters,             // stop after this many seed-extend loop iters
 	size_t maxUg,                // stop after this many ungaps
 	size_t maxDp,                // stop after this many dps
@@ -1481,6 +1501,7 @@ int SwDriver::extendSeedsPaired(
 	DynProgFramer dpframe(!gReportOverhangs);
 	swa.reset();
 	oswa.reset();
+	sampled_ = false;
 
 	// Initialize a set of GroupWalks, one for each seed.  Also, intialize the
 	// accompanying lists of reference seed hits (satups*)
@@ -1662,7 +1683,7 @@ int SwDriver::extendSeedsPaired(
 				// Find offset of alignment's upstream base assuming net gaps=0
 				// between beginning of read and beginning of seed hit
 				int64_t refoff = (int64_t)toff - rdoff;
-				EIvalMergeListBinned& seenDiags  = anchor1 ? seenDiags1_ : seenDiags2_;
+				EIvalHashSet& seenDiags  = anchor1 ? seenDiags1_ : seenDiags2_;
 				// Coordinate of the seed hit w/r/t the pasted reference string
 				Coord refcoord(tidx, refoff, fw);
 				if(seenDiags.locusPresent(refcoord)) {
@@ -1826,7 +1847,13 @@ int SwDriver::extendSeedsPaired(
 					// Now fill the dynamic programming matrix and return true iff
 					// there is at least one valid alignment
 					TAlScore bestCell = std::numeric_limits<TAlScore>::min();
-					found = swa.align(bestCell);
+					if(doBpFilter && !swa.bitParallelFilter()) {
+						// Too many edits for any alignment to reach minsc
+						swmSeed.bpfilt++;
+						found = false;
+					} else {
+						found = swa.align(bestCell);
+					}
 					swmSeed.tallyGappedDp(readGaps, refGaps);
 					prm.nExDps++;
 					prm.nDpFail++;    // failed until proven successful
@@ -2071,7 +2098,13 @@ int SwDriver::extendSeedsPaired(
 							// Now fill the dynamic programming matrix, return true
 							// iff there is at least one valid alignment
 							TAlScore bestCell = std::numeric_limits<TAlScore>::min();
-							foundMate = oswa.align(bestCell);
+							if(doBpFilter && !oswa.bitParallelFilter()) {
+								// Too many edits for any alignment to reach minsc
+								swmMate.bpfilt++;
+								foundMate = false;
+							} else {
+								foundMate = oswa.align(bestCell);
+							}
 							prm.nMateDps++;
 							swmMate.tallyGappedDp(oreadGaps, orefGaps);
 							if(!foundMate) {
@@ -307,7 +307,8 @@ public:
 		redMate2_(DP_CAT),
 		pool_(bytes, CACHE_PAGE_SZ, DP_CAT),
 		salistEe_(DP_CAT),
-		gwstate_(GW_CAT) { }
+		gwstate_(GW_CAT),
+		sampled_(false) { }
 
 	/**
 	 * Given a collection of SeedHits for a single read, extend seed alignments
@@ -335,6 +336,7 @@ public:
 		int nceil,                   // maximum # Ns permitted in ref portion
 		size_t maxhalf,              // maximum width on one side of DP table
 		bool doUngapped,             // do ungapped alignment
+		bool doBpFilter,             // bit-parallel filter before DP fill
 		size_t maxIters,             // stop after this many seed-extend loop iters
 		size_t maxUg,                // max # ungapped extends
 		size_t maxDp,                // max # DPs
@@ -390,6 +392,7 @@ public:
 		bool norc,                   // don't align revcomp read
 		size_t maxhalf,              // maximum width on one side of DP table
 		bool doUngapped,             // do ungapped alignment
+		bool doBpFilter,             // bit-parallel filter before DP fill
 		size_t maxIters,             // stop after this many seed-extend loop iters
 		size_t maxUg,                // max # ungapped extends
 		size_t maxDp,                // max # DPs
@@ -416,6 +419,15 @@ public:
 		bool mixed,                  // look for unpaired as well as paired alns?
 		bool& exhaustive);
 
+	/**
+	 * Return true iff the last call to extendSeeds() or extendSeedsPaired()
+	 * had more seed hits than it was allowed to consider and so only
+	 * examined a random sample of them.
+	 */
+	bool sampledHits() const {
+		return sampled_;
+	}
+
 	/**
 	 * Prepare for a new read.
 	 */
@@ -505,8 +517,8 @@ protected:
 
 	// Data structures encapsulating the diagonals that have already been used
 	// to seed alignment for mate 1 and mate 2.
-	EIvalMergeListBinned seenDiags1_;
-	EIvalMergeListBinned seenDiags2_;
+	EIvalHashSet   seenDiags1_;
+	EIvalHashSet   seenDiags2_;
 
 	// For weeding out redundant alignments
 	RedundantAlns  redAnchor_;  // database of cells used for anchor alignments
@@ -524,6 +536,7 @@ protected:
 	Pool           pool_;      // memory pages for salistExact_
 	TSAList        salistEe_;  // PList for offsets for end-to-end hits
 	GroupWalkState gwstate_;   // some per-thread state shared by all GroupWalks
+	bool           sampled_;   // last extend call considered only some hits
 	
 	// For AlnRes::matchesRef:
 	ASSERT_ONLY(SStringExpandable<char>     raw_refbuf_);
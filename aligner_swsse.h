@@ -35,7 +35,7 @@ struct SSEMetrics {
 
 	void clear() { reset(); }
 	void reset() {
-		dp = dpsat = dpfail = dpsucc = 
+		dp = dpsat = dpfail = dpsucc = dpskip = 
 		col = cell = inner = fixup =
 		gathsol = bt = btfail = btsucc = btcell =
 		corerej = nrej = 0;
@@ -47,6 +47,7 @@ struct SSEMetrics {
 		dpsat    += o.dpsat;
 		dpfail   += o.dpfail;
 		dpsucc   += o.dpsucc;
+		dpskip   += o.dpskip;
 		col      += o.col;
 		cell     += o.cell;
 		inner    += o.inner;
@@ -64,6 +65,7 @@ struct SSEMetrics {
 	uint64_t dpsat;    // DPs saturated
 	uint64_t dpfail;   // DPs failed
 	uint64_t dpsucc;   // DPs succeeded
+	uint64_t dpskip;   // DPs sent straight to 16-bit (8-bit only)
 	uint64_t col;      // DP columns
 	uint64_t cell;     // DP cells
 	uint64_t inner;    // DP inner loop iters
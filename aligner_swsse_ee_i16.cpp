@@ -934,8 +934,9 @@ TAlScore SwAligner::alignNucleotidesEnd2EndSseI16(int& flag, bool debug) {
 	// it difficult to use the first-row results in the next row, but it might
 	// be the simplest and least disruptive way to deal with the st_ constraint.
 	
-	colstop_ = rff_ - 1;
+	colstop_ = rff_ - rfi_;
 	lastsolcol_ = 0;
+	const size_t xdropcol = end2EndXdropCol();
 	
 	for(size_t i = (size_t)rfi_; i < (size_t)rff_; i++) {
 		assert(pvFStore == d.mat_.fvec(0, i - rfi_));
@@ -1138,6 +1139,27 @@ TAlScore SwAligner::alignNucleotidesEnd2EndSseI16(int& flag, bool debug) {
 			lrmax = lr;
 		}
 
+		// X-drop: past xdropcol, a cell in row r of column c can only reach
+		// the bottom row through a too-costly reference gap unless
+		// r >= c - xdropcol; that also rules out new alignments starting to
+		// the right.  Scores never increase along an end-to-end path, so once
+		// every remaining live cell is below minsc_, stop filling.
+		if(i - rfi_ >= xdropcol && ((i - rfi_ - xdropcol) & 3) == 0 &&
+		   i + 1 < (size_t)rff_)
+		{
+			int colmax = sseStripedColMax<TCScore>(
+				d.mat_.hvec(0, i-rfi_),
+				ROWSTRIDE,
+				iter,
+				(i - rfi_) - xdropcol, // first live row
+				dpRows(),
+				MIN_I16);
+			if((TAlScore)colmax - 0x7fff < minsc_) {
+				colstop_ = (i+1) - rfi_;
+				break;
+			}
+		}
+
 		// pvELoad and pvHLoad are already where they need to be
 		
 		// Adjust the load and store vectors here.  
@@ -1148,8 +1170,8 @@ TAlScore SwAligner::alignNucleotidesEnd2EndSseI16(int& flag, bool debug) {
 	
 	// Update metrics
 	if(!debug) {
-		size_t ninner = (rff_ - rfi_) * iter;
-		met.col   += (rff_ - rfi_);             // DP columns
+		size_t ninner = colstop_ * iter;
+		met.col   += colstop_;                  // DP columns
 		met.cell  += (ninner * NWORDS_PER_REG); // DP cells
 		met.inner += ninner;                    // DP inner loop iters
 		met.fixup += nfixup;                    // DP fixup loop iters
@@ -1227,7 +1249,7 @@ bool SwAligner::gatherCellsNucleotidesEnd2EndSseI16(TAlScore best) {
 	const size_t colstride = d.mat_.colstride();
 	ASSERT_ONLY(bool sawbest = false);
 	__m128i *pvH = d.mat_.hvec(d.lastIter_, 0);
-	for(size_t j = 0; j < ncol; j++) {
+	for(size_t j = 0; j < min(ncol, colstop_); j++) {
 		TAlScore sc = (TAlScore)(((TCScore*)pvH)[d.lastWord_] - 0x7fff);
 		assert_leq(sc, best);
 		ASSERT_ONLY(sawbest = (sawbest || sc == best));
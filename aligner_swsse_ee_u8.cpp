@@ -785,8 +785,18 @@ TAlScore SwAligner::alignGatherEE8(int& flag, bool debug) {
 /**
  * Solve the current alignment problem using SSE instructions that operate on 16
  * unsigned 8-bit values packed into a single 128-bit register.
+ *
+ * If scoreOnly is true, keep just two columns of the matrix and stop as soon
+ * as the best score in the last row reaches minsc_.  Nothing is kept for
+ * backtracing, so the caller re-fills with scoreOnly = false if and only if
+ * flag is 0.  Most DP problems end without a valid alignment, and for those
+ * this avoids writing out the full matrix.
  */
-TAlScore SwAligner::alignNucleotidesEnd2EndSseU8(int& flag, bool debug) {
+TAlScore SwAligner::alignNucleotidesEnd2EndSseU8(
+	int& flag,
+	bool debug,
+	bool scoreOnly)
+{
 	assert_leq(rdf_, rd_->length());
 	assert_leq(rdf_, qu_->length());
 	assert_lt(rfi_, rff_);
@@ -802,7 +812,7 @@ TAlScore SwAligner::alignNucleotidesEnd2EndSseU8(int& flag, bool debug) {
 
 	SSEData& d = fw_ ? sseU8fw_ : sseU8rc_;
 	SSEMetrics& met = extend_ ? sseU8ExtendMet_ : sseU8MateMet_;
-	if(!debug) met.dp++;
+	if(!debug && !scoreOnly) met.dp++;
 	buildQueryProfileEnd2EndSseU8(fw_);
 	assert(!d.profbuf_.empty());
 
@@ -885,8 +895,11 @@ TAlScore SwAligner::alignNucleotidesEnd2EndSseU8(int& flag, bool debug) {
 	// calculated by the Farrar algorithm.
 	const __m128i *pvScore; // points into the query profile
 
-	d.mat_.init(dpRows(), rff_ - rfi_, NWORDS_PER_REG);
+	// In score-only mode column c of the fill lives in column c % 2 of mat_
+	const size_t ncol = scoreOnly ? 2 : (size_t)(rff_ - rfi_);
+	d.mat_.init(dpRows(), ncol, NWORDS_PER_REG);
 	const size_t colstride = d.mat_.colstride();
+	__m128i * const pvRingEnd = scoreOnly ? d.mat_.evecUnsafe(0, 2) : NULL;
 	//const size_t rowstride = d.mat_.rowstride();
 	assert_eq(ROWSTRIDE, colstride / iter);
 	
@@ -927,12 +940,14 @@ TAlScore SwAligner::alignNucleotidesEnd2EndSseU8(int& flag, bool debug) {
 	// it difficult to use the first-row results in the next row, but it might
 	// be the simplest and least disruptive way to deal with the st_ constraint.
 
-	colstop_ = rff_ - 1;
+	colstop_ = rff_ - rfi_;
 	lastsolcol_ = 0;
+	const size_t xdropcol = end2EndXdropCol();
 
 	for(size_t i = (size_t)rfi_; i < (size_t)rff_; i++) {
-		assert(pvFStore == d.mat_.fvec(0, i - rfi_));
-		assert(pvHStore == d.mat_.hvec(0, i - rfi_));
+		const size_t col = scoreOnly ? ((i - rfi_) & 1) : (i - rfi_);
+		assert(pvFStore == d.mat_.fvec(0, col));
+		assert(pvHStore == d.mat_.hvec(0, col));
 		
 		// Fetch the appropriate query profile.  Note that elements of rf_ must
 		// be numbers, not masks.
@@ -1099,7 +1114,7 @@ TAlScore SwAligner::alignNucleotidesEnd2EndSseU8(int& flag, bool debug) {
 		}
 		
 #ifndef NDEBUG
-		if(true && (rand() & 15) == 0) {
+		if(!scoreOnly && (rand() & 15) == 0) {
 			// This is a work-intensive sanity check; each time we finish filling
 			// a column, we check that each H, E, and F is sensible.
 			for(size_t k = 0; k < dpRows(); k++) {
@@ -1115,13 +1130,38 @@ TAlScore SwAligner::alignNucleotidesEnd2EndSseU8(int& flag, bool debug) {
 		}
 #endif
 		
-		__m128i *vtmp = d.mat_.hvec(d.lastIter_, i-rfi_);
+		__m128i *vtmp = d.mat_.hvec(d.lastIter_, col);
 		// Note: we may not want to extract from the final row
 		TCScore lr = ((TCScore*)(vtmp))[d.lastWord_];
 		found = true;
 		if(lr > lrmax) {
 			lrmax = lr;
 		}
+		if(scoreOnly && (TAlScore)lrmax - 0xff >= minsc_) {
+			// Found a valid alignment; the full fill takes it from here
+			break;
+		}
+
+		// X-drop: past xdropcol, a cell in row r of column c can only reach
+		// the bottom row through a too-costly reference gap unless
+		// r >= c - xdropcol; that also rules out new alignments starting to
+		// the right.  Scores never increase along an end-to-end path, so once
+		// every remaining live cell is below minsc_, stop filling.
+		if(i - rfi_ >= xdropcol && ((i - rfi_ - xdropcol) & 3) == 0 &&
+		   i + 1 < (size_t)rff_)
+		{
+			int colmax = sseStripedColMax<TCScore>(
+				d.mat_.hvec(0, col),
+				ROWSTRIDE,
+				iter,
+				(i - rfi_) - xdropcol, // first live row
+				dpRows(),
+				0);
+			if((TAlScore)colmax - 0xff < minsc_) {
+				colstop_ = (i+1) - rfi_;
+				break;
+			}
+		}
 
 		// pvELoad and pvHLoad are already where they need to be
 		
@@ -1129,12 +1169,26 @@ TAlScore SwAligner::alignNucleotidesEnd2EndSseU8(int& flag, bool debug) {
 		pvHStore = pvHLoad + colstride;
 		pvEStore = pvELoad + colstride;
 		pvFStore = pvFTmp;
+		if(scoreOnly) {
+			// Wrap around to the first of the two columns
+			if(pvELoad  >= pvRingEnd) pvELoad  -= 2 * colstride;
+			if(pvHStore >= pvRingEnd) pvHStore -= 2 * colstride;
+			if(pvEStore >= pvRingEnd) pvEStore -= 2 * colstride;
+			if(pvFStore >= pvRingEnd) pvFStore -= 2 * colstride;
+		}
+	}
+	
+	if(scoreOnly && (TAlScore)lrmax - 0xff >= minsc_) {
+		// The full fill that follows does the accounting
+		flag = 0;
+		return (TAlScore)(lrmax - 0xff);
 	}
 	
 	// Update metrics
 	if(!debug) {
-		size_t ninner = (rff_ - rfi_) * iter;
-		met.col   += (rff_ - rfi_);             // DP columns
+		if(scoreOnly) met.dp++;
+		size_t ninner = colstop_ * iter;
+		met.col   += colstop_;                  // DP columns
 		met.cell  += (ninner * NWORDS_PER_REG); // DP cells
 		met.inner += ninner;                    // DP inner loop iters
 		met.fixup += nfixup;                    // DP fixup loop iters
@@ -1212,7 +1266,7 @@ bool SwAligner::gatherCellsNucleotidesEnd2EndSseU8(TAlScore best) {
 	const size_t colstride = d.mat_.colstride();
 	ASSERT_ONLY(bool sawbest = false);
 	__m128i *pvH = d.mat_.hvec(d.lastIter_, 0);
-	for(size_t j = 0; j < ncol; j++) {
+	for(size_t j = 0; j < min(ncol, colstop_); j++) {
 		TAlScore sc = (TAlScore)(((TCScore*)pvH)[d.lastWord_] - 0xff);
 		assert_leq(sc, best);
 		ASSERT_ONLY(sawbest = (sawbest || sc == best));
@@ -610,6 +610,7 @@ int AlnSinkWrap::nextRead(
 	rs2_.clear();     // clear out paired-end alignments
 	rs1u_.clear();    // clear out unpaired alignments for mate #1
 	rs2u_.clear();    // clear out unpaired alignments for mate #2
+	rptKinds_.clear();
 	st_.nextRead(readIsPair()); // reset state
 	assert(empty());
 	assert(!maxed());
@@ -661,7 +662,12 @@ void AlnSinkWrap::finishRead(
 	bool suppressAlignments)        // = false
 {
 	obuf_.clear();
-	OutputQueueMark qqm(g_.outq(), obuf_, rdid_, threadid_);
+	OutputQueueMark qqm(
+		g_.outq(),
+		obuf_,
+		rdid_,
+		threadid_,
+		(uint64_t)prm.tv_beg.tv_sec * 1000000 + prm.tv_beg.tv_usec);
 	assert(init_);
 	if(!suppressSeedSummary) {
 		if(sr1 != NULL) {
@@ -760,7 +766,10 @@ void AlnSinkWrap::finishRead(
 			SeedAlSumm ssm1, ssm2;
 			sr1->toSeedAlSumm(ssm1);
 			sr2->toSeedAlSumm(ssm2);
-			for(size_t i = 0; i < rs1_.size(); i++) {
+			// Only selected alignments are printed, so only they need mate
+			// parameters
+			for(size_t j = 0; j < select1_.size(); j++) {
+				size_t i = select1_[j];
 				rs1_[i].setMateParams(ALN_RES_TYPE_MATE1, &rs2_[i], flags1);
 				rs2_[i].setMateParams(ALN_RES_TYPE_MATE2, &rs1_[i], flags2);
 				assert_eq(abs(rs1_[i].fragmentLength()), abs(rs2_[i].fragmentLength()));
@@ -1030,8 +1039,9 @@ void AlnSinkWrap::finishRead(
 				true,   // primary
 				repRs2 != NULL,                    // opp aligned
 				repRs2 == NULL || repRs2->fw());   // opp fw
-			for(size_t i = 0; i < rs1u_.size(); i++) {
-				rs1u_[i].setMateParams(ALN_RES_TYPE_UNPAIRED_MATE1, NULL, flags1);
+			for(size_t i = 0; i < select1_.size(); i++) {
+				rs1u_[select1_[i]].setMateParams(
+					ALN_RES_TYPE_UNPAIRED_MATE1, NULL, flags1);
 			}
 		}
 		if(rep2) {
@@ -1052,8 +1062,9 @@ void AlnSinkWrap::finishRead(
 				true,   // primary
 				repRs1 != NULL,                  // opp aligned
 				repRs1 == NULL || repRs1->fw()); // opp fw
-			for(size_t i = 0; i < rs2u_.size(); i++) {
-				rs2u_[i].setMateParams(ALN_RES_TYPE_UNPAIRED_MATE2, NULL, flags2);
+			for(size_t i = 0; i < select2_.size(); i++) {
+				rs2u_[select2_[i]].setMateParams(
+					ALN_RES_TYPE_UNPAIRED_MATE2, NULL, flags2);
 			}
 		}
 		
@@ -1248,12 +1259,21 @@ bool AlnSinkWrap::report(
 		st_.foundConcordant();
 		rs1_.push_back(*rs1);
 		rs2_.push_back(*rs2);
+		if(refOff_ != 0) {
+			rs1_.back().shiftRefId(refOff_);
+			rs2_.back().shiftRefId(refOff_);
+		}
+		rptKinds_.push_back(RPT_CONCORDANT);
 	} else {
 		st_.foundUnpaired(one);
 		if(one) {
 			rs1u_.push_back(*rs1);
+			if(refOff_ != 0) rs1u_.back().shiftRefId(refOff_);
+			rptKinds_.push_back(RPT_UNPAIRED1);
 		} else {
 			rs2u_.push_back(*rs2);
+			if(refOff_ != 0) rs2u_.back().shiftRefId(refOff_);
+			rptKinds_.push_back(RPT_UNPAIRED2);
 		}
 	}
 	// Tally overall alignment score
@@ -1287,6 +1307,63 @@ bool AlnSinkWrap::report(
 	return st_.done();
 }
 
+/**
+ * Copy the alignments reported so far for the current read, in the order
+ * they were reported, into 'ra'.  Must be called before finishRead(), since
+ * prepareDiscordants() may move unpaired alignments into rs1_/rs2_.
+ */
+void AlnSinkWrap::saveReported(ReportedAlns& ra) const {
+	assert(init_);
+	ra.clear();
+	size_t ic = 0, iu1 = 0, iu2 = 0;
+	for(size_t i = 0; i < rptKinds_.size(); i++) {
+		ra.kinds.push_back(rptKinds_[i]);
+		if(rptKinds_[i] == RPT_CONCORDANT) {
+			ra.alns.push_back(rs1_[ic]);
+			ra.alns.push_back(rs2_[ic]);
+			ic++;
+		} else if(rptKinds_[i] == RPT_UNPAIRED1) {
+			ra.alns.push_back(rs1u_[iu1++]);
+		} else {
+			assert_eq(RPT_UNPAIRED2, rptKinds_[i]);
+			ra.alns.push_back(rs2u_[iu2++]);
+		}
+	}
+	assert_eq(ic, rs1_.size());
+	assert_eq(iu1, rs1u_.size());
+	assert_eq(iu2, rs2u_.size());
+}
+
+/**
+ * Report the alignments in 'ra', which were saved with saveReported() for
+ * an earlier read or pair with the same sequence, in their original order.
+ * Replaying the report() calls, rather than copying the lists, rebuilds the
+ * best/second-best scores and the ReportingState exactly as the original
+ * search left them.  Returns the value of the last call to report().
+ */
+bool AlnSinkWrap::replayReported(const ReportedAlns& ra) {
+	assert(init_);
+	assert(empty());
+	// Saved alignments already have ids in the combined reference list
+	TRefId refOff = refOff_;
+	refOff_ = 0;
+	bool ret = false;
+	size_t ai = 0;
+	for(size_t i = 0; i < ra.kinds.size(); i++) {
+		if(ra.kinds[i] == RPT_CONCORDANT) {
+			ret = report(0, &ra.alns[ai], &ra.alns[ai+1]);
+			ai += 2;
+		} else if(ra.kinds[i] == RPT_UNPAIRED1) {
+			ret = report(0, &ra.alns[ai++], NULL);
+		} else {
+			ret = report(0, NULL, &ra.alns[ai++]);
+		}
+	}
+	assert_eq(ai, ra.alns.size());
+	refOff_ = refOff;
+	return ret;
+}
+
 /**
  * If there is a configuration of unpaired alignments that fits our
  * criteria for there being one or more discordant alignments, then
@@ -1304,6 +1381,32 @@ bool AlnSinkWrap::prepareDiscordants() {
 	return false;
 }
 
+/**
+ * Orders (score, offset) pairs by descending score, then descending offset.
+ */
+struct ScoreOffGt {
+	bool operator()(
+		const std::pair<AlnScore, size_t>& a,
+		const std::pair<AlnScore, size_t>& b) const
+	{
+		if(a.first != b.first) return a.first > b.first;
+		return a.second > b.second;
+	}
+};
+
+/**
+ * True for (score, offset) pairs with the given score.
+ */
+struct ScoreEq {
+	ScoreEq(const AlnScore& sc_) : sc(sc_) { }
+
+	bool operator()(const std::pair<AlnScore, size_t>& a) const {
+		return a.first == sc;
+	}
+
+	AlnScore sc;
+};
+
 /**
  * rs1 (possibly together with rs2 if reads are paired) are populated with
  * alignments.  Here we prioritize them according to alignment score, and
@@ -1355,11 +1458,24 @@ size_t AlnSinkWrap::selectByScore(
 		}
 		buf[i].second = i; // original offset
 	}
-	buf.sort(); buf.reverse(); // sort in descending order by score
+	// Only the first 'num' entries of the prioritized list (and the second,
+	// for bestUnchosenC) are ever looked at.  So rather than sorting the
+	// whole list, move the entries scoring at least as well as the nsel-th
+	// best to the front and sort just those, in descending order by score
+	// and then by offset, as sort() followed by reverse() would.
+	std::pair<AlnScore, size_t> *b = buf.ptr();
+	size_t nsel = std::max<size_t>((size_t)num, 2);
+	size_t nhead = sz;
+	if(nsel < sz) {
+		std::nth_element(b, b + nsel - 1, b + sz, ScoreOffGt());
+		nhead = std::partition(
+			b + nsel, b + sz, ScoreEq(b[nsel-1].first)) - b;
+	}
+	std::sort(b, b + nhead, ScoreOffGt());
 	
 	// Randomize streaks of alignments that are equal by score
 	size_t streak = 0;
-	for(size_t i = 1; i < buf.size(); i++) {
+	for(size_t i = 1; i < nhead; i++) {
 		if(buf[i].first == buf[i-1].first) {
 			if(streak == 0) { streak = 1; }
 			streak++;
@@ -1372,7 +1488,43 @@ size_t AlnSinkWrap::selectByScore(
 		}
 	}
 	if(streak > 1) {
-		buf.shufflePortion(buf.size() - streak, streak, rnd);
+		buf.shufflePortion(nhead - streak, streak, rnd);
+	}
+	if(nhead < sz) {
+		// Streaks past the cutoff aren't reported, but shuffling them used
+		// to draw from 'rnd' once per member after the first; draw the same
+		// number of times so that later selections for this read are
+		// unchanged.  That's the number of valid scores past the cutoff
+		// less the number of distinct ones, which we count by marking
+		// each in a table spanning their range.
+		TAlScore lo = MAX_I64, hi = MIN_I64;
+		size_t nvalid = 0;
+		for(size_t i = nhead; i < sz; i++) {
+			if(VALID_AL_SCORE(buf[i].first)) {
+				lo = std::min(lo, buf[i].first.score());
+				hi = std::max(hi, buf[i].first.score());
+				nvalid++;
+			}
+		}
+		size_t ndraw = 0;
+		if(nvalid > 1) {
+			EList<bool>& seen = const_cast<EList<bool>& >(selectSeen_);
+			seen.resize((size_t)(hi - lo) + 1);
+			seen.fillZero();
+			ndraw = nvalid;
+			for(size_t i = nhead; i < sz; i++) {
+				if(VALID_AL_SCORE(buf[i].first)) {
+					size_t j = (size_t)(buf[i].first.score() - lo);
+					if(!seen[j]) {
+						seen[j] = true;
+						ndraw--;
+					}
+				}
+			}
+		}
+		for(size_t i = 0; i < ndraw; i++) {
+			rnd.nextSizeT();
+		}
 	}
 	
 	for(size_t i = 0; i < num; i++) { select[i] = buf[i].second; }
@@ -1683,7 +1835,6 @@ void AlnSinkSam::appendMate(
 	if(rs == NULL && samc_.omitUnalignedReads()) {
 		return;
 	}
-	char buf[1024];
 	char mapqInps[1024];
 	if(rs != NULL) {
 		staln.reset();
@@ -1723,8 +1874,7 @@ void AlnSinkSam::appendMate(
 		// Failed to align
 		fl |= SAM_FLAG_UNMAPPED;
 	}
-	itoa10<int>(fl, buf);
-	o.append(buf);
+	SamConfig::printNum<int>(o, fl);
 	o.append('\t');
 	// RNAME
 	if(rs != NULL) {
@@ -1746,16 +1896,14 @@ void AlnSinkSam::appendMate(
 	// Note: POS is *after* soft clipping.  I.e. POS points to the
 	// upstream-most character *involved in the clipped alignment*.
 	if(rs != NULL) {
-		itoa10<int64_t>(rs->refoff()+1+offAdj, buf);
-		o.append(buf);
+		SamConfig::printNum<int64_t>(o, rs->refoff()+1+offAdj);
 		o.append('\t');
 	} else {
 		if(summ.orefid() != -1) {
 			// Opposite mate aligned but this one didn't - print the opposite
 			// mate's RNAME and POS as is customary
 			assert(flags.partOfPair());
-			itoa10<int64_t>(summ.orefoff()+1+offAdj, buf);
-			o.append(buf);
+			SamConfig::printNum<int64_t>(o, summ.orefoff()+1+offAdj);
 		} else {
 			// No alignment
 			o.append('0');
@@ -1765,10 +1913,9 @@ void AlnSinkSam::appendMate(
 	// MAPQ
 	mapqInps[0] = '\0';
 	if(rs != NULL) {
-		itoa10<TMapq>(mapqCalc.mapq(
+		SamConfig::printNum<TMapq>(o, mapqCalc.mapq(
 			summ, flags, rd.mate < 2, rd.length(),
-			rdo == NULL ? 0 : rdo->length(), mapqInps), buf);
-		o.append(buf);
+			rdo == NULL ? 0 : rdo->length(), mapqInps));
 		o.append('\t');
 	} else {
 		// No alignment
@@ -1801,29 +1948,25 @@ void AlnSinkSam::appendMate(
 	// PNEXT
 	if(rs != NULL && flags.partOfPair()) {
 		if(rso != NULL) {
-			itoa10<int64_t>(rso->refoff()+1, buf);
-			o.append(buf);
+			SamConfig::printNum<int64_t>(o, rso->refoff()+1);
 			o.append('\t');
 		} else {
 			// The convenstion is that if this mate aligns but the opposite
 			// doesn't, we print this mate's offset here
-			itoa10<int64_t>(rs->refoff()+1, buf);
-			o.append(buf);
+			SamConfig::printNum<int64_t>(o, rs->refoff()+1);
 			o.append('\t');
 		}
 	} else if(summ.orefid() != -1) {
 		// The convention if this mate fails to align but the other doesn't is
 		// to copy the mate's details into here
-		itoa10<int64_t>(summ.orefoff()+1, buf);
-		o.append(buf);
+		SamConfig::printNum<int64_t>(o, summ.orefoff()+1);
 		o.append('\t');
 	} else {
 		o.append("0\t");
 	}
 	// ISIZE
 	if(rs != NULL && rs->isFraglenSet()) {
-		itoa10<int64_t>(rs->fragmentLength(), buf);
-		o.append(buf);
+		SamConfig::printNum<int64_t>(o, rs->fragmentLength());
 		o.append('\t');
 	} else {
 		// No fragment
@@ -1838,9 +1981,9 @@ void AlnSinkSam::appendMate(
 			o.append('*');
 		} else {
 			if(rs == NULL || rs->fw()) {
-				o.append(rd.patFw.toZBuf());
+				SamConfig::printSeq(o, rd.patFw);
 			} else {
-				o.append(rd.patRc.toZBuf());
+				SamConfig::printSeq(o, rd.patRc);
 			}
 		}
 	}
@@ -1854,9 +1997,9 @@ void AlnSinkSam::appendMate(
 			o.append('*');
 		} else {
 			if(rs == NULL || rs->fw()) {
-				o.append(rd.qual.toZBuf());
+				o.append(rd.qual.buf(), rd.qual.length());
 			} else {
-				o.append(rd.qualRev.toZBuf());
+				o.append(rd.qualRev.buf(), rd.qualRev.length());
 			}
 		}
 	}
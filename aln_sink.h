@@ -36,6 +36,32 @@ enum {
 	OUTPUT_SAM = 1
 };
 
+/**
+ * Kinds of alignment reported to an AlnSinkWrap via report().
+ */
+enum {
+	RPT_CONCORDANT = 0, // paired-end alignment
+	RPT_UNPAIRED1,      // unpaired alignment for mate 1
+	RPT_UNPAIRED2       // unpaired alignment for mate 2
+};
+
+/**
+ * The alignments reported to an AlnSinkWrap for one read or pair, in the
+ * order they were reported.  Saved with AlnSinkWrap::saveReported() and
+ * replayed into the wrapper for a later, identical read or pair with
+ * AlnSinkWrap::replayReported().
+ */
+struct ReportedAlns {
+
+	void clear() {
+		kinds.clear();
+		alns.clear();
+	}
+
+	EList<int>    kinds; // RPT_* for each call to report()
+	EList<AlnRes> alns;  // two per concordant pair, one per unpaired
+};
+
 /**
  * Metrics summarizing the work done by the reporter and summarizing
  * the number of reads that align, that fail to align, and that align
@@ -993,7 +1019,9 @@ public:
 		rs2u_(),       // mate 2 unpaired alignments
 		select1_(),    // for selecting random subsets for mate 1
 		select2_(),    // for selecting random subsets for mate 2
-		st_(rp)        // reporting state - what's left to do?
+		st_(rp),       // reporting state - what's left to do?
+		rptKinds_(),   // order in which alignments were reported
+		refOff_(0)     // added to ref ids of reported alignments
 	{
 		assert(rp_.repOk());
 	}
@@ -1053,6 +1081,27 @@ public:
 		const AlnRes* rs1,
 		const AlnRes* rs2);
 
+	/**
+	 * Copy the alignments reported so far for the current read, in the
+	 * order they were reported, into 'ra'.  Must be called before
+	 * finishRead().
+	 */
+	void saveReported(ReportedAlns& ra) const;
+
+	/**
+	 * Report the alignments in 'ra', which were saved with saveReported()
+	 * for an earlier read or pair with the same sequence, in their
+	 * original order.  Returns the value of the last call to report().
+	 */
+	bool replayReported(const ReportedAlns& ra);
+
+	/**
+	 * Set the amount to add to the reference id of each alignment passed
+	 * to report().  When aligning against a set of indexes, this is the
+	 * number of references in the indexes before the one being searched.
+	 */
+	void setRefOffset(TRefId off) { refOff_ = off; }
+
 #ifndef NDEBUG
 	/**
 	 * Check that hit sink wrapper is internally consistent.
@@ -1270,8 +1319,11 @@ protected:
 	EList<size_t>   select1_; // parallel to rs1_/rs2_ - which to report
 	EList<size_t>   select2_; // parallel to rs1_/rs2_ - which to report
 	ReportingState  st_;      // reporting state - what's left to do?
+	EList<int>      rptKinds_; // RPT_* for each call to report() for this read
+	TRefId          refOff_;   // added to ref ids of reported alignments
 	
 	EList<std::pair<AlnScore, size_t> > selectBuf_;
+	EList<bool> selectSeen_; // scores seen, for counting ties past cutoff
 	BTString obuf_;
 	StackedAln staln_;
 };
@@ -35,6 +35,7 @@
 #include "timer.h"
 #include "ds.h"
 #include "mem_ids.h"
+#include "sa_is.h"
 
 using namespace std;
 
@@ -210,15 +211,17 @@ public:
 	                      TIndexOffU __bucketSz,
 	                      uint32_t __dcV,
 	                      uint32_t __seed = 0,
+	                      const std::string& __spillFn = std::string(),
 	      	              bool __sanityCheck = false,
 	   	                  bool __passMemExc = false,
 	      	              bool __verbose = false,
 	      	              ostream& __logger = cout) :
 	InorderBlockwiseSA<TStr>(__text, __bucketSz, __sanityCheck, __passMemExc, __verbose, __logger),
-	_sampleSuffs(EBWTB_CAT), _cur(0), _dcV(__dcV), _dc(EBWTB_CAT), _built(false)
+	_sampleSuffs(EBWTB_CAT), _cur(0), _dcV(__dcV), _dc(EBWTB_CAT), _built(false),
+	_spillFn(__spillFn), _spill(NULL), _spillLen(0), _spillIdx(EBWTB_CAT)
 	{ _randomSrc.init(__seed); reset(); }
 
-	~KarkkainenBlockwiseSA() { }
+	~KarkkainenBlockwiseSA() { closeSpill(); }
 
 	/**
 	 * Allocate an amount of memory that simulates the peak memory
@@ -318,12 +321,41 @@ private:
 
 	void buildSamples();
 
+	/**
+	 * Return the index of the bucket that suffix i falls into, or
+	 * OFF_MASK if i is one of the sample suffixes.
+	 */
+	inline TIndexOffU bucketOf(TIndexOffU i);
+
+	void spillBuckets();
+	void flushSpill(EList<TIndexOffU>& offs,
+	                EList<TIndexOffU>& bkts,
+	                EList<TIndexOffU>& sorted);
+	void readSpill(EList<TIndexOffU>& bucket);
+
+	/**
+	 * Close and delete the spill file, if there is one.
+	 */
+	void closeSpill() {
+		if(_spill != NULL) {
+			fclose(_spill);
+			remove(_spillFn.c_str());
+			_spill = NULL;
+		}
+		_spillLen = 0;
+		_spillIdx.clear();
+	}
+
 	EList<TIndexOffU>  _sampleSuffs; /// sample suffixes
 	TIndexOffU         _cur;         /// offset to 1st elt of next block
 	const uint32_t   _dcV;         /// difference-cover periodicity
 	PtrWrap<TDC>     _dc;          /// queryable difference-cover data
 	bool             _built;       /// whether samples/DC have been built
 	RandomSource     _randomSrc;   /// source of pseudo-randoms
+	std::string      _spillFn;     /// spill file for one-pass mode; empty = off
+	FILE            *_spill;       /// open spill file, or NULL
+	uint64_t         _spillLen;    /// # offsets written to _spill so far
+	EList<uint64_t>  _spillIdx;    /// per flush, start of each bucket in _spill
 };
 
 /**
@@ -769,6 +801,186 @@ bool KarkkainenBlockwiseSA<TStr>::suffixCmp(
 	}
 }
 
+/**
+ * Return the index of the bucket that suffix i falls into, or OFF_MASK
+ * if i is one of the sample suffixes.  Comparisons against the samples
+ * are cut short using the difference cover, if we have one.
+ */
+template<typename TStr> inline
+TIndexOffU KarkkainenBlockwiseSA<TStr>::bucketOf(TIndexOffU i) {
+	if(_dc.get() == NULL) {
+		TIndexOffU r = binarySASearch(this->text(), i, _sampleSuffs);
+		return r == std::numeric_limits<TIndexOffU>::max() ? OFF_MASK : r;
+	}
+	size_t lo = 0, hi = _sampleSuffs.size();
+	while(lo < hi) {
+		size_t mid = (lo + hi) >> 1;
+		TIndexOffU s = _sampleSuffs[mid];
+		if(s == i) {
+			return OFF_MASK; // i is a sample
+		}
+		TIndexOffU lcp = 0;
+		bool lcpIsSoft = false;
+		if(tieBreakingLcp(i, s, lcp, lcpIsSoft)) {
+			hi = mid; // suffix i is less than the sample
+		} else {
+			lo = mid + 1;
+		}
+	}
+	assert(!this->sanityCheck() || binarySASearch(this->text(), i, _sampleSuffs) == lo);
+	return (TIndexOffU)lo;
+}
+
+/**
+ * Counting-sort the buffered suffixes by bucket, append them to the
+ * spill file, and record where each bucket's run starts.  Empties
+ * offs and bkts.
+ */
+template<typename TStr>
+void KarkkainenBlockwiseSA<TStr>::flushSpill(
+	EList<TIndexOffU>& offs,
+	EList<TIndexOffU>& bkts,
+	EList<TIndexOffU>& sorted)
+{
+	assert(_spill != NULL);
+	assert_eq(offs.size(), bkts.size());
+	size_t numBuckets = _sampleSuffs.size()+1;
+	size_t base = _spillIdx.size();
+	_spillIdx.resize(base + numBuckets + 1);
+	uint64_t *idx = _spillIdx.ptr() + base;
+	for(size_t b = 0; b <= numBuckets; b++) {
+		idx[b] = 0;
+	}
+	for(size_t k = 0; k < bkts.size(); k++) {
+		idx[bkts[k]+1]++;
+	}
+	for(size_t b = 0; b < numBuckets; b++) {
+		idx[b+1] += idx[b];
+	}
+	// Scatter; offsets stay in text order within each bucket
+	sorted.resize(offs.size());
+	for(size_t k = 0; k < offs.size(); k++) {
+		sorted[(size_t)(idx[bkts[k]]++)] = offs[k];
+	}
+	// Each idx[b] now points to the end of bucket b; shift to get starts
+	// and make them relative to the start of the file
+	for(size_t b = numBuckets; b > 0; b--) {
+		idx[b] = idx[b-1] + _spillLen;
+	}
+	idx[0] = _spillLen;
+	if(fwrite(sorted.ptr(), sizeof(TIndexOffU), sorted.size(), _spill) != sorted.size()) {
+		cerr << "Could not write " << (sorted.size() * sizeof(TIndexOffU))
+		     << " bytes to temporary bucket file " << _spillFn << endl
+		     << "Please check if the disk is full." << endl;
+		throw 1;
+	}
+	_spillLen += sorted.size();
+	offs.clear();
+	bkts.clear();
+}
+
+/**
+ * Make one pass over the text, classifying every suffix into its bucket
+ * and spilling the bucket members to the spill file, so that nextBlock()
+ * doesn't have to make one pass per bucket.
+ */
+template<typename TStr>
+void KarkkainenBlockwiseSA<TStr>::spillBuckets() {
+	closeSpill();
+	TIndexOffU len = (TIndexOffU)this->text().length();
+	_spill = fopen(_spillFn.c_str(), "w+b");
+	if(_spill == NULL) {
+		cerr << "Could not open temporary bucket file \"" << _spillFn << "\" for writing." << endl
+		     << "Please make sure the directory exists and that permissions allow writing by" << endl
+		     << "Bowtie." << endl;
+		throw 1;
+	}
+	// Buffer about one bucket's worth of suffixes at a time
+	size_t bufSz = max<size_t>(this->bucketSz(), 1024 * 1024);
+	bufSz = min<size_t>(bufSz, len);
+	EList<TIndexOffU> offs(EBWTB_CAT), bkts(EBWTB_CAT), sorted(EBWTB_CAT);
+	try {
+		offs.reserveExact(bufSz);
+		bkts.reserveExact(bufSz);
+		sorted.reserveExact(bufSz);
+	} catch(bad_alloc &e) {
+		if(this->_passMemExc) {
+			throw e; // rethrow immediately
+		} else {
+			cerr << "Could not allocate bucket spill buffers of " << (bufSz * 3 * OFF_SIZE) << " bytes" << endl
+			     << "Please try using a larger number of blocks by specifying a smaller --bmax or" << endl
+			     << "a larger --bmaxdivn" << endl;
+			throw 1;
+		}
+	}
+	Timer timer(cout, "  Classifying suffixes into buckets time: ", this->verbose());
+	VMSG_NL("  Classifying suffixes into " << (_sampleSuffs.size()+1) << " buckets:");
+	TIndexOffU lenDiv10 = (len + 9) / 10;
+	for(TIndexOffU iten = 0, ten = 0; iten < len; iten += lenDiv10, ten++) {
+		TIndexOffU itenNext = iten + lenDiv10;
+		if(ten > 0) VMSG_NL("  " << (ten * 10) << "%");
+		for(TIndexOffU i = iten; i < itenNext && i < len; i++) {
+			TIndexOffU b = bucketOf(i);
+			if(b == OFF_MASK) continue; // i is a sample
+			offs.push_back(i);
+			bkts.push_back(b);
+			if(offs.size() == bufSz) {
+				flushSpill(offs, bkts, sorted);
+			}
+		}
+	}
+	if(!offs.empty()) {
+		flushSpill(offs, bkts, sorted);
+	}
+	fflush(_spill);
+	VMSG_NL("  100%");
+}
+
+/**
+ * Read the members of bucket _cur back from the spill file.
+ */
+template<typename TStr>
+void KarkkainenBlockwiseSA<TStr>::readSpill(EList<TIndexOffU>& bucket) {
+	assert(_spill != NULL);
+	size_t stride = _sampleSuffs.size()+2;
+	size_t nflush = _spillIdx.size() / stride;
+	assert_eq(0, _spillIdx.size() % stride);
+	size_t sz = 0;
+	for(size_t f = 0; f < nflush; f++) {
+		const uint64_t *idx = _spillIdx.ptr() + f * stride;
+		sz += (size_t)(idx[_cur+1] - idx[_cur]);
+	}
+	try {
+		bucket.resize(sz);
+	} catch(bad_alloc &e) {
+		if(this->_passMemExc) {
+			throw e; // rethrow immediately
+		} else {
+			cerr << "Could not allocate a suffix-array block of " << (sz * OFF_SIZE) << " bytes" << endl
+			     << "Please try using a larger number of blocks by specifying a smaller --bmax or" << endl
+			     << "a larger --bmaxdivn" << endl;
+			throw 1;
+		}
+	}
+	Timer timer(cout, "  Reading spilled block time: ", this->verbose());
+	VMSG_NL("  Reading " << sz << " spilled suffixes");
+	size_t got = 0;
+	for(size_t f = 0; f < nflush; f++) {
+		const uint64_t *idx = _spillIdx.ptr() + f * stride;
+		size_t n = (size_t)(idx[_cur+1] - idx[_cur]);
+		if(n == 0) continue;
+		if(fseeko(_spill, (off_t)(idx[_cur] * sizeof(TIndexOffU)), SEEK_SET) != 0 ||
+		   fread(bucket.ptr() + got, sizeof(TIndexOffU), n, _spill) != n)
+		{
+			cerr << "Could not read " << (n * sizeof(TIndexOffU))
+			     << " bytes back from temporary bucket file " << _spillFn << endl;
+			throw 1;
+		}
+		got += n;
+	}
+	assert_eq(sz, got);
+}
+
 /**
  * Retrieve the next block.  This is the most performance-critical part
  * of the blockwise suffix sorting process.
@@ -808,6 +1020,19 @@ void KarkkainenBlockwiseSA<TStr>::nextBlock() {
 				throw 1;
 			}
 		}
+	} else if(!_spillFn.empty()) {
+		// One-pass mode: classify all suffixes up front, then just read
+		// this bucket's members back
+		if(_cur == 0 || _spill == NULL) {
+			spillBuckets();
+		}
+		if(_cur > 0) {
+			lo = _sampleSuffs[_cur-1];
+		}
+		if(_cur < _sampleSuffs.size()) {
+			hi = _sampleSuffs[_cur];
+		}
+		readSpill(bucket);
 	} else {
 		try {
 			VMSG_NL("  Reserving size (" << this->bucketSz() << ") for bucket");
@@ -934,6 +1159,378 @@ void KarkkainenBlockwiseSA<TStr>::nextBlock() {
 	}
 	VMSG_NL("Returning block of " << bucket.size());
 	_cur++; // advance to next bucket
+	if(!hasMoreBlocks()) {
+		closeSpill(); // done with the spill file, if any
+	}
+}
+
+/**
+ * Set sa to the sorted suffixes of t starting at or after off, including
+ * the '$' suffix (which comes last), using induced sorting.
+ *
+ * SA-IS treats the end of the text as the smallest character, whereas the
+ * Ebwt treats it as the largest.  Sorting the text with its alphabet
+ * complemented and the end-of-text smallest yields exactly the reverse of
+ * the order we want, so we do that and reverse the result.
+ */
+template<typename TStr>
+static void saisSortSuffixes(
+	const TStr& t,
+	TIndexOffU off,
+	EList<TIndexOffU>& sa)
+{
+	TIndexOffU len = (TIndexOffU)t.length();
+	assert_leq(off, len);
+	TIndexOffU n = len - off;
+	{
+		// Complement the alphabet so 0 is free for the end-of-text
+		AutoArray<uint8_t> s(n+1, EBWTB_CAT);
+		for(TIndexOffU i = 0; i < n; i++) {
+			assert_lt((int)t[off+i], 4);
+			s[i] = (uint8_t)(4 - (int)t[off+i]);
+		}
+		s[n] = 0;
+		sa.resizeExact(n+1);
+		saisSort<uint8_t>(&s[0], sa.ptr(), n+1, 4);
+	}
+	assert_eq(n, sa[0]);
+	sa.reverse();
+	if(off > 0) {
+		for(size_t i = 0; i <= n; i++) {
+			sa[i] += off;
+		}
+	}
+}
+
+/**
+ * Build the entire SA at once by induced sorting (SA-IS) and dole it out
+ * as a single block.  Takes time linear in the length of the text, but
+ * needs the whole SA (plus a byte per text character) in memory at once.
+ */
+template<typename TStr>
+class SaisBlockwiseSA : public InorderBlockwiseSA<TStr> {
+public:
+	SaisBlockwiseSA(const TStr& __text,
+	                bool __sanityCheck = false,
+	                bool __passMemExc = false,
+	                bool __verbose = false,
+	                ostream& __logger = cout) :
+	InorderBlockwiseSA<TStr>(__text, (TIndexOffU)__text.length()+1, __sanityCheck, __passMemExc, __verbose, __logger),
+	_done(false)
+	{ }
+
+	/// Largest peak footprint, in bytes, at which SA-IS is used by default
+	static const size_t autoMaxBytes = (size_t)2 * 1024 * 1024 * 1024 - 1;
+
+	/**
+	 * Return the approximate peak number of bytes SA-IS needs for a text
+	 * of the given length: the SA, the complemented text and the S/L
+	 * type bits.
+	 */
+	static size_t footprint(size_t len) {
+		len++;
+		return len * sizeof(TIndexOffU) + len + (len >> 3);
+	}
+
+	/**
+	 * Allocate an amount of memory that simulates the peak memory usage of
+	 * SA-IS on the given text.  Throws bad_alloc if it's not going to fit.
+	 * Returns the number of bytes allocated.
+	 */
+	static size_t simulateAllocs(const TStr& text) {
+		size_t sz = footprint(text.length()) + (1024 * 1024 /*out of caution*/);
+		AutoArray<uint8_t> tmp(sz, EBWT_CAT);
+		return sz;
+	}
+
+	/// Defined below
+	virtual void nextBlock();
+
+	/// Return true iff more blocks are available
+	virtual bool hasMoreBlocks() const {
+		return !_done;
+	}
+
+protected:
+
+	/// Reset back to the first (and only) block
+	virtual void reset() {
+		_done = false;
+	}
+
+	/// Return true iff reset to the first block
+	virtual bool isReset() {
+		return !_done;
+	}
+
+private:
+
+	bool _done; // true iff the SA has been handed out
+};
+
+/**
+ * Compute the whole SA, including the $ suffix at the end, into the
+ * iterator's bucket.
+ */
+template<typename TStr>
+void SaisBlockwiseSA<TStr>::nextBlock() {
+	assert(!_done);
+	const TStr& t = this->text();
+	TIndexOffU len = (TIndexOffU)t.length();
+	EList<TIndexOffU>& bucket = this->_itrBucket;
+	VMSG_NL("Building suffix array by induced sorting for text of length " << len);
+	{
+		Timer timer(cout, "  SA-IS time: ", this->verbose());
+		saisSortSuffixes(t, 0, bucket);
+	}
+	assert_eq(len, bucket.back());
+	if(this->sanityCheck()) {
+		for(TIndexOffU i = 0; i < len; i++) {
+			assert(sstr_suf_lt(t, bucket[i], t, bucket[i+1], false));
+		}
+	}
+	VMSG_NL("Returning block of " << bucket.size());
+	_done = true;
+}
+
+/**
+ * Sort the suffixes starting in the first 'added' characters of t, which
+ * were prepended to a base text, into 'sufs', given where each falls among
+ * the base text's suffixes (ins[]) and the base SA row of the base text as
+ * a whole (r0).  A new suffix is determined by its own (ins, character)
+ * pair followed by those of the suffixes after it, ending with the base
+ * text, which goes before a suffix iff that suffix falls after row r0.  So
+ * we give every new position the rank of its pair and the base text a
+ * unique rank between the pairs with ins <= r0 and those after, and sort
+ * the resulting string by induced sorting.  Unlike comparing suffixes
+ * character by character, this doesn't degrade on repetitive sequences.
+ */
+template<typename TStr>
+static void sortPrependedSufs(
+	const TStr& t,
+	const EList<TIndexOffU>& ins,
+	TIndexOffU added,
+	TIndexOffU r0,
+	EList<TIndexOffU>& sufs)
+{
+	// Codes of the pairs and of the base text; 5 > any character
+	EList<uint64_t> codes(EBWTB_CAT);
+	codes.resizeExact(added+1);
+	for(TIndexOffU i = 0; i < added; i++) {
+		assert_lt((int)t[i], 4);
+		codes[i] = (uint64_t)ins[i] * 5 + (int)t[i];
+	}
+	codes[added] = (uint64_t)r0 * 5 + 4;
+	EList<uint64_t> names(EBWTB_CAT);
+	names = codes;
+	names.sort();
+	size_t nnames = std::unique(names.ptr(), names.ptr() + names.size()) - names.ptr();
+	// Rank each code, leaving 0 for a sentinel after the base text
+	AutoArray<TIndexOffU> x(added+2, EBWTB_CAT);
+	for(TIndexOffU i = 0; i <= added; i++) {
+		x[i] = (TIndexOffU)(std::lower_bound(names.ptr(), names.ptr() + nnames, codes[i]) - names.ptr()) + 1;
+	}
+	x[added+1] = 0;
+	codes.clear();
+	names.clear();
+	sufs.resizeExact(added+2);
+	saisSort<TIndexOffU>(&x[0], sufs.ptr(), added+2, (TIndexOffU)nnames);
+	// Drop the sentinel (first) and the base text
+	assert_eq(added+1, sufs[0]);
+	size_t w = 0;
+	for(size_t i = 1; i < sufs.size(); i++) {
+		if(sufs[i] != added) sufs[w++] = sufs[i];
+	}
+	sufs.resize(w);
+	assert_eq(added, sufs.size());
+}
+
+/**
+ * Build the SA of a text made by adding sequences to the text of an
+ * existing index, given that index's full suffix array ("base SA"), and
+ * dole it out as a single block.  Base suffixes whose relative order
+ * can't have changed are kept as they are; the rest are sorted and then
+ * merged in by binary search.
+ *
+ * If the sequences were prepended (as for the mirror index), every base
+ * suffix is unchanged.  The new suffixes are placed by binary search and
+ * ordered among themselves with sortPrependedSufs.  If they were appended,
+ * two base suffixes can only change order if one is a prefix of the
+ * other, i.e. if the shorter is a suffix of the base text that also
+ * occurs elsewhere in it.  So we find a length u such that the base
+ * text's suffix of length u occurs nowhere else, and re-sort the base
+ * suffixes shorter than u together with the new ones, by induced sorting.
+ */
+template<typename TStr>
+class MergedBlockwiseSA : public InorderBlockwiseSA<TStr> {
+public:
+	MergedBlockwiseSA(const TStr& __text,
+	                  EList<TIndexOffU>& __baseSA,
+	                  bool __prepended,
+	                  bool __sanityCheck = false,
+	                  bool __passMemExc = false,
+	                  bool __verbose = false,
+	                  ostream& __logger = cout) :
+	InorderBlockwiseSA<TStr>(__text, (TIndexOffU)__text.length()+1, __sanityCheck, __passMemExc, __verbose, __logger),
+	_baseSA(__baseSA),
+	_prepended(__prepended),
+	_done(false)
+	{
+		assert_gt(_baseSA.size(), 0);
+		assert_leq(_baseSA.size(), __text.length()+1);
+	}
+
+	/// Defined below
+	virtual void nextBlock();
+
+	/// Return true iff more blocks are available
+	virtual bool hasMoreBlocks() const {
+		return !_done;
+	}
+
+protected:
+
+	/// Reset back to the first (and only) block; the base SA is gone
+	/// once it's been handed out, so this can't be done twice
+	virtual void reset() {
+		assert(!_done);
+	}
+
+	/// Return true iff reset to the first block
+	virtual bool isReset() {
+		return !_done;
+	}
+
+	/// Defined below
+	TIndexOffU uniqueTailLen() const;
+
+private:
+
+	EList<TIndexOffU>& _baseSA; // consumed by nextBlock()
+	bool _prepended;            // true -> new seqs precede the base text
+	bool _done;                 // true iff the SA has been handed out
+};
+
+/**
+ * Return a power of two u such that the suffix of the base text of
+ * length u occurs nowhere else in the base text, or the base text length
+ * if there's no such u.  A suffix P of the base text occurs elsewhere iff
+ * the base SA row just before P's row is for a suffix starting with P,
+ * since '$' sorts last.
+ */
+template<typename TStr>
+TIndexOffU MergedBlockwiseSA<TStr>::uniqueTailLen() const {
+	const TStr& t = this->text();
+	TIndexOffU n0 = (TIndexOffU)_baseSA.size()-1;
+	// Rows of the base suffixes of length 1, 2, 4, ...
+	EList<TIndexOffU> rows(EBWTB_CAT);
+	for(TIndexOffU r = 0; r < n0; r++) {
+		TIndexOffU l = n0 - _baseSA[r];
+		if((l & (l-1)) == 0) {
+			size_t k = 0;
+			while(((TIndexOffU)1 << k) < l) k++;
+			if(rows.size() <= k) rows.resize(k+1);
+			rows[k] = r;
+		}
+	}
+	for(size_t k = 0; k < rows.size(); k++) {
+		TIndexOffU l = (TIndexOffU)1 << k;
+		TIndexOffU r = rows[k];
+		if(r == 0 || _baseSA[r-1] + l > n0) {
+			return l;
+		}
+		TIndexOffU prev = _baseSA[r-1];
+		for(TIndexOffU i = 0; i < l; i++) {
+			if(t[prev+i] != t[n0-l+i]) {
+				return l;
+			}
+		}
+	}
+	return n0;
+}
+
+/**
+ * Merge the sorted new suffixes into the base SA and hand the result
+ * over to the iterator's bucket.
+ */
+template<typename TStr>
+void MergedBlockwiseSA<TStr>::nextBlock() {
+	assert(!_done);
+	const TStr& t = this->text();
+	TIndexOffU len = (TIndexOffU)t.length();
+	TIndexOffU n0 = (TIndexOffU)_baseSA.size()-1;
+	TIndexOffU added = len - n0;
+	EList<TIndexOffU> sufs(EBWTB_CAT); // suffixes to merge in, sorted
+	EList<TIndexOffU> ins(EBWTB_CAT);  // where each goes in the base SA
+	{
+		Timer timer(cout, "  Sorting and placing new suffixes time: ", this->verbose());
+		if(_prepended) {
+			VMSG_NL("Merging " << added << " new suffixes in front of " << n0 << " existing ones");
+			// Shift base offsets past the new sequences ('$' row included)
+			TIndexOffU r0 = OFF_MASK;
+			for(size_t i = 0; i < _baseSA.size(); i++) {
+				_baseSA[i] += added;
+				if(_baseSA[i] == added) r0 = (TIndexOffU)i;
+			}
+			assert_neq(OFF_MASK, r0);
+			EList<TIndexOffU> insByOff(EBWTB_CAT);
+			insByOff.resizeExact(added);
+			for(TIndexOffU i = 0; i < added; i++) {
+				insByOff[i] = binarySASearch(t, i, _baseSA);
+				assert_neq(OFF_MASK, insByOff[i]);
+			}
+			sortPrependedSufs(t, insByOff, added, r0, sufs);
+			ins.resizeExact(added);
+			for(TIndexOffU i = 0; i < added; i++) {
+				ins[i] = insByOff[sufs[i]];
+			}
+		} else {
+			TIndexOffU u = uniqueTailLen();
+			VMSG_NL("Merging " << added << " new suffixes and " << u << " re-sorted ones into " << n0 << " existing ones");
+			// Drop base suffixes of length <= u, and the '$' row
+			size_t nkeep = 0;
+			for(size_t i = 0; i < _baseSA.size(); i++) {
+				if(_baseSA[i] < n0 - u) {
+					_baseSA[nkeep++] = _baseSA[i];
+				}
+			}
+			_baseSA.resize(nkeep);
+			saisSortSuffixes(t, n0 - u, sufs);
+			assert_eq(len, sufs.back());
+			sufs.pop_back(); // '$' goes last; placed below
+			ins.resizeExact(sufs.size());
+			for(size_t i = 0; i < sufs.size(); i++) {
+				ins[i] = binarySASearch(t, sufs[i], _baseSA);
+				assert_neq(OFF_MASK, ins[i]);
+			}
+		}
+	}
+	// Merge from the right, in place
+	size_t nbase = _baseSA.size();
+	size_t w = len + 1;
+	_baseSA.resizeExact(w);
+	if(!_prepended) {
+		_baseSA[--w] = len;
+	}
+	for(size_t j = sufs.size(); j > 0; j--) {
+		assert(j == 1 || ins[j-1] >= ins[j-2]);
+		while(nbase > ins[j-1]) {
+			_baseSA[--w] = _baseSA[--nbase];
+		}
+		_baseSA[--w] = sufs[j-1];
+	}
+	assert_eq(w, nbase);
+	EList<TIndexOffU>& bucket = this->_itrBucket;
+	bucket.xfer(_baseSA);
+	assert_eq(len+1, bucket.size());
+	assert_eq(len, bucket.back());
+	if(this->sanityCheck()) {
+		for(TIndexOffU i = 0; i < len; i++) {
+			assert(sstr_suf_lt(t, bucket[i], t, bucket[i+1], false));
+		}
+	}
+	VMSG_NL("Returning block of " << bucket.size());
+	_done = true;
 }
 
 #endif /*BLOCKWISE_SA_H_*/
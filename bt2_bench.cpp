@@ -0,0 +1,735 @@
+/*
+ * Copyright 2011, Ben Langmead <langmea@cs.jhu.edu>
+ *
+ * This file is part of Bowtie 2.
+ *
+ * Bowtie 2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bowtie 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bowtie 2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * bt2_bench.cpp
+ *
+ * Throughput benchmark for the stages of the aligner.  Reads are simulated
+ * deterministically from the reference of an existing index (substitutions
+ * and short indels, half of them reverse complemented), then each stage is
+ * driven directly and timed on its own:
+ *
+ *   getStretch      fetching reference stretches from the bitpair reference
+ *   exactSweep      end-to-end exact-match sweep
+ *   searchAllSeeds  seed search in the FM index
+ *   groupWalk       resolving seed-hit SA elements to reference offsets
+ *   sse_*           filling the DP matrix with each SSE kernel
+ *   bt_*            backtracing from the filled matrix
+ *   samFormat       formatting SAM records
+ *
+ * Results are written as tab-separated text with one row per stage, so that
+ * runs can be compared by a script.  'make bench' builds a synthetic
+ * reference and index with --make-ref and runs the benchmark against it.
+ */
+
+#include <getopt.h>
+#include <sys/time.h>
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include "assert_helpers.h"
+#include "ds.h"
+#include "alphabet.h"
+#include "simple_func.h"
+#include "scoring.h"
+#include "random_source.h"
+#include "reference.h"
+#include "bt2_idx.h"
+#include "read.h"
+#include "aligner_seed.h"
+#include "aligner_cache.h"
+#include "group_walk.h"
+#include "dp_framer.h"
+#include "aligner_sw.h"
+#include "aln_sink.h"
+#include "outq.h"
+#include "sam.h"
+#include "unique.h"
+#include "filebuf.h"
+#include "search_globals.h"
+
+using namespace std;
+
+// Globals normally defined by the bowtie2-align driver
+bool gColor;
+bool gColorExEnds;
+bool gReportOverhangs;
+bool gColorSeq;
+bool gColorEdit;
+bool gColorQual;
+bool gNoMaqRound;
+bool gStrandFix;
+bool gRangeMode;
+int  gVerbose;
+int  gQuiet;
+bool gNofw;
+bool gNorc;
+bool gMate1fw;
+bool gMate2fw;
+int  gMinInsert;
+int  gMaxInsert;
+int  gTrim5;
+int  gTrim3;
+int  gGapBarrier;
+int  gAllowRedundant;
+
+static string   idxBase;   // index to benchmark against
+static string   outfile;   // write TSV here (default: stdout)
+static size_t   nreads;    // # reads to simulate
+static size_t   rdlen;     // length of simulated reads
+static uint32_t seed;      // pseudo-random seed
+static size_t   makeRef;   // write a synthetic reference of this length
+static int      seedLen;   // seed length for searchAllSeeds
+static bool     showUsage; // print usage and quit
+
+enum {
+	ARG_SEED = 256,
+	ARG_MAKE_REF,
+	ARG_SEED_LEN
+};
+
+static void resetOptions() {
+	gColor           = false;
+	gColorExEnds     = true;
+	gReportOverhangs = false;
+	gColorSeq        = false;
+	gColorEdit       = false;
+	gColorQual       = false;
+	gNoMaqRound      = false;
+	gStrandFix       = true;
+	gRangeMode       = false;
+	gVerbose         = 0;
+	gQuiet           = true;
+	gNofw            = false;
+	gNorc            = false;
+	gMate1fw         = true;
+	gMate2fw         = false;
+	gMinInsert       = 0;
+	gMaxInsert       = 500;
+	gTrim5           = 0;
+	gTrim3           = 0;
+	gGapBarrier      = 4;
+	gAllowRedundant  = 0;
+	idxBase.clear();
+	outfile.clear();
+	nreads    = 20000;
+	rdlen     = 150;
+	seed      = 0;
+	makeRef   = 0;
+	seedLen   = 22;
+	showUsage = false;
+}
+
+static const char *short_options = "x:n:l:o:h";
+
+static struct option long_options[] = {
+	{(char*)"index",    required_argument, 0, 'x'},
+	{(char*)"reads",    required_argument, 0, 'n'},
+	{(char*)"length",   required_argument, 0, 'l'},
+	{(char*)"output",   required_argument, 0, 'o'},
+	{(char*)"seed",     required_argument, 0, ARG_SEED},
+	{(char*)"seed-len", required_argument, 0, ARG_SEED_LEN},
+	{(char*)"make-ref", required_argument, 0, ARG_MAKE_REF},
+	{(char*)"help",     no_argument,       0, 'h'},
+	{(char*)0, 0, 0, 0} // terminator
+};
+
+/**
+ * Print a summary usage message to the provided output stream.
+ */
+static void printUsage(ostream& out) {
+	out << "Bowtie 2 per-stage throughput benchmark" << endl
+	    << "Usage: " << endl
+	    << "  bowtie2-bench [options]* -x <bt2-idx>" << endl
+	    << "  bowtie2-bench --make-ref <int> <out.fa>" << endl
+	    << endl
+	    << "Options (defaults in parentheses):" << endl
+	    << "  -x/--index <str>   index to align simulated reads against" << endl
+	    << "  -n/--reads <int>   # reads to simulate (20000)" << endl
+	    << "  -l/--length <int>  length of simulated reads (150)" << endl
+	    << "  -o/--output <str>  write per-stage TSV here (stdout)" << endl
+	    << "  --seed <int>       seed for pseudo-random generator (0)" << endl
+	    << "  --seed-len <int>   length of seeds (22)" << endl
+	    << "  --make-ref <int>   write a synthetic FASTA reference with <int>" << endl
+	    << "                     bases to <out.fa> and quit" << endl
+	    << "  -h/--help          print this usage message" << endl
+	    ;
+}
+
+template<typename T>
+static T parseNum(const char *arg, T lower, const char *errmsg) {
+	char *endPtr = NULL;
+	long long l = strtoll(arg, &endPtr, 10);
+	if(endPtr == arg || *endPtr != '\0' || l < (long long)lower) {
+		cerr << errmsg << endl;
+		printUsage(cerr);
+		throw 1;
+	}
+	return (T)l;
+}
+
+static void parseOptions(int argc, const char **argv) {
+	int option_index = 0;
+	int next_option;
+	while(true) {
+		next_option = getopt_long(
+			argc, const_cast<char**>(argv),
+			short_options, long_options, &option_index);
+		const char *arg = optarg;
+		if(next_option == EOF) {
+			break;
+		}
+		switch(next_option) {
+			case 'x': idxBase = arg; break;
+			case 'o': outfile = arg; break;
+			case 'n': nreads = parseNum<size_t>(arg, 1, "-n/--reads arg must be at least 1"); break;
+			case 'l': rdlen = parseNum<size_t>(arg, 32, "-l/--length arg must be at least 32"); break;
+			case ARG_SEED: seed = parseNum<uint32_t>(arg, 0, "--seed arg must be non-negative"); break;
+			case ARG_SEED_LEN: seedLen = parseNum<int>(arg, 4, "--seed-len arg must be at least 4"); break;
+			case ARG_MAKE_REF: makeRef = parseNum<size_t>(arg, 1000, "--make-ref arg must be at least 1000"); break;
+			case 'h': showUsage = true; break;
+			default:
+				printUsage(cerr);
+				throw 1;
+		}
+	}
+}
+
+/**
+ * Accumulated timings for one stage.
+ */
+struct BenchStage {
+
+	BenchStage() { reset(NULL, NULL); }
+
+	void reset(const char *nm, const char *un) {
+		name = nm;
+		unit = un;
+		calls = work = usecs = 0;
+	}
+
+	const char *name;  // stage name
+	const char *unit;  // what 'work' counts
+	uint64_t    calls; // # timed calls
+	uint64_t    work;  // units of work done in those calls
+	uint64_t    usecs; // total microseconds spent
+};
+
+enum {
+	STAGE_GET_STRETCH = 0,
+	STAGE_EXACT_SWEEP,
+	STAGE_SEARCH_SEEDS,
+	STAGE_GROUP_WALK,
+	STAGE_SSE_EE_U8,
+	STAGE_SSE_EE_I16,
+	STAGE_SSE_LOC_U8,
+	STAGE_SSE_LOC_I16,
+	STAGE_BT_EE_U8,
+	STAGE_BT_EE_I16,
+	STAGE_BT_LOC_U8,
+	STAGE_BT_LOC_I16,
+	STAGE_SAM,
+	STAGE_NUM
+};
+
+static inline uint64_t benchUsecs() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (uint64_t)tv.tv_sec * 1000000 + (uint64_t)tv.tv_usec;
+}
+
+/**
+ * Write a synthetic reference with 'len' bases, split over four sequences,
+ * to 'fn'.  About a tenth of it is made of diverged copies of earlier
+ * stretches, so that some seeds hit more than one place.
+ */
+static void writeSyntheticRef(const string& fn, size_t len, uint32_t sd) {
+	static const char *acgt = "ACGT";
+	RandomSource rnd(sd);
+	string seq;
+	seq.reserve(len);
+	while(seq.length() < len) {
+		if(seq.length() > 10000 && rnd.nextU32() % 10 == 0) {
+			// Diverged copy of an earlier 1-5 kbp stretch
+			size_t cplen = 1000 + rnd.nextU32() % 4000;
+			size_t cpoff = rnd.nextSizeT() % (seq.length() - cplen);
+			for(size_t i = 0; i < cplen && seq.length() < len; i++) {
+				char c = seq[cpoff + i];
+				if(rnd.nextU32() % 50 == 0) c = acgt[rnd.nextU2()];
+				seq.push_back(c);
+			}
+		} else {
+			for(size_t i = 0; i < 5000 && seq.length() < len; i++) {
+				seq.push_back(acgt[rnd.nextU2()]);
+			}
+		}
+	}
+	ofstream out(fn.c_str());
+	if(!out.good()) {
+		cerr << "Error: could not open " << fn.c_str() << " for writing" << endl;
+		throw 1;
+	}
+	const size_t nseqs = 4;
+	for(size_t i = 0; i < nseqs; i++) {
+		size_t beg = len * i / nseqs, end = len * (i+1) / nseqs;
+		out << ">bench" << (i+1) << endl;
+		for(size_t j = beg; j < end; j += 60) {
+			out << seq.substr(j, min<size_t>(60, end - j)) << endl;
+		}
+	}
+}
+
+/**
+ * Where a simulated read came from.
+ */
+struct SimOrigin {
+	TRefId  tidx;
+	TRefOff toff;
+	bool    fw;
+};
+
+/**
+ * Simulate one read of length 'len' from a random place in 'ref'.  Reads
+ * carry ~1% substitutions and, one time in ten, a short indel; half are
+ * reverse complemented.  Returns false if the stretch drawn overlapped an
+ * ambiguous reference character.
+ */
+static bool simulateRead(
+	const BitPairReference& ref,
+	const EList<TRefOff>& reflens,
+	size_t len,
+	RandomSource& rnd,
+	SStringExpandable<uint32_t>& buf,
+	ASSERT_ONLY(SStringExpandable<uint32_t>& buf2,)
+	BenchStage& st,
+	string& seq,
+	SimOrigin& orig)
+{
+	static const char *acgt = "ACGT";
+	const size_t slack = 8;
+	TRefId tidx = (TRefId)(rnd.nextU32() % reflens.size());
+	if((size_t)reflens[tidx] < len + slack) {
+		return false;
+	}
+	TRefOff toff = (TRefOff)(rnd.nextSizeT() % (reflens[tidx] - len - slack));
+	const size_t count = len + slack;
+	buf.resize((count >> 2) + 16);
+	uint64_t t0 = benchUsecs();
+	int off = ref.getStretch(
+		reinterpret_cast<uint32_t*>(buf.wbuf()),
+		(size_t)tidx,
+		(size_t)toff,
+		count
+		ASSERT_ONLY(, buf2));
+	st.usecs += benchUsecs() - t0;
+	st.calls++;
+	st.work += count;
+	const uint8_t *bases = reinterpret_cast<const uint8_t*>(buf.wbuf()) + off;
+	seq.clear();
+	for(size_t i = 0; seq.length() < len && i < count; i++) {
+		int c = bases[i];
+		if(c > 3) {
+			return false;
+		}
+		if(i > len / 3 && seq.length() < 2 * len / 3 && rnd.nextU32() % (len * 10) == 0) {
+			// Short indel in the middle of the read
+			size_t ilen = 1 + rnd.nextU2();
+			if(rnd.nextU2() & 1) {
+				for(size_t j = 0; j < ilen; j++) seq.push_back(acgt[rnd.nextU2()]);
+			} else {
+				i += ilen;
+				continue;
+			}
+		}
+		if(rnd.nextU32() % 100 == 0) {
+			c = (c + 1 + (rnd.nextU32() % 3)) & 3;
+		}
+		seq.push_back(acgt[c]);
+	}
+	if(seq.length() < len) {
+		return false;
+	}
+	seq.resize(len);
+	orig.tidx = tidx;
+	orig.toff = toff;
+	orig.fw = (rnd.nextU2() & 1) == 0;
+	if(!orig.fw) {
+		// Reverse complement; the read then aligns to the reverse strand
+		string rc;
+		for(size_t i = len; i-- > 0;) {
+			rc.push_back(acgt[3 - asc2dna[(int)seq[i]]]);
+		}
+		seq.swap(rc);
+	}
+	return true;
+}
+
+/**
+ * Print the table of per-stage timings.
+ */
+static void printStages(ostream& out, const BenchStage *st, size_t n) {
+	out << "#stage\tcalls\twork\twork_unit\tsecs\tns_per_call\twork_per_sec" << endl;
+	out << fixed;
+	for(size_t i = 0; i < n; i++) {
+		double secs = st[i].usecs / 1000000.0;
+		double nsPer = st[i].calls > 0 ? (st[i].usecs * 1000.0 / st[i].calls) : 0.0;
+		double rate = st[i].usecs > 0 ? (st[i].work / secs) : 0.0;
+		out << st[i].name << '\t'
+		    << st[i].calls << '\t'
+		    << st[i].work << '\t'
+		    << st[i].unit << '\t'
+		    << setprecision(6) << secs << '\t'
+		    << setprecision(1) << nsPer << '\t'
+		    << setprecision(1) << rate << endl;
+	}
+}
+
+/**
+ * Simulate reads from the index and time every stage on them.
+ */
+static void runBench(ostream& out) {
+	Ebwt ebwtFw(idxBase, 0, -1, true, -1, 0, false, false, false,
+	            true, true, true, true, false, false, false, false);
+	Ebwt ebwtBw(idxBase + ".rev", 0, 1, false, -1, 0, false, false, false,
+	            true, true, true, true, false, false, false, false);
+	ebwtFw.loadIntoMemory(0, -1, true, true, true, true, false);
+	ebwtBw.loadIntoMemory(0, 1, false, true, false, true, false);
+	BitPairReference ref(idxBase, false);
+	if(!ref.loaded()) throw 1;
+	EList<TRefOff> reflens;
+	for(size_t i = 0; i < ebwtFw.nPat(); i++) {
+		reflens.push_back((TRefOff)ebwtFw.plen()[i]);
+	}
+	EList<string> refnames;
+	readEbwtRefnames(idxBase, refnames);
+
+	// Scoring schemes and minimum scores for end-to-end and local mode
+	SimpleFunc scoreMinEe, scoreMinLoc, nCeil;
+	scoreMinEe.init (SIMPLE_FUNC_LINEAR, DEFAULT_MIN_CONST, DEFAULT_MIN_LINEAR);
+	scoreMinLoc.init(SIMPLE_FUNC_LOG, 20.0f, 8.0f);
+	nCeil.init      (SIMPLE_FUNC_LINEAR, 0.0f, std::numeric_limits<double>::max(), 2.0f, 0.1f);
+	Scoring scEe(
+		DEFAULT_MATCH_BONUS, DEFAULT_MM_PENALTY_TYPE,
+		DEFAULT_MM_PENALTY_MAX, DEFAULT_MM_PENALTY_MIN,
+		scoreMinEe, nCeil, DEFAULT_N_PENALTY_TYPE, DEFAULT_N_PENALTY,
+		DEFAULT_N_CAT_PAIR, DEFAULT_READ_GAP_CONST, DEFAULT_REF_GAP_CONST,
+		DEFAULT_READ_GAP_LINEAR, DEFAULT_REF_GAP_LINEAR, gGapBarrier);
+	Scoring scLoc(
+		DEFAULT_MATCH_BONUS_LOCAL, DEFAULT_MM_PENALTY_TYPE,
+		DEFAULT_MM_PENALTY_MAX, DEFAULT_MM_PENALTY_MIN,
+		scoreMinLoc, nCeil, DEFAULT_N_PENALTY_TYPE, DEFAULT_N_PENALTY,
+		DEFAULT_N_CAT_PAIR, DEFAULT_READ_GAP_CONST, DEFAULT_REF_GAP_CONST,
+		DEFAULT_READ_GAP_LINEAR, DEFAULT_REF_GAP_LINEAR, gGapBarrier);
+
+	// SAM output machinery, writing to a throwaway buffer
+	EList<size_t> samlens;
+	for(size_t i = 0; i < reflens.size(); i++) {
+		samlens.push_back((size_t)reflens[i]);
+	}
+	SamConfig samc(
+		refnames,               // reference sequence names
+		samlens,                // reference sequence lengths
+		false,                  // whether to truncate QNAME to 255 chars
+		false,                  // omit SEQ/QUAL for 2ndary alignments?
+		false,                  // omit unaligned-read records?
+		string("bowtie2"),      // program id
+		string("bowtie2"),      // program name
+		string(BOWTIE2_VERSION), // program version
+		string(""),             // command-line
+		string(""),             // read-group string
+		true,                   // AS
+		true,                   // XS
+		false,                  // XSS
+		false,                  // YN
+		true,                   // XN
+		false,                  // CS
+		false,                  // CQ
+		true,                   // X0
+		true,                   // X1
+		true,                   // XM
+		true,                   // XO
+		true,                   // XG
+		true,                   // NM
+		true,                   // MD
+		true,                   // YF
+		false,                  // YI
+		false,                  // YM
+		false,                  // YP
+		true,                   // YT
+		true,                   // YS
+		false,                  // ZS
+		false,                  // XR
+		false,                  // XT
+		false,                  // XD
+		false,                  // XU
+		false,                  // YE
+		false,                  // YL
+		false,                  // YU
+		false,                  // XP
+		false,                  // YR
+		false,                  // ZB
+		false,                  // ZR
+		false,                  // ZF
+		false,                  // ZM
+		false,                  // ZI
+		false,                  // ZP
+		false,                  // ZU
+		false);                 // ZT
+	OutFileBuf obuf;
+	OutputQueue oq(obuf, false, 1, false, 0);
+	AlnSinkSam sam(oq, samc, refnames, true);
+	auto_ptr<Mapq> mapq(new_mapq(2, scoreMinEe, scEe));
+
+	BenchStage st[STAGE_NUM];
+	st[STAGE_GET_STRETCH].reset("getStretch", "bases");
+	st[STAGE_EXACT_SWEEP].reset("exactSweep", "bases");
+	st[STAGE_SEARCH_SEEDS].reset("searchAllSeeds", "seeds");
+	st[STAGE_GROUP_WALK].reset("groupWalk", "elements");
+	st[STAGE_SSE_EE_U8].reset("sse_ee_u8", "cells");
+	st[STAGE_SSE_EE_I16].reset("sse_ee_i16", "cells");
+	st[STAGE_SSE_LOC_U8].reset("sse_loc_u8", "cells");
+	st[STAGE_SSE_LOC_I16].reset("sse_loc_i16", "cells");
+	st[STAGE_BT_EE_U8].reset("bt_ee_u8", "alignments");
+	st[STAGE_BT_EE_I16].reset("bt_ee_i16", "alignments");
+	st[STAGE_BT_LOC_U8].reset("bt_loc_u8", "alignments");
+	st[STAGE_BT_LOC_I16].reset("bt_loc_i16", "alignments");
+	st[STAGE_SAM].reset("samFormat", "bytes");
+
+	RandomSource simrnd(seed), rnd(seed);
+	SStringExpandable<uint32_t> stbuf;
+	ASSERT_ONLY(SStringExpandable<uint32_t> stbuf2);
+	SeedAligner al;
+	SeedResults shs;
+	SeedSearchMetrics sdm;
+	WalkMetrics wlm;
+	PerReadMetrics prm;
+	AlignmentCache scCurrent(64 * 1024 * 1024, false);
+	AlignmentCacheIface ca(&scCurrent, NULL, NULL);
+	EList<Seed> seeds;
+	EList<SATuple, 16> satups;
+	GroupWalk2S<TSlice, 16> gw;
+	GroupWalkState gwstate(GW_CAT);
+	SwAligner sw(NULL);
+	SwResult res;
+	EList<AlnRes> alns;
+	StackedAln staln;
+	SeedAlSumm ssm;
+	BTString o;
+	DynProgFramer dpframe(!gReportOverhangs);
+	Read rd;
+	string seq, qual(rdlen, 'I');
+	SimOrigin orig;
+	char name[32];
+	size_t nsim = 0;
+	for(TReadId rdid = 0; nsim < nreads; rdid++) {
+		if(!simulateRead(ref, reflens, rdlen, simrnd, stbuf,
+		                 ASSERT_ONLY(stbuf2,) st[STAGE_GET_STRETCH], seq, orig))
+		{
+			continue;
+		}
+		nsim++;
+		snprintf(name, sizeof(name), "r%u", (unsigned)nsim);
+		rd.init(name, seq.c_str(), qual.c_str());
+		rd.rdid = rdid;
+		rd.seed = simrnd.nextU32();
+		rnd.init(rd.seed);
+		prm.reset();
+
+		// Exact end-to-end sweep
+		size_t minedfw = 0, minedrc = 0;
+		shs.clear();
+		shs.nextRead(rd);
+		uint64_t t0 = benchUsecs();
+		al.exactSweep(ebwtFw, rd, scEe, false, false, 2,
+		              minedfw, minedrc, true, shs, sdm);
+		st[STAGE_EXACT_SWEEP].usecs += benchUsecs() - t0;
+		st[STAGE_EXACT_SWEEP].calls++;
+		st[STAGE_EXACT_SWEEP].work += rdlen;
+
+		// Seed search
+		ca.nextRead();
+		shs.clearSeeds();
+		seeds.clear();
+		Constraint gc = Constraint::penaltyFuncBased(scoreMinEe);
+		Seed::mmSeeds(0, seedLen, seeds, gc);
+		int interval = max<int>(1, (int)(1.0 + 1.15 * sqrt((double)rdlen) + 0.5));
+		std::pair<int, int> inst = al.instantiateSeeds(
+			seeds, 0, interval, rd, scEe, false, false, ca, shs, sdm);
+		t0 = benchUsecs();
+		al.searchAllSeeds(seeds, &ebwtFw, &ebwtBw, rd, scEe, ca, shs, sdm, prm);
+		st[STAGE_SEARCH_SEEDS].usecs += benchUsecs() - t0;
+		st[STAGE_SEARCH_SEEDS].calls++;
+		st[STAGE_SEARCH_SEEDS].work += (inst.first + inst.second);
+
+		// Resolve the elements of small seed-hit ranges
+		if(!shs.empty()) {
+			shs.rankSeedHits(rnd, false);
+		}
+		const size_t nonz = shs.empty() ? 0 : shs.nonzeroOffsets();
+		for(size_t i = 0; i < nonz; i++) {
+			bool fw = true;
+			uint32_t offidx = 0, rdoff = 0, seedlen = 0;
+			QVal qv = shs.hitsByRank(i, offidx, rdoff, fw, seedlen);
+			size_t nrange = 0, nelt = 0;
+			satups.clear();
+			ca.queryQval(qv, satups, nrange, nelt);
+			for(size_t j = 0; j < satups.size(); j++) {
+				const size_t sz = satups[j].size();
+				if(sz > 16) {
+					continue;
+				}
+				SARangeWithOffs<TSlice> sa;
+				sa.topf = satups[j].topf;
+				sa.len = satups[j].key.len;
+				sa.offs = satups[j].offs;
+				t0 = benchUsecs();
+				gw.init(ebwtFw, ref, sa, rnd, wlm);
+				for(size_t k = 0; k < sz; k++) {
+					WalkResult wr;
+					gw.advanceElement((TIndexOffU)k, ebwtFw, ref, sa, gwstate, wr, wlm, prm);
+				}
+				st[STAGE_GROUP_WALK].usecs += benchUsecs() - t0;
+				st[STAGE_GROUP_WALK].calls++;
+				st[STAGE_GROUP_WALK].work += sz;
+			}
+		}
+
+		// Fill and backtrace with each SSE kernel, framing the DP problem
+		// around the read's true origin
+		alns.clear();
+		for(int v = 0; v < 4; v++) {
+			const bool local = (v >= 2);
+			const bool use8 = (v % 2) == 0;
+			const Scoring& sc = local ? scLoc : scEe;
+			TAlScore minsc = local ?
+				max<TAlScore>(0, scoreMinLoc.f<TAlScore>((double)rdlen)) :
+				scoreMinEe.f<TAlScore>((double)rdlen);
+			int nceil = min((int)nCeil.f<int>((double)rdlen), (int)rdlen);
+			DPRect rect;
+			if(!dpframe.frameSeedExtensionRect(
+				orig.toff, rdlen, reflens[orig.tidx],
+				sc.maxReadGaps(minsc, rdlen), sc.maxRefGaps(minsc, rdlen),
+				(size_t)nceil, 15, rect))
+			{
+				continue;
+			}
+			size_t nsUpto = 0;
+			sw.initRead(rd.patFw, rd.patRc, rd.qual, rd.qualRev, 0, rdlen, sc);
+			sw.initRef(orig.fw, orig.tidx, rect, ref, reflens[orig.tidx], sc,
+			           minsc, use8, 2000, 4, false, true, 0, nsUpto);
+			TAlScore best = std::numeric_limits<TAlScore>::min();
+			t0 = benchUsecs();
+			bool aligned = sw.align(best);
+			st[STAGE_SSE_EE_U8 + v].usecs += benchUsecs() - t0;
+			st[STAGE_SSE_EE_U8 + v].calls++;
+			st[STAGE_SSE_EE_U8 + v].work +=
+				(uint64_t)rdlen * (uint64_t)(rect.refr - rect.refl + 1);
+			if(!aligned) {
+				continue;
+			}
+			size_t nbt = 0;
+			t0 = benchUsecs();
+			while(!sw.done()) {
+				res.reset();
+				if(!sw.nextAlignment(res, minsc, rnd)) {
+					break;
+				}
+				nbt++;
+				if(v == 0 && alns.empty()) {
+					alns.push_back(res.alres);
+				}
+			}
+			st[STAGE_BT_EE_U8 + v].usecs += benchUsecs() - t0;
+			st[STAGE_BT_EE_U8 + v].calls++;
+			st[STAGE_BT_EE_U8 + v].work += nbt;
+		}
+
+		// Format a SAM record for the end-to-end alignment
+		if(!alns.empty()) {
+			AlnRes& aln = alns[0];
+			Interval refival(aln.refid(), 0, aln.fw(), reflens[aln.refid()]);
+			if(!refival.containsIgnoreOrient(aln.refival())) {
+				continue;
+			}
+			aln.setParams(0, seedLen, interval,
+			              scoreMinEe.f<TAlScore>((double)rdlen));
+			AlnSetSumm summ(&rd, NULL, NULL, NULL, &alns, NULL,
+			                false, false, -1, -1);
+			AlnFlags flags;
+			flags.init(ALN_FLAG_PAIR_UNPAIRED, true, false, false, true,
+			           true, true, true, true, true, false, true);
+			aln.setMateParams(ALN_RES_TYPE_UNPAIRED, NULL, flags);
+			o.clear();
+			t0 = benchUsecs();
+			sam.append(o, staln, 0, &rd, NULL, rdid, &aln, NULL, summ,
+			           ssm, ssm, &flags, NULL, prm, *mapq, scEe, false);
+			st[STAGE_SAM].usecs += benchUsecs() - t0;
+			st[STAGE_SAM].calls++;
+			st[STAGE_SAM].work += o.length();
+		}
+	}
+	printStages(out, st, STAGE_NUM);
+}
+
+#ifdef BOWTIE_BENCH_MAIN
+int main(int argc, const char **argv) {
+	try {
+		opterr = optind = 1;
+		resetOptions();
+		parseOptions(argc, argv);
+		if(showUsage) {
+			printUsage(cout);
+			return 0;
+		}
+		if(makeRef > 0) {
+			if(optind >= argc) {
+				cerr << "Error: --make-ref requires an output file name" << endl;
+				printUsage(cerr);
+				return 1;
+			}
+			writeSyntheticRef(argv[optind], makeRef, seed);
+			return 0;
+		}
+		if(idxBase.empty()) {
+			cerr << "Error: no index specified; use -x" << endl;
+			printUsage(cerr);
+			return 1;
+		}
+		if(outfile.empty()) {
+			runBench(cout);
+		} else {
+			ofstream out(outfile.c_str());
+			if(!out.good()) {
+				cerr << "Error: could not open " << outfile.c_str() << " for writing" << endl;
+				return 1;
+			}
+			runBench(out);
+		}
+		return 0;
+	} catch(std::exception& e) {
+		cerr << "Error: Encountered exception: '" << e.what() << "'" << endl;
+		return 1;
+	} catch(int e) {
+		if(e != 0) {
+			cerr << "Error: Encountered internal Bowtie 2 exception (#" << e << ")" << endl;
+		}
+		return e;
+	}
+}
+#endif /*def BOWTIE_BENCH_MAIN*/
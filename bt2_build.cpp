@@ -33,6 +33,9 @@
 #include "filebuf.h"
 #include "reference.h"
 #include "ds.h"
+#include "threading.h"
+#include "hot_seeds.h"
+#include "ftab2.h"
 
 /**
  * \file Driver for the bowtie-build indexing tool.
@@ -47,6 +50,15 @@ static TIndexOffU bmaxMultSqrt;
 static uint32_t bmaxDivN;
 static int dcv;
 static int noDc;
+static int onePass;
+static int sais;
+static int appendRefs;
+static int nthreads;
+static int hotSeeds;
+static int hotSeedLen;
+static int hotSeedMin;
+static int ftab2Chars;
+static int ftab2Min;
 static int entireSA;
 static int seed;
 static int showVersion;
@@ -75,6 +87,15 @@ static void resetOptions() {
 	bmaxDivN     = 4;          // same, as divisor of n
 	dcv          = 1024;  // bwise SA difference-cover sample sz
 	noDc         = 0;     // disable difference-cover sample
+	onePass      = 0;     // classify suffixes into buckets in one pass
+	sais         = -1;    // 1 = always SA-IS, 0 = never, -1 = when it fits
+	appendRefs   = 0;     // 1 = add sequences to an existing index
+	nthreads     = 1;     // build forward and mirror index concurrently if > 1
+	hotSeeds     = 0;     // # frequent k-mers to precompute offsets for
+	hotSeedLen   = 20;    // k for --hot-seeds
+	hotSeedMin   = 64;    // min # occurrences for --hot-seeds
+	ftab2Chars   = 0;     // # chars the second-level ftab adds; 0 = none
+	ftab2Min     = 1024;  // min # rows in an ftab bucket to split it
 	entireSA     = 0;     // 1 = disable blockwise SA
 	seed         = 0;     // srandom seed
 	showVersion  = 0;     // just print version and quit?
@@ -108,7 +129,13 @@ enum {
 	ARG_USAGE,
 	ARG_REVERSE_EACH,
 	ARG_SA,
-	ARG_WRAPPER
+	ARG_WRAPPER,
+	ARG_THREADS,
+	ARG_HOT_SEEDS,
+	ARG_HOT_SEED_LEN,
+	ARG_HOT_SEED_MIN,
+	ARG_FTAB2_CHARS,
+	ARG_FTAB2_MIN
 };
 
 /**
@@ -146,13 +173,28 @@ static void printUsage(ostream& out) {
 	    << "    --bmaxdivn <int>        max bucket sz as divisor of ref len (default: 4)" << endl
 	    << "    --dcv <int>             diff-cover period for blockwise (default: 1024)" << endl
 	    << "    --nodc                  disable diff-cover (algorithm becomes quadratic)" << endl
+	    << "    --onepass               sort suffixes into all blocks in one pass; spills" << endl
+	    << "                            block members to a temporary file" << endl
+	    << "    --sais/--nosais         always/never build the SA by induced sorting" << endl
+	    << "                            (default: when the SA fits in 2 GB)" << endl
 	    << "    -r/--noref              don't build .3/.4 index files" << endl
 	    << "    -3/--justref            just build .3/.4 index files" << endl
+	    << "    --append                add sequences to existing index at bt2_base" << endl
+	    << "    --hot-seeds <int>       precompute ref offsets of the <int> most frequent" << endl
+	    << "                            k-mers; write to .hot." + gEbwt_ext + " (default: 0, off)" << endl
+	    << "    --hot-seed-len <int>    k for --hot-seeds; at most -L (default: 20)" << endl
+	    << "    --hot-seed-min <int>    min # occurrences for --hot-seeds (default: 64)" << endl
 	    << "    -o/--offrate <int>      SA is sampled every 2^<int> BWT chars (default: 5)" << endl
 	    << "    -t/--ftabchars <int>    # of chars consumed in initial lookup (default: 10)" << endl
+	    << "    --ftab2-chars <int>     # more chars consumed in large ftab buckets; write" << endl
+	    << "                            to .ftab2." + gEbwt_ext + " (1-8; default: 0, off)" << endl
+	    << "    --ftab2-min <int>       min # of rows in an ftab bucket for --ftab2-chars" << endl
+	    << "                            (default: 1024)" << endl
 	    //<< "    --ntoa                  convert Ns in reference to As" << endl
 	    //<< "    --big --little          endianness (default: little, this host: "
 	    //<< (currentlyBigEndian()? "big":"little") << ")" << endl
+	    << "    --threads <int>         build forward and mirror index at the same time if" << endl
+	    << "                            2 or more (default: 1)" << endl
 	    << "    --seed <int>            seed for random number generator" << endl
 	    << "    -q/--quiet              verbose output (for debugging)" << endl
 	    << "    -h/--help               print detailed description of tool and its options" << endl
@@ -181,7 +223,17 @@ static struct option long_options[] = {
 	{(char*)"bmaxdivn",     required_argument, 0,            ARG_BMAX_DIV},
 	{(char*)"dcv",          required_argument, 0,            ARG_DCV},
 	{(char*)"nodc",         no_argument,       &noDc,        1},
+	{(char*)"onepass",      no_argument,       &onePass,     1},
+	{(char*)"sais",         no_argument,       &sais,        1},
+	{(char*)"nosais",       no_argument,       &sais,        0},
+	{(char*)"append",       no_argument,       &appendRefs,  1},
 	{(char*)"seed",         required_argument, 0,            ARG_SEED},
+	{(char*)"threads",      required_argument, 0,            ARG_THREADS},
+	{(char*)"hot-seeds",    required_argument, 0,            ARG_HOT_SEEDS},
+	{(char*)"hot-seed-len", required_argument, 0,            ARG_HOT_SEED_LEN},
+	{(char*)"hot-seed-min", required_argument, 0,            ARG_HOT_SEED_MIN},
+	{(char*)"ftab2-chars",  required_argument, 0,            ARG_FTAB2_CHARS},
+	{(char*)"ftab2-min",    required_argument, 0,            ARG_FTAB2_MIN},
 	{(char*)"entiresa",     no_argument,       &entireSA,    1},
 	{(char*)"version",      no_argument,       &showVersion, 1},
 	{(char*)"noauto",       no_argument,       0,            'a'},
@@ -292,6 +344,29 @@ static bool parseOptions(int argc, const char **argv) {
 			case ARG_SEED:
 				seed = parseNumber<int>(0, "--seed arg must be at least 0");
 				break;
+			case ARG_THREADS:
+				nthreads = parseNumber<int>(1, "--threads arg must be at least 1");
+				break;
+			case ARG_HOT_SEEDS:
+				hotSeeds = parseNumber<int>(0, "--hot-seeds arg must be at least 0");
+				break;
+			case ARG_HOT_SEED_LEN:
+				hotSeedLen = parseNumber<int>(1, "--hot-seed-len arg must be at least 1");
+				break;
+			case ARG_HOT_SEED_MIN:
+				hotSeedMin = parseNumber<int>(2, "--hot-seed-min arg must be at least 2");
+				break;
+			case ARG_FTAB2_CHARS:
+				ftab2Chars = parseNumber<int>(0, "--ftab2-chars arg must be at least 0");
+				if(ftab2Chars > 8) {
+					cerr << "--ftab2-chars arg must be at most 8" << endl;
+					printUsage(cerr);
+					throw 1;
+				}
+				break;
+			case ARG_FTAB2_MIN:
+				ftab2Min = parseNumber<int>(1, "--ftab2-min arg must be at least 1");
+				break;
 			case ARG_REVERSE_EACH:
 				reverseEach = true;
 				break;
@@ -341,9 +416,462 @@ static void deleteIdxFiles(
 	}
 }
 
+/**
+ * One of the two indexes (forward or mirror) to build, and the outcome
+ * of trying to build it.
+ */
+template<typename TStr>
+struct IndexBuild {
+
+	IndexBuild() :
+		is(NULL), szs(NULL), refnames(NULL), text(NULL), baseSA(NULL),
+		packed(false), reverse(REF_READ_FORWARD), ebwt(NULL), threw(false),
+		err(0), badAlloc(false) { }
+
+	~IndexBuild() { delete ebwt; }
+
+	EList<FileBuf*>*         is;       // input streams; read iff text is NULL
+	EList<RefRecord>*        szs;      // reference size records
+	std::pair<size_t, size_t> sztot;   // total size of reference
+	const EList<string>*     refnames; // names of sequences in text
+	TStr*                    text;     // already-joined reference, or NULL
+	EList<TIndexOffU>*       baseSA;   // SA of index appended to, or NULL
+	string                   outfile;  // basename for index files
+	bool                     packed;   // use packed strings?
+	int                      reverse;  // REF_READ_FORWARD or mirror type
+	Ebwt*                    ebwt;     // index, once built
+	bool                     threw;    // build threw an int?
+	int                      err;      // the int it threw
+	bool                     badAlloc; // build threw bad_alloc?
+};
+
+/**
+ * Construct the index described by 'b'.  If b.text is set, the index
+ * is built from that joined reference; for the mirror index, b.text is
+ * reversed in place.
+ */
+template<typename TStr>
+static void buildIndex(IndexBuild<TStr>& b) {
+	Timer timer(cout, b.reverse == REF_READ_FORWARD ?
+		"Total time for call to driver() for forward index: " :
+		"Total time for backward call to driver() for mirror index: ", verbose);
+	bool bisulfite = false;
+	RefReadInParams refparams(false, b.reverse, nsToAs, bisulfite);
+	b.ebwt = new Ebwt(
+		TStr(),
+		b.packed,
+		0,
+		1,  // TODO: maybe not?
+		lineRate,
+		offRate,      // suffix-array sampling rate
+		ftabChars,    // number of chars in initial arrow-pair calc
+		b.outfile,    // basename for .?.ebwt files
+		b.reverse == 0, // fw
+		!entireSA,    // useBlockwise
+		bmax,         // block size for blockwise SA builder
+		bmaxMultSqrt, // block size as multiplier of sqrt(len)
+		bmaxDivN,     // block size as divisor of len
+		noDc? 0 : dcv,// difference-cover period
+		onePass != 0, // classify suffixes into buckets in one pass
+		sais,         // build the SA by induced sorting?
+		*b.is,        // list of input streams
+		*b.szs,       // list of reference sizes
+		(TIndexOffU)b.sztot.first,  // total size of all unambiguous ref chars
+		refparams,    // reference read-in parameters
+		seed,         // pseudo-random number generator seed
+		-1,           // override offRate
+		doSaFile,     // make a file with just the suffix array in it
+		doBwtFile,    // make a file with just the BWT string in it
+		verbose,      // be talkative
+		autoMem,      // pass exceptions up to the toplevel so that we can adjust memory settings automatically
+		sanityCheck,  // verify results and internal consistency
+		b.text,       // reference already read and joined
+		b.refnames,   // names of the joined sequences
+		b.baseSA);    // SA of the index being appended to
+	// Note that the Ebwt is *not* resident in memory at this time.  To
+	// load it into memory, call ebwt.loadIntoMemory()
+}
+
+/**
+ * Thread body for building one index concurrently with the other.
+ * Exceptions are caught and recorded in the IndexBuild so the main
+ * thread can rethrow them.
+ */
+template<typename TStr>
+static void buildIndexWorker(void *vp) {
+	IndexBuild<TStr>& b = *((IndexBuild<TStr>*)vp);
+	try {
+		buildIndex(b);
+	} catch(bad_alloc& e) {
+		b.badAlloc = true;
+	} catch(std::exception& e) {
+		cerr << "Error: Encountered exception: '" << e.what() << "'" << endl;
+		b.threw = true;
+		b.err = 1;
+	} catch(int e) {
+		b.threw = true;
+		b.err = e;
+	}
+	freeSufBuckets(); // thread's suffix-sorting scratch
+}
+
+#ifdef WITH_TBB
+template<typename TStr>
+struct IndexBuildTask {
+	IndexBuildTask(IndexBuild<TStr>* b) : b_(b) { }
+	void operator()() const { buildIndexWorker<TStr>((void*)b_); }
+	IndexBuild<TStr>* b_;
+};
+#endif
+
+/**
+ * Print the vital stats of a freshly built index and optionally check
+ * that the original reference can be restored from it.
+ */
+template<typename TStr>
+static void checkIndex(IndexBuild<TStr>& b) {
+	Ebwt& ebwt = *b.ebwt;
+	if(verbose) {
+		// Print Ebwt's vital stats
+		ebwt.eh().print(cout);
+	}
+	if(sanityCheck && !appendRefs) {
+		bool bisulfite = false;
+		RefReadInParams refparams(false, b.reverse, nsToAs, bisulfite);
+		// Try restoring the original string (if there were
+		// multiple texts, what we'll get back is the joined,
+		// padded string, not a list)
+		ebwt.loadIntoMemory(
+			0,
+			b.reverse ? (refparams.reverse == REF_READ_REVERSE) : 0,
+			true,  // load SA sample?
+			true,  // load ftab?
+			true,  // load rstarts?
+			false,
+			false);
+		SString<char> s2;
+		ebwt.restore(s2);
+		ebwt.evictFromMemory();
+		{
+			SString<char> joinedss = Ebwt::join<SString<char> >(
+				*b.is,       // list of input streams
+				*b.szs,      // list of reference sizes
+				(TIndexOffU)b.sztot.first, // total size of all unambiguous ref chars
+				refparams,   // reference read-in parameters
+				seed);       // pseudo-random number generator seed
+			// Rewind for the other index's check
+			for(size_t i = 0; i < b.is->size(); i++) {
+				(*b.is)[i]->reset();
+			}
+			if(refparams.reverse == REF_READ_REVERSE) {
+				joinedss.reverse();
+			}
+			assert_eq(joinedss.length(), s2.length());
+			assert(sstr_eq(joinedss, s2));
+		}
+		if(verbose) {
+			if(s2.length() < 1000) {
+				cout << "Passed restore check: " << s2.toZBuf() << endl;
+			} else {
+				cout << "Passed restore check: (" << s2.length() << " chars)" << endl;
+			}
+		}
+	}
+}
+
+/**
+ * Read the reference size records of the index with basename 'base' from
+ * its .3 file into 'szs'.
+ */
+static void readRefRecords(const string& base, EList<RefRecord>& szs) {
+	string file3 = base + ".3." + gEbwt_ext;
+	FILE *f = fopen(file3.c_str(), "rb");
+	if(f == NULL) {
+		cerr << "Error: could not open \"" << file3.c_str() << "\"; --append needs the existing" << endl
+		     << "index's reference files (.3." << gEbwt_ext.c_str() << " and .4." << gEbwt_ext.c_str() << ")" << endl;
+		throw 1;
+	}
+	int32_t one = 0;
+	TIndexOffU nrecs = 0;
+	if(fread(&one, 4, 1, f) != 1 || fread(&nrecs, OFF_SIZE, 1, f) != 1) {
+		cerr << "Error reading \"" << file3.c_str() << "\"" << endl;
+		fclose(f);
+		throw 1;
+	}
+	bool swap = (one != 1);
+	if(swap) {
+		assert_eq(1, endianSwapI32(one));
+		nrecs = endianSwapU(nrecs);
+	}
+	for(TIndexOffU i = 0; i < nrecs; i++) {
+		szs.push_back(RefRecord(f, swap));
+	}
+	fclose(f);
+}
+
+/**
+ * Write the .3 and .4 reference files for the joined reference 's',
+ * which is made up of the records in 'szs'.
+ */
+template<typename TStr>
+static void writeRefFiles(
+	const string& base,
+	EList<RefRecord>& szs,
+	const TStr& s)
+{
+	string file3 = base + ".3." + gEbwt_ext;
+	string file4 = base + ".4." + gEbwt_ext;
+	ofstream fout3(file3.c_str(), ios::binary);
+	if(!fout3.good()) {
+		cerr << "Could not open index file for writing: \"" << file3.c_str() << "\"" << endl;
+		throw 1;
+	}
+	BitpairOutFileBuf bpout(file4.c_str());
+	writeU<int32_t>(fout3, 1, bigEndian); // endianness sentinel
+	writeU<TIndexOffU>(fout3, (TIndexOffU)szs.size(), bigEndian);
+	for(size_t i = 0; i < szs.size(); i++) {
+		szs[i].write(fout3, bigEndian);
+	}
+	for(size_t i = 0; i < s.length(); i++) {
+		bpout.write(s[i]);
+	}
+	bpout.close();
+	fout3.close();
+}
+
+/**
+ * Set up for adding the joined sequences 'news' (named 'newnames') to the
+ * index with basename 'base'.  Reads the existing index's size records
+ * and names, and recovers its text and the full suffix arrays of its
+ * forward and mirror indexes by walking their BWTs.  On return, 's',
+ * 'refnames', 'szs' and 'sztot' describe the combined reference, which
+ * has the new sequences after the existing ones.  The existing index's
+ * line rate, offrate and ftab width are kept.
+ */
+template<typename TStr>
+static void readBaseIndex(
+	const string& base,
+	const TStr& news,
+	const EList<string>& newnames,
+	EList<RefRecord>& szs,
+	std::pair<size_t, size_t>& sztot,
+	TStr& s,
+	EList<string>& refnames,
+	EList<TIndexOffU>& fwSA,
+	EList<TIndexOffU>& rcSA)
+{
+	Timer _t(cout, "  Time reading existing index: ", verbose);
+	EList<RefRecord> baseSzs(MISC_CAT);
+	readRefRecords(base, baseSzs);
+	size_t baseLen = 0, baseTot = 0;
+	for(size_t i = 0; i < baseSzs.size(); i++) {
+		baseLen += baseSzs[i].len;
+		baseTot += baseSzs[i].off + baseSzs[i].len;
+	}
+	size_t len = baseLen + news.length();
+	if(len >= (size_t)OFF_MASK) {
+		cerr << "Error: Reference is too large for this index type; rebuild it with" << endl
+		     << "--large-index" << endl;
+		throw 1;
+	}
+	readEbwtRefnames(base, refnames);
+	for(size_t i = 0; i < newnames.size(); i++) {
+		refnames.push_back(newnames[i]);
+	}
+	for(int fw = 1; fw >= 0; fw--) {
+		Ebwt ebwt(
+			fw ? base : (base + ".rev"),
+			0,                // index is colorspace
+			fw ? -1 : 1,      // fw or mirror index
+			fw != 0,          // index is for the forward direction
+			-1,               // offrate (-1 = index default)
+			0,                // offrate-plus (0 = index default)
+			false,            // use memory-mapped IO
+			false,            // use shared memory
+			false,            // sweep memory-mapped memory
+			false,            // load names?
+			false,            // load SA sample?
+			false,            // load ftab?
+			false,            // load rstarts?
+			verbose,          // be talkative?
+			verbose,          // be talkative at startup?
+			false,            // pass up memory exceptions?
+			sanityCheck);     // sanity check?
+		if(ebwt.eh()._len != baseLen) {
+			cerr << "Error: Index \"" << base.c_str() << "\" doesn't match its .3." << gEbwt_ext.c_str() << " file" << endl;
+			throw 1;
+		}
+		ebwt.loadIntoMemory(
+			0,
+			fw ? -1 : 1,
+			false, // load SA sample?
+			false, // load ftab?
+			false, // load rstarts?
+			false, // load names?
+			verbose);
+		EList<TIndexOffU>& sa = fw ? fwSA : rcSA;
+		sa.reserveExact(len+1);
+		if(fw) {
+			lineRate  = ebwt.eh()._lineRate;
+			offRate   = ebwt.eh()._offRate;
+			ftabChars = ebwt.eh()._ftabChars;
+			s.resize(len);
+			ebwt.restoreSA(sa, &s);
+		} else {
+			ebwt.restoreSA(sa, (TStr*)NULL);
+		}
+	}
+	for(size_t i = 0; i < news.length(); i++) {
+		s.set(news[i], baseLen + i);
+	}
+	for(size_t i = 0; i < szs.size(); i++) {
+		baseSzs.push_back(szs[i]);
+	}
+	szs = baseSzs;
+	sztot.first += baseLen;
+	sztot.second += baseTot;
+}
+
+/**
+ * Load the forward index with basename 'base' and write the offsets of
+ * the rows of its most frequent --hot-seed-len-mers to 'hotfile'.
+ */
+static void writeHotSeeds(const string& base, const string& hotfile) {
+	if(verbose) cout << "Building hot-seed table" << endl;
+	Ebwt ebwt(
+		base,
+		0,                // index is colorspace
+		-1,               // fw index
+		true,             // index is for the forward direction
+		-1,               // offrate (-1 = index default)
+		0,                // offrate-plus (0 = index default)
+		false,            // use memory-mapped IO
+		false,            // use shared memory
+		false,            // sweep memory-mapped memory
+		false,            // load names?
+		true,             // load SA sample?
+		false,            // load ftab?
+		false,            // load rstarts?
+		false,            // be talkative?
+		false,            // be talkative at startup?
+		false,            // pass up memory exceptions?
+		sanityCheck);     // sanity check?
+	ebwt.loadIntoMemory(
+		0,
+		-1,
+		true,  // load SA sample?
+		false, // load ftab?
+		false, // load rstarts?
+		false, // load names?
+		false);
+	HotSeeds::build(
+		ebwt,
+		(size_t)hotSeedLen,
+		(size_t)hotSeedMin,
+		(size_t)hotSeeds,
+		hotfile,
+		Ebwt::fingerprint(base),
+		verbose);
+}
+
+/**
+ * Load the forward and mirror indexes with basename 'base' and write the
+ * second levels of their ftabs to files[0] and files[1] respectively.
+ * Each index is split with the help of the other.
+ */
+static void writeFtab2s(const string& base, const string files[2]) {
+	if(verbose) cout << "Building second-level ftabs" << endl;
+	Ebwt* ebwts[2] = { NULL, NULL };
+	for(int fw = 1; fw >= 0; fw--) {
+		Ebwt* ebwt = new Ebwt(
+			fw ? base : (base + ".rev"),
+			0,                // index is colorspace
+			REF_READ_REVERSE, // mirror index must be entire reverse
+			fw != 0,          // index is for the forward direction
+			-1,               // offrate (-1 = index default)
+			0,                // offrate-plus (0 = index default)
+			false,            // use memory-mapped IO
+			false,            // use shared memory
+			false,            // sweep memory-mapped memory
+			false,            // load names?
+			false,            // load SA sample?
+			true,             // load ftab?
+			false,            // load rstarts?
+			false,            // be talkative?
+			false,            // be talkative at startup?
+			false,            // pass up memory exceptions?
+			sanityCheck);     // sanity check?
+		ebwts[fw ? 0 : 1] = ebwt;
+		ebwt->loadIntoMemory(
+			0,
+			fw ? -1 : REF_READ_REVERSE,
+			false, // load SA sample?
+			true,  // load ftab?
+			false, // load rstarts?
+			false, // load names?
+			false);
+	}
+	for(int i = 0; i < 2; i++) {
+		Ftab2::build(
+			*ebwts[i],
+			*ebwts[1-i],
+			ftab2Chars,
+			(size_t)ftab2Min,
+			files[i],
+			Ebwt::fingerprint(i == 0 ? base : (base + ".rev")),
+			verbose);
+	}
+	delete ebwts[0];
+	delete ebwts[1];
+}
+
+/**
+ * Move the index files written under the temporary basename 'tmpbase'
+ * over those of the index 'base' that was appended to.  Files of the old
+ * index that the new one doesn't have (e.g. .3/.4 with -r) are removed,
+ * since they no longer describe it.
+ */
+static void replaceIdxFiles(const string& tmpbase, const string& base) {
+	EList<string> exts(MISC_CAT);
+	EList<bool> made(MISC_CAT);
+	exts.push_back(".1." + gEbwt_ext);         made.push_back(true);
+	exts.push_back(".2." + gEbwt_ext);         made.push_back(true);
+	exts.push_back(".rev.1." + gEbwt_ext);     made.push_back(true);
+	exts.push_back(".rev.2." + gEbwt_ext);     made.push_back(true);
+	exts.push_back(".3." + gEbwt_ext);         made.push_back(writeRef);
+	exts.push_back(".4." + gEbwt_ext);         made.push_back(writeRef);
+	exts.push_back(".hot." + gEbwt_ext);       made.push_back(hotSeeds > 0);
+	exts.push_back(".ftab2." + gEbwt_ext);     made.push_back(ftab2Chars > 0);
+	exts.push_back(".rev.ftab2." + gEbwt_ext); made.push_back(ftab2Chars > 0);
+	exts.push_back(".sa");                     made.push_back(doSaFile);
+	exts.push_back(".rev.sa");                 made.push_back(doSaFile);
+	exts.push_back(".bwt");                    made.push_back(doBwtFile);
+	exts.push_back(".rev.bwt");                made.push_back(doBwtFile);
+	for(size_t i = 0; i < exts.size(); i++) {
+		string from = tmpbase + exts[i];
+		string to = base + exts[i];
+		if(!made[i]) {
+			remove(to.c_str());
+		} else if(rename(from.c_str(), to.c_str()) != 0) {
+			cerr << "Error: could not rename \"" << from.c_str() << "\" to \""
+			     << to.c_str() << "\"" << endl;
+			throw 1;
+		}
+	}
+}
+
 /**
  * Drive the index construction process and optionally sanity-check the
- * result.
+ * result.  The reference is read and joined once and shared by the
+ * forward index and the mirror index (reversed using 'reverse'); with
+ * more than one thread, the two are built at the same time.
+ *
+ * With --append, the sequences are added to the existing index at
+ * 'outfile'.  The suffix arrays of its forward and mirror indexes are
+ * recovered and the new suffixes merged into them, rather than sorting
+ * everything again.  The new index is written under a temporary
+ * basename and only moved over the existing one once it is complete, so
+ * a failed append leaves the existing index as it was.
  */
 template<typename TStr>
 static void driver(
@@ -355,7 +883,7 @@ static void driver(
 {
 	EList<FileBuf*> is(MISC_CAT);
 	bool bisulfite = false;
-	RefReadInParams refparams(false, reverse, nsToAs, bisulfite);
+	RefReadInParams refparams(false, REF_READ_FORWARD, nsToAs, bisulfite);
 	assert_gt(infiles.size(), 0);
 	if(format == CMDLINE) {
 		// Adapt sequence strings to stringstreams open for input
@@ -395,22 +923,23 @@ static void driver(
 		cerr << "Warning: All fasta inputs were empty" << endl;
 		throw 1;
 	}
-	if(!reverse) {
 #ifdef BOWTIE_64BIT_INDEX
-		cerr << "Building a LARGE index" << endl;
+	cerr << "Building a LARGE index" << endl;
 #else
-		cerr << "Building a SMALL index" << endl;
+	cerr << "Building a SMALL index" << endl;
 #endif
-	}
 	// Vector for the ordered list of "records" comprising the input
 	// sequences.  A record represents a stretch of unambiguous
-	// characters in one of the input sequences.
+	// characters in one of the input sequences.  The records are the
+	// same for the forward and mirror indexes.
 	EList<RefRecord> szs(MISC_CAT);
 	std::pair<size_t, size_t> sztot;
+	// Basename of the files written by this build
+	const string base = appendRefs ? (outfile + ".append-tmp") : outfile;
 	{
 		if(verbose) cout << "Reading reference sizes" << endl;
 		Timer _t(cout, "  Time reading reference sizes: ", verbose);
-		if(!reverse && (writeRef || justRef)) {
+		if((writeRef || justRef) && !appendRefs) {
 			filesWritten.push_back(outfile + ".3." + gEbwt_ext);
 			filesWritten.push_back(outfile + ".4." + gEbwt_ext);
 			sztot = BitPairReference::szsFromFasta(is, outfile, bigEndian, refparams, szs, sanityCheck);
@@ -422,76 +951,116 @@ static void driver(
 	assert_gt(sztot.first, 0);
 	assert_gt(sztot.second, 0);
 	assert_gt(szs.size(), 0);
-	// Construct index from input strings and parameters
-	filesWritten.push_back(outfile + ".1." + gEbwt_ext);
-	filesWritten.push_back(outfile + ".2." + gEbwt_ext);
-	Ebwt ebwt(
-		TStr(),
-		packed,
-		0,
-		1,  // TODO: maybe not?
-		lineRate,
-		offRate,      // suffix-array sampling rate
-		ftabChars,    // number of chars in initial arrow-pair calc
-		outfile,      // basename for .?.ebwt files
-		reverse == 0, // fw
-		!entireSA,    // useBlockwise
-		bmax,         // block size for blockwise SA builder
-		bmaxMultSqrt, // block size as multiplier of sqrt(len)
-		bmaxDivN,     // block size as divisor of len
-		noDc? 0 : dcv,// difference-cover period
-		is,           // list of input streams
-		szs,          // list of reference sizes
-		(TIndexOffU)sztot.first,  // total size of all unambiguous ref chars
-		refparams,    // reference read-in parameters
-		seed,         // pseudo-random number generator seed
-		-1,           // override offRate
-		doSaFile,     // make a file with just the suffix array in it
-		doBwtFile,    // make a file with just the BWT string in it
-		verbose,      // be talkative
-		autoMem,      // pass exceptions up to the toplevel so that we can adjust memory settings automatically
-		sanityCheck); // verify results and internal consistency
-	// Note that the Ebwt is *not* resident in memory at this time.  To
-	// load it into memory, call ebwt.loadIntoMemory()
-	if(verbose) {
-		// Print Ebwt's vital stats
-		ebwt.eh().print(cout);
-	}
-	if(sanityCheck) {
-		// Try restoring the original string (if there were
-		// multiple texts, what we'll get back is the joined,
-		// padded string, not a list)
-		ebwt.loadIntoMemory(
-			0,
-			reverse ? (refparams.reverse == REF_READ_REVERSE) : 0,
-			true,  // load SA sample?
-			true,  // load ftab?
-			true,  // load rstarts?
-			false,
-			false);
-		SString<char> s2;
-		ebwt.restore(s2);
-		ebwt.evictFromMemory();
-		{
-			SString<char> joinedss = Ebwt::join<SString<char> >(
-				is,          // list of input streams
-				szs,         // list of reference sizes
-				(TIndexOffU)sztot.first, // total size of all unambiguous ref chars
-				refparams,   // reference read-in parameters
-				seed);       // pseudo-random number generator seed
-			if(refparams.reverse == REF_READ_REVERSE) {
-				joinedss.reverse();
+	// Read and join the reference once, for both indexes
+	TStr s;
+	EList<string> refnames(EBWT_CAT);
+	EList<TIndexOffU> fwBaseSA(EBWTB_CAT), rcBaseSA(EBWTB_CAT);
+	{
+		if(verbose) cout << "Reading and joining reference sequences" << endl;
+		Timer _t(cout, "  Time reading and joining reference sequences: ", verbose);
+		size_t jlen = 0;
+		for(size_t i = 0; i < szs.size(); i++) {
+			jlen += szs[i].len;
+		}
+		if(appendRefs) {
+			TStr news;
+			EList<string> newnames(EBWT_CAT);
+			news.resize(jlen);
+			Ebwt::joinRefs(is, szs, (TIndexOffU)sztot.first, refparams, news, newnames);
+			readBaseIndex(outfile, news, newnames, szs, sztot, s, refnames, fwBaseSA, rcBaseSA);
+			if(writeRef) {
+				filesWritten.push_back(base + ".3." + gEbwt_ext);
+				filesWritten.push_back(base + ".4." + gEbwt_ext);
+				writeRefFiles(base, szs, s);
 			}
-			assert_eq(joinedss.length(), s2.length());
-			assert(sstr_eq(joinedss, s2));
+		} else {
+			s.resize(jlen);
+			Ebwt::joinRefs(is, szs, (TIndexOffU)sztot.first, refparams, s, refnames);
 		}
-		if(verbose) {
-			if(s2.length() < 1000) {
-				cout << "Passed restore check: " << s2.toZBuf() << endl;
-			} else {
-				cout << "Passed restore check: (" << s2.length() << " chars)" << endl;
+	}
+	IndexBuild<TStr> bld[2];
+	for(int i = 0; i < 2; i++) {
+		bld[i].is = &is;
+		bld[i].szs = &szs;
+		bld[i].sztot = sztot;
+		bld[i].refnames = &refnames;
+		bld[i].text = &s;
+		bld[i].baseSA = appendRefs ? (i == 0 ? &fwBaseSA : &rcBaseSA) : NULL;
+		bld[i].packed = packed;
+	}
+	bld[0].outfile = base;
+	bld[1].outfile = base + ".rev";
+	bld[1].reverse = reverse;
+	if(reverse == REF_READ_REVERSE_EACH) {
+		// Mirror index reads its own, differently reversed, copy
+		bld[1].text = NULL;
+	}
+	for(int i = 0; i < 2; i++) {
+		filesWritten.push_back(bld[i].outfile + ".1." + gEbwt_ext);
+		filesWritten.push_back(bld[i].outfile + ".2." + gEbwt_ext);
+	}
+	if(nthreads > 1) {
+		// The mirror index reverses its text, so it needs its own copy
+		TStr srev;
+		if(bld[1].text != NULL) {
+			// (Copied element-wise; S2bDnaString has no deep copy)
+			srev.resize(s.length());
+			for(size_t i = 0; i < s.length(); i++) {
+				srev.set(s[i], i);
 			}
+			bld[1].text = &srev;
 		}
+		// Build the forward index in a new thread and the mirror index
+		// in this one
+#ifdef WITH_TBB
+		tbb::task_group tbb_grp;
+		tbb_grp.run(IndexBuildTask<TStr>(&bld[0]));
+		buildIndexWorker<TStr>((void*)&bld[1]);
+		tbb_grp.wait();
+#else
+		tthread::thread fwThread(buildIndexWorker<TStr>, (void*)&bld[0]);
+		buildIndexWorker<TStr>((void*)&bld[1]);
+		fwThread.join();
+#endif
+		for(int i = 0; i < 2; i++) {
+			if(bld[i].badAlloc) throw bad_alloc();
+			if(bld[i].threw) throw bld[i].err;
+		}
+	} else {
+		srand(seed);
+		buildIndex(bld[0]);
+		// Mirror index reverses s in place; the forward index is done
+		// with it
+		srand(seed);
+		buildIndex(bld[1]);
+	}
+	for(int i = 0; i < 2; i++) {
+		checkIndex(bld[i]);
+	}
+	string hotfile = base + ".hot." + gEbwt_ext;
+	if(hotSeeds > 0) {
+		filesWritten.push_back(hotfile);
+		writeHotSeeds(base, hotfile);
+	} else if(!appendRefs) {
+		// Don't leave a table from an earlier build of this index behind;
+		// with --append, replaceIdxFiles() does this
+		remove(hotfile.c_str());
+	}
+	string ftab2files[2] = {
+		base + ".ftab2." + gEbwt_ext,
+		base + ".rev.ftab2." + gEbwt_ext
+	};
+	if(ftab2Chars > 0) {
+		filesWritten.push_back(ftab2files[0]);
+		filesWritten.push_back(ftab2files[1]);
+		writeFtab2s(base, ftab2files);
+	} else if(!appendRefs) {
+		// Nor second-level ftabs
+		remove(ftab2files[0].c_str());
+		remove(ftab2files[1].c_str());
+	}
+	if(appendRefs) {
+		replaceIdxFiles(base, outfile);
 	}
 }
 
@@ -558,6 +1127,11 @@ int bowtie_build(int argc, const char **argv) {
 			printUsage(cerr);
 			return 1;
 		}
+		if(appendRefs && (justRef || reverseEach)) {
+			cerr << "--append can't be combined with -3/--justref or --reverse-each" << endl;
+			printUsage(cerr);
+			return 1;
+		}
 
 		// Optionally summarize
 		if(verbose) {
@@ -567,6 +1141,7 @@ int bowtie_build(int argc, const char **argv) {
 				 << "  Lines per side: " << linesPerSide << " (side is " << ((1<<lineRate)*linesPerSide) << " bytes)" << endl
 				 << "  Offset rate: " << offRate << " (one in " << (1<<offRate) << ")" << endl
 				 << "  FTable chars: " << ftabChars << endl
+				 << "  Second-level FTable chars: " << ftab2Chars << " (buckets of " << ftab2Min << "+ rows)" << endl
 				 << "  Strings: " << (packed? "packed" : "unpacked") << endl
 				 ;
 			if(bmax == OFF_MASK) {
@@ -585,6 +1160,9 @@ int bowtie_build(int argc, const char **argv) {
 				cout << "  Max bucket size, len divisor: " << bmaxDivN << endl;
 			}
 			cout << "  Difference-cover sample period: " << dcv << endl;
+			cout << "  One-pass block classification: " << (onePass? "enabled":"disabled") << endl;
+			cout << "  Append to existing index: " << (appendRefs? "yes":"no") << endl;
+			cout << "  Induced-sorting SA construction: " << (sais > 0 ? "enabled" : (sais == 0 ? "disabled" : "automatic")) << endl;
 			cout << "  Endianness: " << (bigEndian? "big":"little") << endl
 				 << "  Actual local endianness: " << (currentlyBigEndian()? "big":"little") << endl
 				 << "  Sanity checking: " << (sanityCheck? "enabled":"disabled") << endl;
@@ -594,6 +1172,13 @@ int bowtie_build(int argc, const char **argv) {
 			cout << "  Assertions: enabled" << endl;
 	#endif
 			cout << "  Random seed: " << seed << endl;
+			cout << "  Threads: " << nthreads << endl;
+			if(hotSeeds > 0) {
+				cout << "  Hot seeds: " << hotSeeds << " " << hotSeedLen << "-mers occurring at least "
+				     << hotSeedMin << " times" << endl;
+			} else {
+				cout << "  Hot seeds: none" << endl;
+			}
 			cout << "  Sizeofs: void*:" << sizeof(void*) << ", int:" << sizeof(int) << ", long:" << sizeof(long) << ", size_t:" << sizeof(size_t) << endl;
 			cout << "Input files DNA, " << file_format_names[format].c_str() << ":" << endl;
 			for(size_t i = 0; i < infiles.size(); i++) {
@@ -602,30 +1187,10 @@ int bowtie_build(int argc, const char **argv) {
 		}
 		// Seed random number generator
 		srand(seed);
-		{
-			Timer timer(cout, "Total time for call to driver() for forward index: ", verbose);
-			if(!packed) {
-				try {
-					driver<SString<char> >(infile, infiles, outfile, false, REF_READ_FORWARD);
-				} catch(bad_alloc& e) {
-					if(autoMem) {
-						cerr << "Switching to a packed string representation." << endl;
-						packed = true;
-					} else {
-						throw e;
-					}
-				}
-			}
-			if(packed) {
-				driver<S2bDnaString>(infile, infiles, outfile, true, REF_READ_FORWARD);
-			}
-		}
 		int reverseType = reverseEach ? REF_READ_REVERSE_EACH : REF_READ_REVERSE;
-		srand(seed);
-		Timer timer(cout, "Total time for backward call to driver() for mirror index: ", verbose);
 		if(!packed) {
 			try {
-				driver<SString<char> >(infile, infiles, outfile + ".rev", false, reverseType);
+				driver<SString<char> >(infile, infiles, outfile, false, reverseType);
 			} catch(bad_alloc& e) {
 				if(autoMem) {
 					cerr << "Switching to a packed string representation." << endl;
@@ -636,7 +1201,7 @@ int bowtie_build(int argc, const char **argv) {
 			}
 		}
 		if(packed) {
-			driver<S2bDnaString>(infile, infiles, outfile + ".rev", true, reverseType);
+			driver<S2bDnaString>(infile, infiles, outfile, true, reverseType);
 		}
 		return 0;
 	} catch(std::exception& e) {
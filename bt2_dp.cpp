@@ -18,6 +18,9 @@
  */
 
 #include <getopt.h>
+#include <sys/time.h>
+#include <fstream>
+#include <iomanip>
 #include "assert_helpers.h"
 #include "ds.h"
 #include "simple_func.h"
@@ -25,6 +28,7 @@
 #include "scoring.h"
 #include "opts.h"
 #include "aligner_sw.h"
+#include "threading.h"
 
 using namespace std;
 
@@ -40,6 +44,7 @@ static uint32_t skipReads;  // # reads/read pairs to skip
 int gGapBarrier;            // # diags on top/bot only to be entered diagonally
 static int bonusMatchType;  // how to reward matches
 static int bonusMatch;      // constant reward if bonusMatchType=constant
+static bool bonusMatchSet;  // --ma was given
 static int penMmcType;      // how to penalize mismatches
 static int penMmcMax;       // max mm penalty
 static int penMmcMin;       // min mm penalty
@@ -52,6 +57,7 @@ static int   penRfGapConst;   // constant cost of extending a gap in the referen
 static int   penRdGapLinear;  // coeff of linear term for cost of gap extension in read
 static int   penRfGapLinear;  // coeff of linear term for cost of gap extension in ref
 static SimpleFunc scoreMin;   // minimum valid score as function of read len
+static bool scoreMinSet;      // --score-min was given
 static SimpleFunc nCeil;      // max # Ns allowed as function of read len
 static SimpleFunc msIval;     // interval between seeds as function of read len
 static bool enable8;          // use 8-bit SSE where possible?
@@ -61,6 +67,7 @@ static bool doTri;            // do triangular mini-fills?
 static bool ignoreQuals;      // all mms incur same penalty, regardless of qual
 static EList<string> queries; // list of query files
 static string outfile;        // write output to this file
+static ESet<string> kernelSet; // kernels to run; empty = all
 
 static void resetOptions() {
 	gVerbose                = 0;
@@ -75,6 +82,7 @@ static void resetOptions() {
 	gGapBarrier				= 4;     // disallow gaps within this many chars of either end of alignment
 	bonusMatchType  = DEFAULT_MATCH_BONUS_TYPE;
 	bonusMatch      = DEFAULT_MATCH_BONUS;
+	bonusMatchSet   = false;
 	penMmcType      = DEFAULT_MM_PENALTY_TYPE;
 	penMmcMax       = DEFAULT_MM_PENALTY_MAX;
 	penMmcMin       = DEFAULT_MM_PENALTY_MIN;
@@ -87,6 +95,7 @@ static void resetOptions() {
 	penRdGapLinear  = DEFAULT_READ_GAP_LINEAR;
 	penRfGapLinear  = DEFAULT_REF_GAP_LINEAR;
 	scoreMin.init  (SIMPLE_FUNC_LINEAR, DEFAULT_MIN_CONST,   DEFAULT_MIN_LINEAR);
+	scoreMinSet     = false;
 	nCeil.init     (SIMPLE_FUNC_LINEAR, 0.0f, std::numeric_limits<double>::max(), 2.0f, 0.1f);
 	msIval.init    (SIMPLE_FUNC_LINEAR, 1.0f, std::numeric_limits<double>::max(), DEFAULT_IVAL_B, DEFAULT_IVAL_A);
 	enable8            = true;  // use 8-bit SSE where possible?
@@ -96,14 +105,16 @@ static void resetOptions() {
 	ignoreQuals = false;     // all mms incur same penalty, regardless of qual
 	queries.clear();         // list of query files
 	outfile.clear();         // write output to this file
+	kernelSet.clear();       // run all kernels
 }
 
-static const char *short_options = "u:hp:P:S:";
+static const char *short_options = "s:u:hp:P:S:";
 
 static struct option long_options[] = {
 	{(char*)"verbose",          no_argument,       0, ARG_VERBOSE},
 	{(char*)"quiet",            no_argument,       0, ARG_QUIET},
 	{(char*)"sanity",           no_argument,       0, ARG_SANITY},
+	{(char*)"skip",             required_argument, 0, 's'},
 	{(char*)"qupto",            required_argument, 0, 'u'},
 	{(char*)"upto",             required_argument, 0, 'u'},
 	{(char*)"version",          no_argument,       0, ARG_VERSION},
@@ -131,6 +142,7 @@ static struct option long_options[] = {
 	{(char*)"cp-min",           required_argument, 0, ARG_CP_MIN},
 	{(char*)"cp-ival",          required_argument, 0, ARG_CP_IVAL},
 	{(char*)"tri",              no_argument,       0, ARG_TRI},
+	{(char*)"kernels",          required_argument, 0, ARG_DP_KERNELS},
 	{(char*)0, 0, 0, 0} // terminator
 };
 
@@ -141,10 +153,13 @@ static void printUsage(ostream& out) {
 	out << "Bowtie 2 dynamic programming engine, by Ben Langmead (langmea@cs.jhu.edu, www.cs.jhu.edu/~langmea)" << endl;
 	string tool_name = "bowtie2-dp";
 	out << "Usage: " << endl
-	    << "  " << tool_name.c_str() << " [options]* <in> <out>" << endl
+	    << "  " << tool_name.c_str() << " [options]* <in>+" << endl
 	    << endl
-	    <<     "  <in>           File with DP input problems (default: stdin)" << endl
-	    <<     "  <out>          File with DP output solutions (default: stdout)" << endl
+	    <<     "  <in>           DP problems written by bowtie2 --log-dp or --log-dp-opp" << endl
+	    << endl
+	    << "Every problem is filled with each SSE kernel in turn, and a line per kernel" << endl
+	    << "(problems, alignments, cells, seconds, GCUPS) is written to the output." << endl
+	    << "Use --local if the log came from a --local run." << endl
 		<< endl
 	    << "Options (defaults in parentheses):" << endl
 		<< endl
@@ -173,6 +188,8 @@ static void printUsage(ostream& out) {
 		<< endl
 	    << " Performance:" << endl
 	    << "  -p/--threads <int> number of alignment threads to launch (1)" << endl
+	    << "  --kernels <list>   comma-separated subset of ee_u8,ee_i16,loc_u8,loc_i16 (all)" << endl
+	    << "  -S/--output <file> write per-kernel results here (stdout)" << endl
 		<< endl
 	    << " Other:" << endl
 	    << "  --version          print version information and quit" << endl
@@ -303,6 +320,21 @@ static void parseOption(int next_option, const char *arg) {
 		case ARG_TRI:
 			doTri = true;
 			break;
+		case ARG_DP_KERNELS: {
+			EList<string> args;
+			tokenize(arg, ",", args);
+			for(size_t i = 0; i < args.size(); i++) {
+				if(args[i] != "ee_u8" && args[i] != "ee_i16" &&
+				   args[i] != "loc_u8" && args[i] != "loc_i16")
+				{
+					cerr << "Error: unknown kernel '" << args[i].c_str()
+					     << "' in --kernels" << endl;
+					throw 1;
+				}
+				kernelSet.insert(args[i]);
+			}
+			break;
+		}
 		case ARG_LOCAL: localAlign = true; break;
 		case ARG_END_TO_END: localAlign = false; break;
 		case ARG_SSE8: enable8 = true; break;
@@ -336,6 +368,7 @@ static void parseOption(int next_option, const char *arg) {
 			string tmp = args[0];
 			istringstream tmpss(tmp);
 			tmpss >> bonusMatch;
+			bonusMatchSet = true;
 			break;
 		}
 		case ARG_SCORE_MMP: {
@@ -415,6 +448,7 @@ static void parseOption(int next_option, const char *arg) {
 				     << "; RHS must start with C, Q or R" << endl;
 				assert(false); throw 1;
 			}
+			break;
 		}
 		case ARG_SCORE_RDG: {
 			EList<string> args;
@@ -431,6 +465,7 @@ static void parseOption(int next_option, const char *arg) {
 			} else {
 				penRdGapLinear = DEFAULT_READ_GAP_LINEAR;
 			}
+			break;
 		}
 		case ARG_SCORE_RFG: {
 			EList<string> args;
@@ -447,6 +482,7 @@ static void parseOption(int next_option, const char *arg) {
 			} else {
 				penRfGapLinear = DEFAULT_REF_GAP_LINEAR;
 			}
+			break;
 		}
 		case ARG_SCORE_MIN: {
 			EList<string> args;
@@ -458,6 +494,7 @@ static void parseOption(int next_option, const char *arg) {
 				throw 1;
 			}
 			PARSE_FUNC(scoreMin);
+			scoreMinSet = true;
 			break;
 		}
 		case 'S': outfile = arg; break;
@@ -512,6 +549,11 @@ static void parseOptions(int argc, const char **argv) {
 #endif
 }
 
+/**
+ * One DP problem from a --log-dp file: a reference window, the rectangle
+ * within it and, if the aligner got as far as filling the matrix, the
+ * outcome it saw.
+ */
 struct DpProblem {
 	void reset() {
 		ref.clear();
@@ -523,10 +565,29 @@ struct DpProblem {
 	BTString ref;
 	bool     fw;
 	DPRect   rect;
+	bool     known;   // true iff the log recorded the outcome
 	bool     aligned;
 	TAlScore score;
 };
 
+/**
+ * A read together with all the DP problems logged for it.
+ */
+struct DpRead {
+	BTDnaString      seq;
+	BTDnaString      seqrc;
+	BTString         qual;
+	BTString         qualrc;
+	EList<DpProblem> probs;
+};
+
+/**
+ * Reads the problems written by bowtie2-align's --log-dp and --log-dp-opp
+ * options.  Each line holds a read, its qualities and one tab-separated
+ * field per DP problem:
+ *
+ *   refidx,reflen,minsc,+/-,<9 DPRect fields>,refseq[,aligned,score]
+ */
 class DpLogReader {
 
 public:
@@ -539,96 +600,80 @@ public:
 		reset();
 		fn_ = fn;
 		ih_.open(fn_.c_str());
-		ih_.sync_with_stdio(false);
+		if(!ih_.is_open()) {
+			cerr << "Error: could not open DP log " << fn_.c_str() << endl;
+			throw 1;
+		}
 	}
 	
 	void reset() {
 		if(ih_.is_open()) {
 			ih_.close();
 		}
+		ih_.clear();
 	}
 	
+	/**
+	 * Read the next read that has at least one DP problem.  Return false
+	 * at end of file.
+	 */
 	bool nextRead(
 		BTDnaString& seq,
 		BTString& qual,
 		EList<DpProblem>& refs)
 	{
-		if(done()) {
-			return false;
-		}
-		ln_.clear();
-		getline(ih_, ln_);
-		while(ln_.empty() && ih_.good()) {
+		EList<string> buf, fields;
+		while(true) {
+			if(done()) {
+				return false;
+			}
+			ln_.clear();
 			getline(ih_, ln_);
+			buf.clear();
+			tokenize(ln_, "\t", buf);
+			if(buf.size() > 2) {
+				break;
+			}
 		}
-		if(ln_.empty() && !ih_.good()) {
-			return false;
-		}
-		EList<string> buf;
-		tokenize(ln_, '\t', buf);
-		assert_gt(buf.size(), 2);
 		seq.install(buf[0].c_str(), true);
 		qual = buf[1];
 		for(size_t i = 2; i < buf.size(); i++) {
-			refs.expand();
-			istringstream is(buf[i]);
-			char comma, tmp;
-			// ref idx
-			is >> refs.back().refidx;
-			is >> comma; assert_eq(',', comma);
-			// ref length
-			is >> refs.back().reflen;
-			is >> comma; assert_eq(',', comma);
-			// minimum score
-			is >> refs.back().minsc;
-			is >> comma; assert_eq(',', comma);
-			// read orientation
-			is >> tmp;
-			assert(tmp == '-' || tmp == '+');
-			refs.back().fw = (tmp == '+');
-			is >> comma; assert_eq(',', comma);
-			// DP rectangle
-			is >> refs.back().rect.refl;
-			is >> comma; assert_eq(',', comma);
-			is >> refs.back().rect.refr;
-			is >> comma; assert_eq(',', comma);
-			is >> refs.back().rect.refl_pretrim;
-			is >> comma; assert_eq(',', comma);
-			is >> refs.back().rect.refr_pretrim;
-			is >> comma; assert_eq(',', comma);
-			is >> refs.back().rect.triml;
-			is >> comma; assert_eq(',', comma);
-			is >> refs.back().rect.trimr;
-			is >> comma; assert_eq(',', comma);
-			is >> refs.back().rect.corel;
-			is >> comma; assert_eq(',', comma);
-			is >> refs.back().rect.corer;
-			is >> comma; assert_eq(',', comma);
-			is >> refs.back().rect.maxgap;
-			is >> comma; assert_eq(',', comma);
-			// reference string
-			string ref;
-			while(true) {
-				char c;
-				is >> c;
-				if(c == ',') break;
-				ref.push_back(c);
+			fields.clear();
+			tokenize(buf[i], ",", fields);
+			if(fields.size() != 14 && fields.size() != 16) {
+				cerr << "Error: malformed DP problem in " << fn_.c_str()
+				     << ": " << buf[i].substr(0, 60).c_str() << endl;
+				throw 1;
 			}
-			refs.back().ref.install(ref.c_str());
-			for(size_t i = 0; i < ref.length(); i++) {
-				int m = asc2dnamask[(int)refs.back().ref[i]];
-				if(m == 15) {
-					m = 16; // N
-				}
-				refs.back().ref.set(m, i);
+			refs.expand();
+			DpProblem& pr = refs.back();
+			pr.refidx = parse<TRefId>(fields[0].c_str());
+			pr.reflen = parse<TRefOff>(fields[1].c_str());
+			pr.minsc  = parse<TAlScore>(fields[2].c_str());
+			assert(fields[3] == "+" || fields[3] == "-");
+			pr.fw = (fields[3] == "+");
+			pr.rect.refl         = parse<int64_t>(fields[4].c_str());
+			pr.rect.refr         = parse<int64_t>(fields[5].c_str());
+			pr.rect.refl_pretrim = parse<int64_t>(fields[6].c_str());
+			pr.rect.refr_pretrim = parse<int64_t>(fields[7].c_str());
+			pr.rect.triml        = parse<size_t>(fields[8].c_str());
+			pr.rect.trimr        = parse<size_t>(fields[9].c_str());
+			pr.rect.corel        = parse<int64_t>(fields[10].c_str());
+			pr.rect.corer        = parse<int64_t>(fields[11].c_str());
+			pr.rect.maxgap       = parse<size_t>(fields[12].c_str());
+			// Reference characters are stored as masks, N = 16
+			const string& ref = fields[13];
+			pr.ref.resize(ref.length());
+			for(size_t j = 0; j < ref.length(); j++) {
+				int m = asc2dnamask[(int)ref[j]];
+				pr.ref.set(m == 15 ? 16 : m, j);
 			}
-			// whether the DP alignment was successful
-			int aligned;
-			is >> aligned;
-			refs.back().aligned = (aligned == 1);
-			// alignment score
-			is >> comma; assert_eq(',', comma);
-			is >> refs.back().score;
+			// Kernels peek one character past the window; terminate it
+			// now so that worker threads only ever read the buffer
+			pr.ref.toZBuf();
+			pr.known = (fields.size() == 16);
+			pr.aligned = pr.known && fields[14] == "1";
+			pr.score = pr.known ? parse<TAlScore>(fields[15].c_str()) : 0;
 		}
 		return true;
 	}
@@ -644,6 +689,90 @@ protected:
 	string   ln_; // line buffer
 };
 
+/**
+ * One of the four SSE kernels.
+ */
+struct DpKernel {
+	const char *name;
+	bool        local;  // local (vs. end-to-end) alignment
+	bool        use8;   // try 8-bit scores first
+	bool        native; // same mode as the run that wrote the log
+};
+
+/**
+ * Per-thread state and results for one pass of one kernel over the
+ * problems.
+ */
+struct DpWorker {
+	int                   tid;
+	const EList<DpRead>  *reads;
+	const DpKernel       *kernel;
+	const Scoring        *sc;
+	const SimpleFunc     *minfunc; // min score function if not native
+	uint64_t              nprob;
+	uint64_t              naligned;
+	uint64_t              ncells;
+	uint64_t              nmismatch; // outcome differed from the log
+};
+
+static void dpWorker(void *vp) {
+	DpWorker& w = *(DpWorker*)vp;
+	const DpKernel& k = *w.kernel;
+	SwAligner sw(NULL);
+	for(size_t i = (size_t)w.tid; i < w.reads->size(); i += nthreads) {
+		const DpRead& r = (*w.reads)[i];
+		const size_t rdlen = r.seq.length();
+		sw.initRead(r.seq, r.seqrc, r.qual, r.qualrc, 0, rdlen, *w.sc);
+		TAlScore minsc = 0;
+		if(!k.native) {
+			minsc = w.minfunc->f<TAlScore>((double)rdlen);
+			if(k.local && minsc < 0) minsc = 0;
+		}
+		for(size_t j = 0; j < r.probs.size(); j++) {
+			const DpProblem& pr = r.probs[j];
+			sw.initRef(
+				pr.fw,
+				pr.refidx,
+				pr.rect,
+				const_cast<char *>(pr.ref.buf()),
+				0,
+				pr.ref.length(),
+				pr.reflen,
+				*w.sc,
+				k.native ? pr.minsc : minsc,
+				k.use8,
+				cminlen,
+				cpow2,
+				doTri,
+				true);
+			TAlScore best = std::numeric_limits<TAlScore>::min();
+			bool aligned = sw.align(best);
+			w.nprob++;
+			w.ncells += rdlen * pr.ref.length();
+			if(aligned) w.naligned++;
+			if(k.native && pr.known &&
+			   (aligned != pr.aligned || (aligned && best != pr.score)))
+			{
+				w.nmismatch++;
+			}
+		}
+	}
+}
+
+#ifdef WITH_TBB
+struct DpTask {
+	DpTask(DpWorker* w) : w_(w) { }
+	void operator()() const { dpWorker((void*)w_); }
+	DpWorker* w_;
+};
+#endif
+
+static inline uint64_t dpUsecs() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (uint64_t)tv.tv_sec * 1000000 + (uint64_t)tv.tv_usec;
+}
+
 int main(int argc, const char **argv) {
 	try {
 		// Reset all global state, including getopt state
@@ -668,6 +797,11 @@ int main(int argc, const char **argv) {
 		while(optind < argc) {
 			queries.push_back(argv[optind++]);
 		}
+		if(queries.empty()) {
+			cerr << "No DP log specified" << endl;
+			printUsage(cerr);
+			return 1;
+		}
 		{
 			// Optionally summarize
 			if(gVerbose) {
@@ -684,15 +818,25 @@ int main(int argc, const char **argv) {
 			#endif
 			}
 		}
-		// Do stuff
-		SwAligner sw(NULL);
-		DpLogReader logrd;
-		Scoring sc(
-			bonusMatch,     // constant reward for match
+		// Scoring for the mode the log was written in comes from the
+		// options; the other mode gets its defaults
+		SimpleFunc scoreMinEe, scoreMinLoc;
+		scoreMinEe.init (SIMPLE_FUNC_LINEAR, DEFAULT_MIN_CONST, DEFAULT_MIN_LINEAR);
+		scoreMinLoc.init(SIMPLE_FUNC_LOG, 20.0f, 8.0f);
+		if(localAlign) {
+			if(!scoreMinSet) scoreMin = scoreMinLoc;
+			scoreMinLoc = scoreMin;
+			if(!bonusMatchSet) bonusMatch = DEFAULT_MATCH_BONUS_LOCAL;
+		} else {
+			scoreMinEe = scoreMin;
+			bonusMatch = 0;
+		}
+		Scoring scEe(
+			localAlign ? DEFAULT_MATCH_BONUS : bonusMatch,
 			penMmcType,     // how to penalize mismatches
 			penMmcMax,      // max mm pelanty
 			penMmcMin,      // min mm pelanty
-			scoreMin,       // min score as function of read len
+			scoreMinEe,     // min score as function of read len
 			nCeil,          // max # Ns as function of read len
 			penNType,       // how to penalize Ns in the read
 			penN,           // constant if N pelanty is a constant
@@ -702,71 +846,124 @@ int main(int argc, const char **argv) {
 			penRdGapLinear, // linear coeff for read gap cost
 			penRfGapLinear, // linear coeff for ref gap cost
 			gGapBarrier);   // # rows at top/bot only entered diagonally
-		RandomSource rnd(seed);
+		Scoring scLoc(
+			localAlign ? bonusMatch : DEFAULT_MATCH_BONUS_LOCAL,
+			penMmcType,
+			penMmcMax,
+			penMmcMin,
+			scoreMinLoc,
+			nCeil,
+			penNType,
+			penN,
+			penNCatPair,
+			penRdGapConst,
+			penRfGapConst,
+			penRdGapLinear,
+			penRfGapLinear,
+			gGapBarrier);
+		// Load all the problems up front so that only DP is timed
+		EList<DpRead> reads;
+		size_t nprobs = 0, nskipped = 0;
 		{
-			Timer tim(std::cerr, "Alignment ", true);
-			BTDnaString seq, seqrc;
-			BTString qual, qualrc;
-			EList<DpProblem> probs;
-			size_t qid = 0;
-			size_t totnuc = 0, totcup = 0;
-			for(size_t i = 0; i < queries.size(); i++) {
+			Timer tim(std::cerr, "Reading DP log ", !gQuiet);
+			DpLogReader logrd;
+			for(size_t i = 0; i < queries.size() && reads.size() < qUpto; i++) {
 				logrd.init(queries[i]);
-				while(logrd.nextRead(seq, qual, probs)) {
-					totnuc += seq.length();
-					seqrc = seq;
-					seqrc.reverseComp();
-					qualrc = qual;
-					qualrc.reverse();
-					//cerr << "Initing read with " << probs.size() << " problems" << endl;
-					sw.initRead(seq, seqrc, qual, qualrc, 0, seq.length(), sc);
-					// Calculate minimum score
-					bool extend = true;
-					for(size_t j = 0; j < probs.size(); j++) {
-						sw.initRef(
-							probs[j].fw,
-							probs[j].refidx,
-							probs[j].rect,
-							const_cast<char *>(probs[j].ref.toZBuf()),
-							0,
-							probs[j].ref.length(),
-							probs[j].reflen,
-							sc,
-							probs[j].minsc,
-							enable8,
-							cminlen,
-							cpow2,
-							doTri,
-							extend);
-						// Now fill the dynamic programming matrix and return true iff
-						// there is at least one valid alignment
-						TAlScore bestCell = std::numeric_limits<TAlScore>::min();
-						ASSERT_ONLY(bool aligned =) sw.align(bestCell);
-						assert(aligned == probs[j].aligned);
-						assert(!aligned || bestCell == probs[j].score);
-						totcup += (seq.length() * probs[j].ref.length());
+				while(reads.size() < qUpto) {
+					reads.expand();
+					DpRead& r = reads.back();
+					r.probs.clear();
+					if(!logrd.nextRead(r.seq, r.qual, r.probs)) {
+						reads.pop_back();
+						break;
+					}
+					if(nskipped < skipReads) {
+						nskipped++;
+						reads.pop_back();
+						continue;
 					}
-					seq.clear();  seqrc.clear();
-					qual.clear(); qualrc.clear();
-					probs.clear();
-					qid++;
+					r.seqrc = r.seq;
+					r.seqrc.reverseComp();
+					r.qualrc = r.qual;
+					r.qualrc.reverse();
+					nprobs += r.probs.size();
 				}
 			}
-			size_t el = (size_t)tim.elapsed();
-			double cups = 0.0;
-			double totnucps = 0.0;
-			double readps = 0.0;
-			if(el > 0) {
-				cups = totcup / (double)el;
-				totnucps = totnuc / (double)el;
-				readps = qid / (double)el;
+		}
+		if(!gQuiet) {
+			cerr << reads.size() << " reads, " << nprobs << " DP problems, "
+			     << nthreads << " thread(s)" << endl;
+		}
+		const DpKernel kernels[] = {
+			{ "ee_u8",   false, true,  !localAlign },
+			{ "ee_i16",  false, false, !localAlign },
+			{ "loc_u8",  true,  true,  localAlign },
+			{ "loc_i16", true,  false, localAlign }
+		};
+		ofstream fout;
+		if(!outfile.empty()) {
+			fout.open(outfile.c_str());
+			if(!fout.good()) {
+				cerr << "Error: could not open " << outfile.c_str() << " for writing" << endl;
+				return 1;
 			}
-			cerr << qid << " reads" << endl;
-			cerr << std::setprecision(4) << "  " << readps << " reads per second" << endl;
-			cerr << totnuc << " nucleotides" << endl;
-			cerr << std::setprecision(4) << "  " << totnucps << " nucleotides per second" << endl;
-			cerr << totcup << " cell updates" << endl;
-			cerr << std::setprecision(4) << "  " << cups << " cell updates per second (CUPS)" << endl;
+		}
+		ostream& out = outfile.empty() ? cout : fout;
+		out << "#kernel\tproblems\taligned\tcells\tsecs\tGCUPS\tmismatches" << endl;
+		AutoArray<DpWorker> workers(nthreads);
+		for(size_t ki = 0; ki < sizeof(kernels)/sizeof(kernels[0]); ki++) {
+			const DpKernel& k = kernels[ki];
+			if(!kernelSet.empty() && !kernelSet.contains(string(k.name))) {
+				continue;
+			}
+			for(int t = 0; t < nthreads; t++) {
+				DpWorker& w = workers[t];
+				w.tid = t;
+				w.reads = &reads;
+				w.kernel = &k;
+				w.sc = k.local ? &scLoc : &scEe;
+				w.minfunc = k.local ? &scoreMinLoc : &scoreMinEe;
+				w.nprob = w.naligned = w.ncells = w.nmismatch = 0;
+			}
+			uint64_t t0 = dpUsecs();
+			if(nthreads == 1) {
+				dpWorker((void*)&workers[0]);
+			} else {
+#ifdef WITH_TBB
+				tbb::task_group tbb_grp;
+				for(int t = 0; t < nthreads; t++) {
+					tbb_grp.run(DpTask(&workers[t]));
+				}
+				tbb_grp.wait();
+#else
+				AutoArray<tthread::thread*> threads(nthreads);
+				for(int t = 0; t < nthreads; t++) {
+					threads[t] = new tthread::thread(dpWorker, (void*)&workers[t]);
+				}
+				for(int t = 0; t < nthreads; t++) {
+					threads[t]->join();
+					delete threads[t];
+				}
+#endif
+			}
+			double secs = (dpUsecs() - t0) / 1000000.0;
+			uint64_t nprob = 0, naligned = 0, ncells = 0, nmismatch = 0;
+			for(int t = 0; t < nthreads; t++) {
+				nprob     += workers[t].nprob;
+				naligned  += workers[t].naligned;
+				ncells    += workers[t].ncells;
+				nmismatch += workers[t].nmismatch;
+			}
+			out << k.name << '\t' << nprob << '\t' << naligned << '\t'
+			    << ncells << '\t' << fixed << setprecision(4) << secs << '\t'
+			    << setprecision(3) << (secs > 0.0 ? ncells / secs / 1e9 : 0.0)
+			    << '\t';
+			if(k.native) {
+				out << nmismatch;
+			} else {
+				out << '-';
+			}
+			out << endl;
 		}
 		return 0;
 	} catch(std::exception& e) {
@@ -785,4 +982,3 @@ int main(int argc, const char **argv) {
 		return e;
 	}
 }
-
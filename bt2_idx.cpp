@@ -128,7 +128,7 @@ void Ebwt::joinedToTextOff(
  * walk through the dollar sign, return max value.
  */
 TIndexOffU Ebwt::walkLeft(TIndexOffU row, TIndexOffU steps) const {
-	assert(offs() != NULL);
+	assert(offsLoaded());
 	assert_neq(OFF_MASK, row);
 	SideLocus l;
 	if(steps > 0) l.initFromRow(row, _eh, ebwt());
@@ -148,10 +148,10 @@ TIndexOffU Ebwt::walkLeft(TIndexOffU row, TIndexOffU steps) const {
  * Resolve the reference offset of the BW element 'elt'.
  */
 TIndexOffU Ebwt::getOffset(TIndexOffU row) const {
-	assert(offs() != NULL);
+	assert(offsLoaded());
 	assert_neq(OFF_MASK, row);
 	if(row == _zOff) return 0;
-	if((row & _eh._offMask) == row) return this->offs()[row >> _eh._offRate];
+	if((row & _eh._offMask) == row) return this->offsAt(row >> _eh._offRate);
 	TIndexOffU jumps = 0;
 	SideLocus l;
 	l.initFromRow(row, _eh, ebwt());
@@ -164,7 +164,7 @@ TIndexOffU Ebwt::getOffset(TIndexOffU row) const {
 		if(row == _zOff) {
 			return jumps;
 		} else if((row & _eh._offMask) == row) {
-			return jumps + this->offs()[row >> _eh._offRate];
+			return jumps + this->offsAt(row >> _eh._offRate);
 		}
 		l.initFromRow(row, _eh, ebwt());
 	}
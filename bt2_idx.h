@@ -475,6 +475,8 @@ inline static int countInU64(int c, uint64_t dw) {
 
 // Forward declarations for Ebwt class
 class EbwtSearchParams;
+class HotSeeds;
+class Ftab2;
 
 /**
  * Extended Burrows-Wheeler transform data.
@@ -507,12 +509,15 @@ public:
 	    _ftab(EBWT_CAT), \
 	    _eftab(EBWT_CAT), \
 	    _offs(EBWT_CAT), \
+	    _offsPacked(EBWT_CAT), \
 	    _ebwt(EBWT_CAT), \
 	    _useMm(false), \
 	    useShmem_(false), \
 	    _refnames(EBWT_CAT), \
 	    mmFile1_(NULL), \
-	    mmFile2_(NULL)
+	    mmFile2_(NULL), \
+	    _hot(NULL), \
+	    _ftab2(NULL)
 
 	/// Construct an Ebwt from the given input file
 	Ebwt(const string& in,
@@ -587,6 +592,8 @@ public:
 		TIndexOffU bmaxSqrtMult,
 		TIndexOffU bmaxDivN,
 		int dcv,
+		bool onePass,
+		int sais,
 		EList<FileBuf*>& is,
 		EList<RefRecord>& szs,
 		TIndexOffU sztot,
@@ -597,7 +604,10 @@ public:
 		bool doBwtFile = false,
 		bool verbose = false,
 		bool passMemExc = false,
-		bool sanityCheck = false) :
+		bool sanityCheck = false,
+		TStr* joined = NULL,                    // reference already read & joined
+		const EList<string>* joinedNames = NULL, // its sequence names
+		EList<TIndexOffU>* baseSA = NULL) :     // SA of an index being appended to
 		Ebwt_INITS,
 		_eh(
 			joinedLen(szs),
@@ -665,8 +675,13 @@ public:
 		    bmaxSqrtMult,
 		    bmaxDivN,
 		    dcv,
+		    onePass,
+		    sais,
 		    seed,
-		    verbose);
+		    verbose,
+		    joined,
+		    joinedNames,
+		    baseSA);
 		// Close output files
 		fout1.flush();
 		
@@ -853,6 +868,8 @@ public:
 			bmaxSqrtMult, // block size as multiplier of sqrt(len)
 			bmaxDivN,     // block size as divisor of len
 			dcv,          // difference-cover period
+			false,        // classify suffixes into buckets in one pass?
+			0,            // never build the SA by induced sorting
 			is,           // list of input streams
 			szs,          // list of reference sizes
 			sztot.first,  // total size of all unambiguous ref chars
@@ -881,6 +898,8 @@ public:
 			bmaxSqrtMult, // block size as multiplier of sqrt(len)
 			bmaxDivN,     // block size as divisor of len
 			dcv,          // difference-cover period
+			false,        // classify suffixes into buckets in one pass?
+			0,            // never build the SA by induced sorting
 			is,           // list of input streams
 			szs,          // list of reference sizes
 			sztot.first,  // total size of all unambiguous ref chars
@@ -907,9 +926,17 @@ public:
 	 * joinToDisk, which does a join (with padding) and writes some of
 	 * the resulting data directly to disk rather than keep it in
 	 * memory.  It then constructs a suffix-array producer (what kind
-	 * depends on 'useBlockwise') for the resulting sequence.  The
-	 * suffix-array producer can then be used to obtain chunks of the
-	 * joined string's suffix array.
+	 * depends on 'useBlockwise' and 'sais') for the resulting sequence.
+	 * The suffix-array producer can then be used to obtain chunks of the
+	 * joined string's suffix array.  'sais' > 0 asks for the whole SA to
+	 * be built at once by induced sorting, 0 forbids it, and < 0 uses it
+	 * when the unpacked text is small enough for it to fit comfortably.
+	 *
+	 * If baseSA is non-NULL, the joined text is an existing index's text
+	 * with more sequences appended, and baseSA is the existing index's
+	 * full suffix array (as recovered by restoreSA()).  The new SA is then
+	 * made by merging the new suffixes into baseSA instead of sorting from
+	 * scratch; baseSA is consumed in the process.
 	 */
 	template <typename TStr>
 	void initFromVector(EList<FileBuf*>& is,
@@ -925,23 +952,41 @@ public:
 	                    TIndexOffU bmaxSqrtMult,
 	                    TIndexOffU bmaxDivN,
 	                    int dcv,
+	                    bool onePass,
+	                    int sais,
 	                    uint32_t seed,
-	                    bool verbose)
+	                    bool verbose,
+	                    TStr* joined = NULL,
+	                    const EList<string>* joinedNames = NULL,
+	                    EList<TIndexOffU>* baseSA = NULL)
 	{
 		// Compose text strings into single string
 		VMSG_NL("Calculating joined length");
-		TStr s; // holds the entire joined reference after call to joinToDisk
+		TStr sLocal; // holds the entire joined reference after call to joinToDisk
+		// If the caller already read and joined the reference (with
+		// REF_READ_FORWARD), use (and, for the mirror index, reverse)
+		// its copy instead
+		TStr& s = (joined != NULL ? *joined : sLocal);
 		TIndexOffU jlen;
 		jlen = joinedLen(szs);
 		assert_geq(jlen, sztot);
 		VMSG_NL("Writing header");
 		writeFromMemory(true, out1, out2);
 		try {
-			VMSG_NL("Reserving space for joined string");
-			s.resize(jlen);
-			VMSG_NL("Joining reference sequences");
+			if(joined != NULL) {
+				assert(joinedNames != NULL);
+				assert_eq(jlen, s.length());
+				assert_neq(REF_READ_REVERSE_EACH, refparams.reverse);
+				VMSG_NL("Using already-joined reference sequences");
+				joinHeaderToDisk(szs, out1);
+				_refnames = *joinedNames;
+			} else {
+				VMSG_NL("Reserving space for joined string");
+				s.resize(jlen);
+				VMSG_NL("Joining reference sequences");
+			}
 			if(refparams.reverse == REF_READ_REVERSE) {
-				{
+				if(joined == NULL) {
 					Timer timer(cout, "  Time to join reference sequences: ", _verbose);
 					joinToDisk(is, szs, sztot, refparams, s, out1, out2);
 				} {
@@ -952,8 +997,10 @@ public:
 					szsToDisk(tmp, out1, refparams.reverse);
 				}
 			} else {
-				Timer timer(cout, "  Time to join reference sequences: ", _verbose);
-				joinToDisk(is, szs, sztot, refparams, s, out1, out2);
+				if(joined == NULL) {
+					Timer timer(cout, "  Time to join reference sequences: ", _verbose);
+					joinToDisk(is, szs, sztot, refparams, s, out1, out2);
+				}
 				szsToDisk(szs, out1, refparams.reverse);
 			}
 			// Joined reference sequence now in 's'
@@ -1007,8 +1054,45 @@ public:
 		bool first = true;
 		streampos out1pos = out1.tellp();
 		streampos out2pos = out2.tellp();
+		bool built = false;
+		if(baseSA != NULL) {
+			// The mirror index's text is reversed, so the appended
+			// sequences end up in front of the existing text
+			VMSG_NL("Constructing suffix array by merging into existing index");
+			MergedBlockwiseSA<TStr> bsa(s, *baseSA, refparams.reverse == REF_READ_REVERSE, _sanity, _passMemExc, _verbose);
+			assert(bsa.suffixItrIsReset());
+			assert_eq(bsa.size(), s.length()+1);
+			VMSG_NL("Converting suffix-array elements to index image");
+			buildToDisk(bsa, s, out1, out2, saOut, bwtOut);
+			flushIndexFiles(out1, out2, saOut, bwtOut);
+			built = true;
+		} else if(sais > 0 || (sais < 0 && !isPacked() && !onePass &&
+		                SaisBlockwiseSA<TStr>::footprint(s.length()) <= SaisBlockwiseSA<TStr>::autoMaxBytes))
+		{
+			try {
+				VMSG_NL("  Doing ahead-of-time memory usage test for induced sorting");
+				SaisBlockwiseSA<TStr>::simulateAllocs(s);
+				VMSG_NL("Constructing suffix array by induced sorting");
+				SaisBlockwiseSA<TStr> bsa(s, _sanity, _passMemExc, _verbose);
+				assert(bsa.suffixItrIsReset());
+				assert_eq(bsa.size(), s.length()+1);
+				VMSG_NL("Converting suffix-array elements to index image");
+				buildToDisk(bsa, s, out1, out2, saOut, bwtOut);
+				flushIndexFiles(out1, out2, saOut, bwtOut);
+				built = true;
+			} catch(bad_alloc& e) {
+				if(!_passMemExc) {
+					cerr << "Out of memory while constructing suffix array by induced sorting.  Please" << endl
+					     << "try again without --sais" << endl;
+					throw 1;
+				}
+				VMSG_NL("  Ran out of memory; falling back to blockwise suffix sorting");
+				out1.seekp(out1pos);
+				out2.seekp(out2pos);
+			}
+		}
 		// Look for bmax/dcv parameters that work.
-		while(true) {
+		while(!built) {
 			if(!first && bmax < 40 && _passMemExc) {
 				cerr << "Could not find approrpiate bmax/dcv settings for building this index." << endl;
 				if(!isPacked()) {
@@ -1070,25 +1154,15 @@ public:
 					VMSG_NL("");
 				}
 				VMSG_NL("Constructing suffix-array element generator");
-				KarkkainenBlockwiseSA<TStr> bsa(s, bmax, dcv, seed, _sanity, _passMemExc, _verbose);
+				// In one-pass mode, bucket members are spilled to a
+				// temporary file next to the index files
+				string spillFn = onePass ? (_in1Str + ".buckets.tmp") : string();
+				KarkkainenBlockwiseSA<TStr> bsa(s, bmax, dcv, seed, spillFn, _sanity, _passMemExc, _verbose);
 				assert(bsa.suffixItrIsReset());
 				assert_eq(bsa.size(), s.length()+1);
 				VMSG_NL("Converting suffix-array elements to index image");
 				buildToDisk(bsa, s, out1, out2, saOut, bwtOut);
-				out1.flush(); out2.flush();
-				bool failed = out1.fail() || out2.fail();
-				if(saOut != NULL) {
-					saOut->flush();
-					failed = failed || saOut->fail();
-				}
-				if(bwtOut != NULL) {
-					bwtOut->flush();
-					failed = failed || bwtOut->fail();
-				}
-				if(failed) {
-					cerr << "An error occurred writing the index to disk.  Please check if the disk is full." << endl;
-					throw 1;
-				}
+				flushIndexFiles(out1, out2, saOut, bwtOut);
 				break;
 			} catch(bad_alloc& e) {
 				if(_passMemExc) {
@@ -1116,6 +1190,32 @@ public:
 		VMSG_NL("Returning from initFromVector");
 	}
 	
+	/**
+	 * Flush the files written by buildToDisk; print an error and throw 1
+	 * if any of them failed.
+	 */
+	void flushIndexFiles(
+		ofstream& out1,
+		ofstream& out2,
+		ofstream* saOut,
+		ofstream* bwtOut)
+	{
+		out1.flush(); out2.flush();
+		bool failed = out1.fail() || out2.fail();
+		if(saOut != NULL) {
+			saOut->flush();
+			failed = failed || saOut->fail();
+		}
+		if(bwtOut != NULL) {
+			bwtOut->flush();
+			failed = failed || bwtOut->fail();
+		}
+		if(failed) {
+			cerr << "An error occurred writing the index to disk.  Please check if the disk is full." << endl;
+			throw 1;
+		}
+	}
+
 	/**
 	 * Return the length that the joined string of the given string
 	 * list will have.  Note that this is indifferent to how the text
@@ -1138,6 +1238,7 @@ public:
 		_plen.reset();
 		_rstarts.reset();
 		_offs.reset();
+		_offsPacked.reset();
 		_ebwt.reset();
 		if(offs() != NULL && useShmem_) {
 			FREE_SHARED(offs());
@@ -1170,6 +1271,66 @@ public:
 	inline const TIndexOffU* plen() const    { return _plen.get(); }
 	inline const TIndexOffU* rstarts() const { return _rstarts.get(); }
 	inline const uint8_t*  ebwt() const    { return _ebwt.get(); }
+
+	/**
+	 * Set/get the table of precomputed offsets for the BW rows of frequent
+	 * seeds (see hot_seeds.h); NULL if there is none.  The Ebwt doesn't
+	 * take ownership of it.
+	 */
+	void setHotSeeds(const HotSeeds *hot) { _hot = hot; }
+	const HotSeeds* hotSeeds() const      { return _hot; }
+
+	/**
+	 * Set/get the second level of the ftab (see ftab2.h); NULL if there is
+	 * none.  The Ebwt doesn't take ownership of it.
+	 */
+	void setFtab2(const Ftab2 *f2)        { _ftab2 = f2; }
+	const Ftab2* ftab2() const            { return _ftab2; }
+
+	/**
+	 * Return true iff the SA samples are loaded, either as full words in
+	 * _offs or packed in _offsPacked.
+	 */
+	inline bool offsLoaded() const {
+		return offs() != NULL || _offsPacked.get() != NULL;
+	}
+
+	/**
+	 * Return the ith SA sample.
+	 */
+	inline TIndexOffU offsAt(TIndexOffU i) const {
+#ifdef BOWTIE_64BIT_INDEX
+		if(_offsPacked.get() != NULL) {
+			const uint8_t *b = _offsPacked.get() + i * OFFS_PACKED_BYTES;
+			TIndexOffU off = 0;
+			for(int j = OFFS_PACKED_BYTES - 1; j >= 0; j--) {
+				off = (off << 8) | b[j];
+			}
+			return off;
+		}
+#endif
+		assert(offs() != NULL);
+		return offs()[i];
+	}
+
+	/**
+	 * Set the ith SA sample.
+	 */
+	inline void setOffsAt(TIndexOffU i, TIndexOffU off) {
+#ifdef BOWTIE_64BIT_INDEX
+		if(_offsPacked.get() != NULL) {
+			assert_eq(0, off >> (OFFS_PACKED_BYTES * 8));
+			uint8_t *b = _offsPacked.get() + i * OFFS_PACKED_BYTES;
+			for(int j = 0; j < OFFS_PACKED_BYTES; j++) {
+				b[j] = (uint8_t)(off >> (j * 8));
+			}
+			return;
+		}
+#endif
+		assert(offs() != NULL);
+		offs()[i] = off;
+	}
+
 	bool        toBe() const         { return _toBigEndian; }
 	bool        verbose() const      { return _verbose; }
 	bool        sanityCheck() const  { return _sanity; }
@@ -1221,7 +1382,7 @@ public:
 			assert(ftab() == NULL);
 			assert(eftab() == NULL);
 			assert(fchr() == NULL);
-			assert(offs() == NULL);
+			assert(!offsLoaded());
 			assert(rstarts() == NULL);
 			assert_eq(_zEbwtByteOff, OFF_MASK);
 			assert_eq(_zEbwtBpOff, -1);
@@ -1270,6 +1431,7 @@ public:
 		_eftab.free();
 		_rstarts.free();
 		_offs.free(); // might not be under control of APtrWrap
+		_offsPacked.reset(); // always ours; also forget its length
 		_ebwt.free(); // might not be under control of APtrWrap
 		// Keep plen; it's small and the client may want to seq it
 		// even when the others are evicted.
@@ -1434,12 +1596,12 @@ public:
 	 * it cannot be resolved immediately, return max value.
 	 */
 	TIndexOffU tryOffset(TIndexOffU elt) const {
-		assert(offs() != NULL);
+		assert(offsLoaded());
 		if(elt == _zOff) return 0;
 		if((elt & _eh._offMask) == elt) {
 			TIndexOffU eltOff = elt >> _eh._offRate;
 			assert_lt(eltOff, _eh._offsLen);
-			TIndexOffU off = offs()[eltOff];
+			TIndexOffU off = offsAt(eltOff);
 			assert_neq(OFF_MASK, off);
 			return off;
 		} else {
@@ -1568,10 +1730,10 @@ public:
 			out << "non-NULL, [0] = " << eftab()[0] << endl;
 		}
 		out << "    offs: ";
-		if(offs() == NULL) {
+		if(!offsLoaded()) {
 			out << "NULL" << endl;
 		} else {
-			out << "non-NULL, [0] = " << offs()[0] << endl;
+			out << "non-NULL, [0] = " << offsAt(0) << endl;
 		}
 	}
 
@@ -1579,17 +1741,21 @@ public:
 	template <typename TStr> static TStr join(EList<TStr>& l, uint32_t seed);
 	template <typename TStr> static TStr join(EList<FileBuf*>& l, EList<RefRecord>& szs, TIndexOffU sztot, const RefReadInParams& refparams, uint32_t seed);
 	template <typename TStr> void joinToDisk(EList<FileBuf*>& l, EList<RefRecord>& szs, TIndexOffU sztot, const RefReadInParams& refparams, TStr& ret, ostream& out1, ostream& out2);
+	template <typename TStr> static void joinRefs(EList<FileBuf*>& l, EList<RefRecord>& szs, TIndexOffU sztot, const RefReadInParams& refparams, TStr& ret, EList<string>& refnames);
+	void joinHeaderToDisk(EList<RefRecord>& szs, ostream& out1);
 	template <typename TStr> void buildToDisk(InorderBlockwiseSA<TStr>& sa, const TStr& s, ostream& out1, ostream& out2, ostream* saOut, ostream* bwtOut);
 
 	// I/O
 	void readIntoMemory(int color, int needEntireRev, bool loadSASamp, bool loadFtab, bool loadRstarts, bool justHeader, EbwtParams *params, bool mmSweep, bool loadNames, bool startVerbose);
 	void writeFromMemory(bool justHeader, ostream& out1, ostream& out2) const;
 	void writeFromMemory(bool justHeader, const string& out1, const string& out2) const;
+	static uint64_t fingerprint(const string& base); // of the .1/.2 files
 
 	// Sanity checking
 	void sanityCheckUpToSide(TIndexOff upToSide) const;
 	void sanityCheckAll(int reverse) const;
 	void restore(SString<char>& s) const;
+	template <typename TStr> void restoreSA(EList<TIndexOffU>& sa, TStr* s) const;
 	void checkOrigs(const EList<SString<char> >& os, bool color, bool mirror) const;
 
 	// Searching and reporting
@@ -2391,6 +2557,11 @@ template<typename Operation>
 	// offset every 16 rows), the total size of _offs is the same as
 	// the total size of the input sequence
 	APtrWrap<TIndexOffU> _offs;
+	// In large-index mode, when every reference offset fits in
+	// OFFS_PACKED_BYTES bytes and the index isn't memory-mapped or in shared
+	// memory, the SA samples are held here instead of in _offs, packed
+	// little-endian into OFFS_PACKED_BYTES bytes each.
+	APtrWrap<uint8_t> _offsPacked;
 	// _ebwt is the Extended Burrows-Wheeler Transform itself, and thus
 	// is at least as large as the input sequence.
 	APtrWrap<uint8_t> _ebwt;
@@ -2399,6 +2570,8 @@ template<typename Operation>
 	EList<string> _refnames; /// names of the reference sequences
 	char *mmFile1_;
 	char *mmFile2_;
+	const HotSeeds *_hot; /// precomputed offsets for frequent seeds, or NULL
+	const Ftab2 *_ftab2;  /// second level of the ftab, or NULL
 	EbwtParams _eh;
 	bool packed_;
 
@@ -2555,81 +2728,61 @@ void Ebwt::joinToDisk(
 	TStr& ret,
 	ostream& out1,
 	ostream& out2)
+{
+	assert_gt(l.size(), 0);
+	assert_gt(sztot, 0);
+	joinHeaderToDisk(szs, out1);
+	_refnames.clear();
+	joinRefs(l, szs, sztot, refparams, ret, _refnames);
+	assert_eq(_nPat, _refnames.size());
+}
+
+/**
+ * Read the reference sequences in 'l' and join them into 'ret', which
+ * must already be sized to hold them, appending their names to
+ * 'refnames'.  Unlike joinToDisk, this doesn't touch any Ebwt, so
+ * one parse of the reference can be shared by the forward and mirror
+ * index builds.
+ */
+template<typename TStr>
+void Ebwt::joinRefs(
+	EList<FileBuf*>& l,
+	EList<RefRecord>& szs,
+	TIndexOffU sztot,
+	const RefReadInParams& refparams,
+	TStr& ret,
+	EList<string>& refnames)
 {
 	RefReadInParams rpcp = refparams;
 	assert_gt(szs.size(), 0);
 	assert_gt(l.size(), 0);
 	assert_gt(sztot, 0);
-	// Not every fragment represents a distinct sequence - many
-	// fragments may correspond to a single sequence.  Count the
-	// number of sequences here by counting the number of "first"
-	// fragments.
-	this->_nPat = 0;
-	this->_nFrag = 0;
-	for(TIndexOffU i = 0; i < szs.size(); i++) {
-		if(szs[i].len > 0) this->_nFrag++;
-		if(szs[i].first && szs[i].len > 0) this->_nPat++;
-	}
-	assert_gt(this->_nPat, 0);
-	assert_geq(this->_nFrag, this->_nPat);
-	_rstarts.reset();
-	writeU<TIndexOffU>(out1, this->_nPat, this->toBe());
-	// Allocate plen[]
-	try {
-		this->_plen.init(new TIndexOffU[this->_nPat], this->_nPat);
-	} catch(bad_alloc& e) {
-		cerr << "Out of memory allocating plen[] in Ebwt::join()"
-		     << " at " << __FILE__ << ":" << __LINE__ << endl;
-		throw e;
-	}
-	// For each pattern, set plen
-	TIndexOff npat = -1;
-	for(TIndexOffU i = 0; i < szs.size(); i++) {
-		if(szs[i].first && szs[i].len > 0) {
-			if(npat >= 0) {
-				writeU<TIndexOffU>(out1, this->plen()[npat], this->toBe());
-			}
-			npat++;
-			this->plen()[npat] = (szs[i].len + szs[i].off);
-		} else {
-			this->plen()[npat] += (szs[i].len + szs[i].off);
-		}
-	}
-	assert_eq((TIndexOffU)npat, this->_nPat-1);
-	writeU<TIndexOffU>(out1, this->plen()[npat], this->toBe());
-	// Write the number of fragments
-	writeU<TIndexOffU>(out1, this->_nFrag, this->toBe());
 	TIndexOffU seqsRead = 0;
 	ASSERT_ONLY(TIndexOffU szsi = 0);
-	ASSERT_ONLY(TIndexOffU entsWritten = 0);
 	TIndexOffU dstoff = 0;
 	// For each filebuf
 	for(unsigned int i = 0; i < l.size(); i++) {
 		assert(!l[i]->eof());
 		bool first = true;
-		TIndexOffU patoff = 0;
 		// For each *fragment* (not necessary an entire sequence) we
 		// can pull out of istream l[i]...
 		while(!l[i]->eof()) {
-			string name;
 			// Push a new name onto our vector
-			_refnames.push_back("");
+			refnames.push_back("");
 			RefRecord rec = fastaRefReadAppend(
-				*l[i], first, ret, dstoff, rpcp, &_refnames.back());
+				*l[i], first, ret, dstoff, rpcp, &refnames.back());
 			first = false;
-			TIndexOffU bases = rec.len;
 			if(rec.first && rec.len > 0) {
-				if(_refnames.back().length() == 0) {
+				if(refnames.back().length() == 0) {
 					// If name was empty, replace with an index
 					ostringstream stm;
 					stm << seqsRead;
-					_refnames.back() = stm.str();
+					refnames.back() = stm.str();
 				}
 			} else {
 				// This record didn't actually start a new sequence so
 				// no need to add a name
-				//assert_eq(0, _refnames.back().length());
-				_refnames.pop_back();
+				refnames.pop_back();
 			}
 			assert_lt(szsi, szs.size());
 			assert_eq(rec.off, szs[szsi].off);
@@ -2639,19 +2792,6 @@ void Ebwt::joinToDisk(
 			ASSERT_ONLY(szsi++);
 			// Increment seqsRead if this is the first fragment
 			if(rec.first && rec.len > 0) seqsRead++;
-			if(bases == 0) continue;
-			assert_leq(bases, this->plen()[seqsRead-1]);
-			// Reset the patoff if this is the first fragment
-			if(rec.first) patoff = 0;
-			patoff += rec.off; // add fragment's offset from end of last frag.
-			// Adjust rpcps
-			//uint32_t seq = seqsRead-1;
-			ASSERT_ONLY(entsWritten++);
-			// This is where rstarts elements are written to the output stream
-			//writeU32(out1, oldRetLen, this->toBe()); // offset from beginning of joined string
-			//writeU32(out1, seq,       this->toBe()); // sequence id
-			//writeU32(out1, patoff,    this->toBe()); // offset into sequence
-			patoff += bases;
 		}
 		assert_gt(szsi, 0);
 		l[i]->reset();
@@ -2664,7 +2804,6 @@ void Ebwt::joinToDisk(
 		assert(!l[i]->eof());
 #endif
 	}
-	assert_eq(entsWritten, this->_nFrag);
 }
 
 /**
@@ -3038,6 +3177,39 @@ void Ebwt::buildToDisk(
 	VMSG_NL("Exiting Ebwt::buildToDisk()");
 }
 
+/**
+ * Like restore(), but also recover the full suffix array: walk the LF
+ * mapping backwards from the row for the '$' suffix, setting sa[row] to
+ * the text offset of each row visited.  sa ends up with _eh._len+1
+ * elements.  If s is non-NULL, the text is also written into the first
+ * _eh._len elements of *s, which must already be at least that long.
+ * The Ebwt must be in memory.
+ */
+template<typename TStr>
+void Ebwt::restoreSA(EList<TIndexOffU>& sa, TStr* s) const {
+	assert(isInMemory());
+	TIndexOffU len = this->_eh._len;
+	assert(s == NULL || s->length() >= len);
+	sa.resizeExact(len+1);
+	TIndexOffU i = len; // should point to final SA elt (starting with '$')
+	TIndexOffU off = len;
+	sa[i] = off;
+	SideLocus l(i, this->_eh, this->ebwt());
+	while(i != _zOff) {
+		assert_gt(off, 0);
+		TIndexOffU newi = mapLF(l ASSERT_ONLY(, false));
+		assert_neq(newi, i);
+		off--;
+		if(s != NULL) {
+			s->set(rowL(l), off);
+		}
+		i = newi;
+		sa[i] = off;
+		l.initFromRow(i, this->_eh, this->ebwt());
+	}
+	assert_eq(0, off);
+}
+
 /**
  * Try to find the Bowtie index specified by the user.  First try the
  * exact path given by the user.  Then try the user-provided string
@@ -518,17 +518,43 @@ void Ebwt::readIntoMemory(
 	}
 	
 	_offs.reset();
+	_offsPacked.reset();
 	if(loadSASamp) {
 		bytesRead = 4; // reset for secondary index file (already read 1-sentinel)
 		
+		// In large-index mode, hold the SA samples in OFFS_PACKED_BYTES
+		// bytes apiece rather than 8 when every offset fits, which is the
+		// case for any reference shorter than 1 Tbp.  Not possible when
+		// the samples are used in place from a memory-mapped file or
+		// shared memory.
+		bool packOffs = false;
+#ifdef BOWTIE_64BIT_INDEX
+		packOffs = !_useMm && !useShmem_ &&
+		           (eh->_len >> (OFFS_PACKED_BYTES * 8)) == 0;
+#endif
 		shmemLeader = true;
 		if(_verbose || startVerbose) {
-			cerr << "Reading offs (" << offsLenSampled << std::setw(2) << OFF_SIZE*8 <<"-bit words): ";
+			cerr << "Reading offs (" << offsLenSampled << std::setw(2) << OFF_SIZE*8 <<"-bit words";
+			if(packOffs) {
+				cerr << ", packed to " << (OFFS_PACKED_BYTES*8) << " bits";
+			}
+			cerr << "): ";
 			logTime(cerr);
 		}
 		
 		if(!_useMm) {
-			if(!useShmem_) {
+			if(packOffs) {
+				try {
+					_offsPacked.init(
+						new uint8_t[offsLenSampled * OFFS_PACKED_BYTES],
+						offsLenSampled * OFFS_PACKED_BYTES,
+						true);
+				} catch(bad_alloc& e) {
+					cerr << "Out of memory allocating the offs[] array  for the Bowtie index." << endl
+					<< "Please try again on a computer with more memory." << endl;
+					throw 1;
+				}
+			} else if(!useShmem_) {
 				// Allocate offs_
 				try {
 					_offs.init(new TIndexOffU[offsLenSampled], offsLenSampled, true);
@@ -549,7 +575,7 @@ void Ebwt::readIntoMemory(
 		if(_overrideOffRate < 32) {
 			if(shmemLeader) {
 				// Allocate offs (big allocation)
-				if(switchEndian || offRateDiff > 0) {
+				if(switchEndian || offRateDiff > 0 || packOffs) {
 					assert(!_useMm);
 					const TIndexOffU blockMaxSz = (2 * 1024 * 1024); // 2 MB block size
 					const TIndexOffU blockMaxSzU = (blockMaxSz >> (OFF_SIZE/4 + 1)); // # U32s per block
@@ -570,10 +596,11 @@ void Ebwt::readIntoMemory(
 						TIndexOffU idx = i >> offRateDiff;
 						for(TIndexOffU j = 0; j < block; j += (1 << offRateDiff)) {
 							assert_lt(idx, offsLenSampled);
-							this->offs()[idx] = ((TIndexOffU*)buf)[j];
+							TIndexOffU off = ((TIndexOffU*)buf)[j];
 							if(switchEndian) {
-								this->offs()[idx] = endianSwapU(this->offs()[idx]);
+								off = endianSwapU(off);
 							}
+							this->setOffsAt(idx, off);
 							idx++;
 						}
 					}
@@ -794,6 +821,51 @@ readEntireReverse(const string& instr) {
 	}
 }
 
+/**
+ * Mix 'n' bytes into FNV-1a hash 'h'.
+ */
+static inline void fingerprintMix(uint64_t& h, const unsigned char *p, size_t n) {
+	for(size_t i = 0; i < n; i++) {
+		h ^= p[i];
+		h *= 1099511628211ull; // FNV prime
+	}
+}
+
+/**
+ * Return a fingerprint of the index with basename 'base', for files
+ * derived from it (e.g. NAME.hot.bt2) to record which index they were
+ * built from.  It's a hash of the sizes of the .1 and .2 files, their
+ * first 4 KB (the .1 header and the first SA samples) and 64 words
+ * sampled evenly from the rest of each.  Only the contents matter, not
+ * the file names.  Returns 0 if a file can't be read.
+ */
+uint64_t Ebwt::fingerprint(const string& base) {
+	uint64_t h = 14695981039346656037ull; // FNV offset basis
+	unsigned char buf[4096];
+	for(int i = 1; i <= 2; i++) {
+		string fn = base + (i == 1 ? ".1." : ".2.") + gEbwt_ext;
+		FILE *f = fopen(fn.c_str(), "rb");
+		if(f == NULL) return 0;
+		struct stat sbuf;
+		if(fstat(fileno(f), &sbuf) == -1) {
+			fclose(f);
+			return 0;
+		}
+		uint64_t sz = (uint64_t)sbuf.st_size;
+		for(size_t j = 0; j < sizeof(sz); j++) {
+			buf[j] = (unsigned char)(sz >> (8 * j));
+		}
+		fingerprintMix(h, buf, sizeof(sz));
+		fingerprintMix(h, buf, fread(buf, 1, sizeof(buf), f));
+		for(uint64_t j = 1; j <= 64; j++) {
+			if(fseeko(f, (off_t)(sz / 65 * j), SEEK_SET) != 0) break;
+			fingerprintMix(h, buf, fread(buf, 1, 8, f));
+		}
+		fclose(f);
+	}
+	return h;
+}
+
 /**
  * Write an extended Burrows-Wheeler transform to a pair of output
  * streams.
@@ -829,7 +901,7 @@ void Ebwt::writeFromMemory(bool justHeader,
 	
 	if(!justHeader) {
 		assert(rstarts() != NULL);
-		assert(offs() != NULL);
+		assert(offsLoaded());
 		assert(ftab() != NULL);
 		assert(eftab() != NULL);
 		assert(isInMemory());
@@ -853,7 +925,7 @@ void Ebwt::writeFromMemory(bool justHeader,
 		writeU<TIndexOffU>(out1, this->zOff(), be);
 		TIndexOffU offsLen = eh._offsLen;
 		for(TIndexOffU i = 0; i < offsLen; i++)
-			writeU<TIndexOffU>(out2, this->offs()[i], be);
+			writeU<TIndexOffU>(out2, this->offsAt(i), be);
 		
 		// 'fchr', 'ftab' and 'eftab' are not fully determined until the
 		// loop is finished, so they are written to the primary file after
@@ -922,7 +994,7 @@ void Ebwt::writeFromMemory(bool justHeader,
 		for(TIndexOffU i = 0; i < eh._eftabLen; i++)
 			assert_eq(this->eftab()[i], copy.eftab()[i]);
 		for(TIndexOffU i = 0; i < eh._offsLen; i++)
-			assert_eq(this->_offs[i], copy.offs()[i]);
+			assert_eq(this->offsAt(i), copy.offsAt(i));
 		for(TIndexOffU i = 0; i < eh._ebwtTotLen; i++)
 			assert_eq(this->ebwt()[i], copy.ebwt()[i]);
 		copy.sanityCheckAll();
@@ -961,3 +1033,51 @@ void Ebwt::szsToDisk(const EList<RefRecord>& szs, ostream& os, int reverse) {
 		off += szs[i].len;
 	}
 }
+
+/**
+ * Count the sequences and fragments in the szs array and write the
+ * number of sequences, their lengths (plen) and the number of fragments
+ * to the primary index file.
+ */
+void Ebwt::joinHeaderToDisk(EList<RefRecord>& szs, ostream& out1) {
+	assert_gt(szs.size(), 0);
+	// Not every fragment represents a distinct sequence - many
+	// fragments may correspond to a single sequence.  Count the
+	// number of sequences here by counting the number of "first"
+	// fragments.
+	this->_nPat = 0;
+	this->_nFrag = 0;
+	for(TIndexOffU i = 0; i < szs.size(); i++) {
+		if(szs[i].len > 0) this->_nFrag++;
+		if(szs[i].first && szs[i].len > 0) this->_nPat++;
+	}
+	assert_gt(this->_nPat, 0);
+	assert_geq(this->_nFrag, this->_nPat);
+	_rstarts.reset();
+	writeU<TIndexOffU>(out1, this->_nPat, this->toBe());
+	// Allocate plen[]
+	try {
+		this->_plen.init(new TIndexOffU[this->_nPat], this->_nPat);
+	} catch(bad_alloc& e) {
+		cerr << "Out of memory allocating plen[] in Ebwt::join()"
+		     << " at " << __FILE__ << ":" << __LINE__ << endl;
+		throw e;
+	}
+	// For each pattern, set plen
+	TIndexOff npat = -1;
+	for(TIndexOffU i = 0; i < szs.size(); i++) {
+		if(szs[i].first && szs[i].len > 0) {
+			if(npat >= 0) {
+				writeU<TIndexOffU>(out1, this->plen()[npat], this->toBe());
+			}
+			npat++;
+			this->plen()[npat] = (szs[i].len + szs[i].off);
+		} else {
+			this->plen()[npat] += (szs[i].len + szs[i].off);
+		}
+	}
+	assert_eq((TIndexOffU)npat, this->_nPat-1);
+	writeU<TIndexOffU>(out1, this->plen()[npat], this->toBe());
+	// Write the number of fragments
+	writeU<TIndexOffU>(out1, this->_nFrag, this->toBe());
+}
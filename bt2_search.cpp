@@ -46,6 +46,7 @@
 #include "aligner_sw.h"
 #include "aligner_sw_driver.h"
 #include "aligner_cache.h"
+#include "read_cache.h"
 #include "util.h"
 #include "pe.h"
 #include "simple_func.h"
@@ -53,6 +54,8 @@
 #include "opts.h"
 #include "outq.h"
 #include "aligner_seed2.h"
+#include "hot_seeds.h"
+#include "ftab2.h"
 #include "bt2_search.h"
 
 using namespace std;
@@ -60,7 +63,6 @@ using namespace std;
 static EList<string> mates1;  // mated reads (first mate)
 static EList<string> mates2;  // mated reads (second mate)
 static EList<string> mates12; // mated reads (1st/2nd interleaved in 1 file)
-static string adjIdxBase;
 bool gColor;              // colorspace (not supported)
 int gVerbose;             // be talkative
 static bool startVerbose; // be talkative at startup
@@ -200,11 +202,17 @@ static int    multiseedMms;   // mismatches permitted in a multiseed seed
 static int    multiseedLen;   // length of multiseed seeds
 static size_t multiseedOff;   // offset to begin extracting seeds
 static uint32_t seedCacheLocalMB;   // # MB to use for non-shared seed alignment cacheing
+static size_t dedupCacheSz;      // max # reads/pairs in per-thread result cache; 0 = off
+static size_t sortWindow;        // # reads/pairs to sort by minimizer before aligning; 0 = off
+static bool useHotSeeds;         // use an index's .hot table of frequent-seed offsets if present
+static bool useFtab2;            // use an index's .ftab2 second-level ftab if present
+static size_t maxLatencyMs;      // stream reads in & push output out at least this often (ms); 0 = off
 static uint32_t seedCacheCurrentMB; // # MB to use for current-read seed hit cacheing
 static uint32_t exactCacheCurrentMB; // # MB to use for current-read seed hit cacheing
 static size_t maxhalf;        // max width on one side of DP table
 static bool seedSumm;         // print summary information about seed hits, not alignments
 static bool doUngapped;       // do ungapped alignment
+static bool doBpFilter;       // bit-parallel edit-distance filter before DP
 static size_t maxIters;       // stop after this many extend loop iterations
 static size_t maxUg;          // stop after this many ungap extends
 static size_t maxDp;          // stop after this many DPs
@@ -230,6 +238,8 @@ static bool doExactUpFront;   // do exact search up front if seeds seem good eno
 static bool do1mmUpFront;     // do 1mm search up front if seeds seem good enough
 static size_t do1mmMinLen;    // length below which we disable 1mm e2e search
 static int seedBoostThresh;   // if average non-zero position has more than this many elements
+static bool adaptiveSeed;     // place seeds by quality/Ns and stop re-seeding when it can't help
+static size_t smemMaxOcc;     // seed with maximal exact matches occurring <= this many times; 0 = off
 static size_t nSeedRounds;    // # seed rounds
 static bool reorder;          // true -> reorder SAM recs in -p mode
 static float sampleFrac;      // only align random fraction of input reads
@@ -248,7 +258,6 @@ static void resetOptions() {
 	mates1.clear();
 	mates2.clear();
 	mates12.clear();
-	adjIdxBase	            = "";
 	gColor                  = false;
 	gVerbose                = 0;
 	startVerbose			= 0;
@@ -388,11 +397,17 @@ static void resetOptions() {
 	multiseedLen    = DEFAULT_SEEDLEN;
 	multiseedOff    = 0;
 	seedCacheLocalMB   = 32; // # MB to use for non-shared seed alignment cacheing
+	dedupCacheSz       = 0;  // per-thread read-level result cache off by default
+	sortWindow         = 0;  // align reads in input order by default
+	useHotSeeds        = true;  // load NAME.hot.bt2 if it exists
+	useFtab2           = true;  // load NAME.ftab2.bt2 if it exists
+	maxLatencyMs       = 0;     // buffer input and output for throughput
 	seedCacheCurrentMB = 20; // # MB to use for current-read seed hit cacheing
 	exactCacheCurrentMB = 20; // # MB to use for current-read seed hit cacheing
 	maxhalf            = 15; // max width on one side of DP table
 	seedSumm           = false; // print summary information about seed hits, not alignments
 	doUngapped         = true;  // do ungapped alignment
+	doBpFilter         = true;  // bit-parallel edit-distance filter before DP
 	maxIters           = 400;   // max iterations of extend loop
 	maxUg              = 300;   // stop after this many ungap extends
 	maxDp              = 300;   // stop after this many dp extends
@@ -420,6 +435,8 @@ static void resetOptions() {
 	doExactUpFront = true;   // do exact search up front if seeds seem good enough
 	do1mmUpFront = true;    // do 1mm search up front if seeds seem good enough
 	seedBoostThresh = 300;   // if average non-zero position has more than this many elements
+	adaptiveSeed = false;    // seed at fixed offsets, re-seed up to -R times
+	smemMaxOcc = 0;          // use fixed-length seeds
 	nSeedRounds = 2;         // # rounds of seed searches to do for repetitive reads
 	do1mmMinLen = 60;        // length below which we disable 1mm search
 	reorder = false;         // reorder SAM records with -p > 1
@@ -534,6 +551,8 @@ static struct option long_options[] = {
 	{(char*)"end-to-end",   no_argument,       0,            ARG_END_TO_END},
 	{(char*)"ungapped",     no_argument,       0,            ARG_UNGAPPED},
 	{(char*)"no-ungapped",  no_argument,       0,            ARG_UNGAPPED_NO},
+	{(char*)"bp-filter",    no_argument,       0,            ARG_BP_FILTER},
+	{(char*)"no-bp-filter", no_argument,       0,            ARG_BP_FILTER_NO},
 	{(char*)"sse8",         no_argument,       0,            ARG_SSE8},
 	{(char*)"no-sse8",      no_argument,       0,            ARG_SSE8_NO},
 	{(char*)"scan-narrowed",no_argument,       0,            ARG_SCAN_NARROWED},
@@ -582,6 +601,8 @@ static struct option long_options[] = {
 	{(char*)"1mm-minlen",       required_argument, 0,        ARG_1MM_MINLEN},
 	{(char*)"seed-off",         required_argument, 0,        'O'},
 	{(char*)"seed-boost",       required_argument, 0,        ARG_SEED_BOOST_THRESH},
+	{(char*)"adaptive-seed",    no_argument,       0,        ARG_ADAPTIVE_SEED},
+	{(char*)"smem-seeds",       required_argument, 0,        ARG_SMEM_SEEDS},
 	{(char*)"read-times",       no_argument,       0,        ARG_READ_TIMES},
 	{(char*)"show-rand-seed",   no_argument,       0,        ARG_SHOW_RAND_SEED},
 	{(char*)"dp-fail-streak",   required_argument, 0,        ARG_DP_FAIL_STREAK_THRESH},
@@ -603,6 +624,11 @@ static struct option long_options[] = {
 	{(char*)"nondeterministic", no_argument,       0,        ARG_NON_DETERMINISTIC},
 	{(char*)"non-deterministic", no_argument,      0,        ARG_NON_DETERMINISTIC},
 	{(char*)"local-seed-cache-sz", required_argument, 0,     ARG_LOCAL_SEED_CACHE_SZ},
+	{(char*)"dedup-cache",      required_argument, 0,        ARG_DEDUP_CACHE},
+	{(char*)"sort-window",      required_argument, 0,        ARG_SORT_WINDOW},
+	{(char*)"no-hot-seeds",     no_argument,       0,        ARG_NO_HOT_SEEDS},
+	{(char*)"no-ftab2",         no_argument,       0,        ARG_NO_FTAB2},
+	{(char*)"max-latency",      required_argument, 0,        ARG_MAX_LATENCY},
 	{(char*)"seed-cache-sz",       required_argument, 0,     ARG_CURRENT_SEED_CACHE_SZ},
 	{(char*)"no-unal",          no_argument,       0,        ARG_SAM_NO_UNAL},
 	{(char*)"test-25",          no_argument,       0,        ARG_TEST_25},
@@ -667,6 +693,7 @@ static void printUsage(ostream& out) {
 	    << "  " << tool_name.c_str() << " [options]* -x <bt2-idx> {-1 <m1> -2 <m2> | -U <r>} [-S <sam>]" << endl
 	    << endl
 		<<     "  <bt2-idx>  Index filename prefix (minus trailing .X." + gEbwt_ext + ")." << endl
+		<<     "             Comma-separated list aligns to several indexes at once." << endl
 		<<     "             NOTE: Bowtie 1 and Bowtie 2 indexes are not compatible." << endl
 	    <<     "  <m1>       Files with #1 mates, paired with files in <m2>." << endl;
 	if(wrapper == "basic-0") {
@@ -728,6 +755,8 @@ static void printUsage(ostream& out) {
 	    << "  --no-1mm-upfront   do not allow 1 mismatch alignments before attempting to" << endl
 	    << "                     scan for the optimal seeded alignments"
 	    << endl
+	    << "  --no-bp-filter     don't skip DPs that a bit-parallel edit-distance bound rules" << endl
+	    << "                     out (filter is always off with --local and --mapq-extra)" << endl
 		<< "  --end-to-end       entire read must align; no clipping (on)" << endl
 		<< "   OR" << endl
 		<< "  --local            local alignment; ends might be soft clipped (off)" << endl
@@ -751,6 +780,8 @@ static void printUsage(ostream& out) {
 	    << " Effort:" << endl
 	    << "  -D <int>           give up extending after <int> failed extends in a row (15)" << endl
 	    << "  -R <int>           for reads w/ repetitive seeds, try <int> sets of seeds (2)" << endl
+	    << "  --adaptive-seed    place seeds by quality; skip re-seeding that can't change result" << endl
+	    << "  --smem-seeds <int> seed w/ exact matches >= -L bp, up to 32 bp, with <= <int> hits if any" << endl
 		<< endl
 		<< " Paired-end:" << endl
 	    << "  -I/--minins <int>  minimum fragment length (0)" << endl
@@ -793,6 +824,13 @@ static void printUsage(ostream& out) {
 	//    << "  -o/--offrate <int> override offrate of index; must be >= index's offrate" << endl
 	    << "  -p/--threads <int> number of alignment threads to launch (1)" << endl
 	    << "  --reorder          force SAM output order to match order of input reads" << endl
+	    << "  --dedup-cache <int> reuse results for reads/pairs identical to one of the last" << endl
+	    << "                     <int> aligned by the same thread, whatever the name (0 = off) (0)" << endl
+	    << "  --sort-window <int> align reads in batches of <int>, sorted by minimizer (0 = off)" << endl
+	    << "  --max-latency <int> stream: align reads as they arrive and write SAM at least" << endl
+	    << "                     every <int> ms; report latency percentiles (0 = off)" << endl
+	    << "  --no-hot-seeds     don't use the index's .hot." << gEbwt_ext << " table of frequent-seed offsets" << endl
+	    << "  --no-ftab2         don't use the index's .ftab2." << gEbwt_ext << " second-level ftab" << endl
 #ifdef BOWTIE_MM
 	    << "  --mm               use memory-mapped I/O for index; many 'bowtie's can share" << endl
 #endif
@@ -1010,6 +1048,17 @@ static void parseOption(int next_option, const char *arg) {
 		case ARG_LOCAL_SEED_CACHE_SZ:
 			seedCacheLocalMB = (uint32_t)parseInt(1, "--local-seed-cache-sz arg must be at least 1", arg);
 			break;
+		case ARG_DEDUP_CACHE:
+			dedupCacheSz = (size_t)parseInt(0, "--dedup-cache arg must be at least 0", arg);
+			break;
+		case ARG_SORT_WINDOW:
+			sortWindow = (size_t)parseInt(0, "--sort-window arg must be at least 0", arg);
+			break;
+		case ARG_NO_HOT_SEEDS: useHotSeeds = false; break;
+		case ARG_NO_FTAB2: useFtab2 = false; break;
+		case ARG_MAX_LATENCY:
+			maxLatencyMs = (size_t)parseInt(0, "--max-latency arg must be at least 0", arg);
+			break;
 		case ARG_CURRENT_SEED_CACHE_SZ:
 			seedCacheCurrentMB = (uint32_t)parseInt(1, "--seed-cache-sz arg must be at least 1", arg);
 			break;
@@ -1114,6 +1163,10 @@ static void parseOption(int next_option, const char *arg) {
 			seedBoostThresh = parse<int>(arg);
 			break;
 		}
+		case ARG_ADAPTIVE_SEED: adaptiveSeed = true; break;
+		case ARG_SMEM_SEEDS:
+			smemMaxOcc = (size_t)parseInt(0, "--smem-seeds arg must be at least 0", arg);
+			break;
 		case 'a': {
 			msample = false;
 			allHits = true;
@@ -1237,6 +1290,8 @@ static void parseOption(int next_option, const char *arg) {
 		case ARG_SSE8_NO: enable8 = false; break;
 		case ARG_UNGAPPED: doUngapped = true; break;
 		case ARG_UNGAPPED_NO: doUngapped = false; break;
+		case ARG_BP_FILTER: doBpFilter = true; break;
+		case ARG_BP_FILTER_NO: doBpFilter = false; break;
 		case ARG_NO_DOVETAIL: gDovetailMatesOK = false; break;
 		case ARG_NO_CONTAIN:  gContainMatesOK  = false; break;
 		case ARG_NO_OVERLAP:  gOlapMatesOK     = false; break;
@@ -1573,7 +1628,15 @@ static void parseOptions(int argc, const char **argv) {
 			 << " instead" << endl;
 		multiseedMms = multiseedLen-1;
 	}
+	if(maxLatencyMs > 0 && sortWindow > 0) {
+		cerr << "Warning: --sort-window holds reads back, so it is ignored with --max-latency" << endl;
+		sortWindow = 0;
+	}
 	sam_print_zm = sam_print_zm && bowtie2p5;
+	// Soft clipping defeats the bit-parallel filter's bound, and DP problems
+	// it skips don't report a best sub-threshold cell score, which Xs:i/Ys:i
+	// (--mapq-extra) depend on
+	doBpFilter = doBpFilter && !localAlign && !sam_print_xss;
 #ifndef NDEBUG
 	if(!gQuiet) {
 		cerr << "Warning: Running in debug mode.  Please use debug mode only "
@@ -1598,10 +1661,11 @@ createPatsrcFactory(PairedPatternSource& _patsrc, int tid) {
 #define PTHREAD_ATTRS (PTHREAD_CREATE_JOINABLE | PTHREAD_CREATE_DETACHED)
 
 static PairedPatternSource*     multiseed_patsrc;
-static Ebwt*                    multiseed_ebwtFw;
-static Ebwt*                    multiseed_ebwtBw;
+static EList<Ebwt*>             multiseed_ebwtFw; // one per index in the set
+static EList<Ebwt*>             multiseed_ebwtBw; // one per index in the set
 static Scoring*                 multiseed_sc;
-static BitPairReference*        multiseed_refs;
+static EList<BitPairReference*> multiseed_refs;   // one per index in the set
+static EList<TRefId>            multiseed_refOff; // # refs in earlier indexes
 static AlignmentCache*          multiseed_ca; // seed cache
 static AlnSink*                 multiseed_msink;
 static OutFileBuf*              multiseed_metricsOfb;
@@ -1912,6 +1976,11 @@ struct PerfMetrics {
 				/* 127 */ "DPMemPeak"      "\t" // DP_CAT
 				/* 128 */ "MiscMemPeak"    "\t" // MISC_CAT
 				/* 129 */ "DebugMemPeak"   "\t" // DEBUG_CAT
+
+				/* 130 */ "DPExBpFilt"     "\t"
+				/* 131 */ "DPMateBpFilt"   "\t"
+				/* 132 */ "DP8ExDpSkip"    "\t"
+				/* 133 */ "DP8MateDpSkip"  "\t"
 				
 				"\n";
 			
@@ -2485,6 +2554,23 @@ struct PerfMetrics {
 		if(o != NULL) { o->writeChars(buf); o->write('\t'); }
 		// 129. Debug memory peak
 		itoa10<size_t>(gMemTally.peak(DEBUG_CAT) >> 20, buf);
+		if(metricsStderr) stderrSs << buf << '\t';
+		if(o != NULL) { o->writeChars(buf); o->write('\t'); }
+
+		// 130. Seed-extend DPs skipped by bit-parallel filter
+		itoa10<uint64_t>(total ? swmSeed.bpfilt : swmuSeed.bpfilt, buf);
+		if(metricsStderr) stderrSs << buf << '\t';
+		if(o != NULL) { o->writeChars(buf); o->write('\t'); }
+		// 131. Mate-finding DPs skipped by bit-parallel filter
+		itoa10<uint64_t>(total ? swmMate.bpfilt : swmuMate.bpfilt, buf);
+		if(metricsStderr) stderrSs << buf << '\t';
+		if(o != NULL) { o->writeChars(buf); o->write('\t'); }
+		// 132. Seed-extend DPs sent straight to 16-bit
+		itoa10<uint64_t>(dpSse8s.dpskip, buf);
+		if(metricsStderr) stderrSs << buf << '\t';
+		if(o != NULL) { o->writeChars(buf); o->write('\t'); }
+		// 133. Mate-finding DPs sent straight to 16-bit
+		itoa10<uint64_t>(dpSse8m.dpskip, buf);
 		if(metricsStderr) stderrSs << buf;
 		if(o != NULL) { o->writeChars(buf); }
 
@@ -2770,13 +2856,10 @@ void multiseedSearchWorker::operator()() {
 static void multiseedSearchWorker(void *vp) {
 	int tid = *((int*)vp);
 #endif
-	assert(multiseed_ebwtFw != NULL);
-	assert(multiseedMms == 0 || multiseed_ebwtBw != NULL);
+	assert(!multiseed_ebwtFw.empty());
+	assert(multiseedMms == 0 || multiseed_ebwtBw[0] != NULL);
 	PairedPatternSource&    patsrc   = *multiseed_patsrc;
-	const Ebwt&             ebwtFw   = *multiseed_ebwtFw;
-	const Ebwt&             ebwtBw   = *multiseed_ebwtBw;
 	const Scoring&          sc       = *multiseed_sc;
-	const BitPairReference& ref      = *multiseed_refs;
 	AlignmentCache&         scShared = *multiseed_ca;
 	AlnSink&                msink    = *multiseed_msink;
 	OutFileBuf*             metricsOfb = multiseed_metricsOfb;
@@ -2884,6 +2967,15 @@ static void multiseedSearchWorker(void *vp) {
 	
 	PerReadMetrics prm;
 
+	// Scratch arena for transient per-read buffers (e.g. sort buffers);
+	// reset at each read boundary
+	EArena scratch(64 * 1024, MISC_CAT);
+	EArena::setThreadArena(&scratch);
+
+	// Results for reads/pairs already aligned by this thread, for replaying
+	// on later reads/pairs with identical sequence
+	ReadResultCache rcache(dedupCacheSz);
+
 	// Used by thread with threadid == 1 to measure time elapsed
 	time_t iTime = time(0);
 
@@ -2950,7 +3042,7 @@ static void multiseedSearchWorker(void *vp) {
 			}
 			prm.reset(); // per-read metrics
 			prm.doFmString = false;
-			if(sam_print_xt) {
+			if(sam_print_xt || maxLatencyMs > 0) {
 				gettimeofday(&prm.tv_beg, &prm.tz_beg);
 			}
 			// Try to align this read
@@ -2958,6 +3050,7 @@ static void multiseedSearchWorker(void *vp) {
 				retry = false;
 				assert_eq(ps->bufa().color, false);
 				ca.nextRead(); // clear the cache
+				scratch.reset();
 				olm.reads++;
 				assert(!ca.aligning());
 				bool pair = paired;
@@ -3070,11 +3163,21 @@ static void multiseedSearchWorker(void *vp) {
 				exhaustive[0] = exhaustive[1] = false;
 				size_t matemap[2] = { 0, 1 };
 				bool pairPostFilt = filt[0] && filt[1];
-				if(pairPostFilt) {
-					rnd.init(ps->bufa().seed ^ ps->bufb().seed);
-				} else {
-					rnd.init(ps->bufa().seed);
+				const uint32_t nmseed = pairPostFilt ?
+					(ps->bufa().seed ^ ps->bufb().seed) : ps->bufa().seed;
+				// With --dedup-cache, the search draws on a seed made from the
+				// sequences and qualities alone, so that duplicates under
+				// different names (PCR, optical) can share a cache entry
+				const bool useCache = rcache.enabled() && !seedSumm;
+				uint32_t rdseed = nmseed;
+				if(useCache && !arbitraryRandom) {
+					const BTString noname;
+					rdseed = genRandSeed(ps->bufa().patFw, ps->bufa().qual, noname, seed);
+					if(pairPostFilt) {
+						rdseed ^= genRandSeed(ps->bufb().patFw, ps->bufb().qual, noname, seed);
+					}
 				}
+				rnd.init(rdseed);
 				// Calculate interval length for both mates
 				int interval[2] = { 0, 0 };
 				for(size_t mate = 0; mate < (pair ? 2:1); mate++) {
@@ -3138,500 +3241,299 @@ static void multiseedSearchWorker(void *vp) {
 				// Whether we're done with mate1 / mate2
 				bool done[2] = { !filt[0], !filt[1] };
 				size_t nelt[2] = {0, 0};
-									
-					// Find end-to-end exact alignments for each read
-					if(doExactUpFront) {
-						for(size_t matei = 0; matei < (pair ? 2:1); matei++) {
-							size_t mate = matemap[matei];
-							if(!filt[mate] || done[mate] || msinkwrap.state().doneWithMate(mate == 0)) {
-								continue;
-							}
-							swmSeed.exatts++;
-							nelt[mate] = al.exactSweep(
-								ebwtFw,        // index
-								*rds[mate],    // read
-								sc,            // scoring scheme
-								nofw[mate],    // nofw?
-								norc[mate],    // norc?
-								2,             // max # edits we care about
-								minedfw[mate], // minimum # edits for fw mate
-								minedrc[mate], // minimum # edits for rc mate
-								true,          // report 0mm hits
-								shs[mate],     // put end-to-end results here
-								sdm);          // metrics
-							size_t bestmin = min(minedfw[mate], minedrc[mate]);
-							if(bestmin == 0) {
-								sdm.bestmin0++;
-							} else if(bestmin == 1) {
-								sdm.bestmin1++;
-							} else {
-								assert_eq(2, bestmin);
-								sdm.bestmin2++;
-							}
-						}
-						matemap[0] = 0; matemap[1] = 1;
-						if(nelt[0] > 0 && nelt[1] > 0 && nelt[0] > nelt[1]) {
-							// Do the mate with fewer exact hits first
-							// TODO: Consider mates & orientations separately?
-							matemap[0] = 1; matemap[1] = 0;
-						}
-						for(size_t matei = 0; matei < (seedSumm ? 0:2); matei++) {
-							size_t mate = matemap[matei];
-							if(nelt[mate] == 0 || nelt[mate] > eePeEeltLimit) {
-								shs[mate].clearExactE2eHits();
-								continue;
-							}
-							if(msinkwrap.state().doneWithMate(mate == 0)) {
-								shs[mate].clearExactE2eHits();
-								done[mate] = true;
-								continue;
-							}
-							assert(filt[mate]);
-							assert(matei == 0 || pair);
-							assert(!msinkwrap.maxed());
-							assert(msinkwrap.repOk());
-							int ret = 0;
-							if(pair) {
-								// Paired-end dynamic programming driver
-								ret = sd.extendSeedsPaired(
-									*rds[mate],     // mate to align as anchor
-									*rds[mate ^ 1], // mate to align as opp.
-									mate == 0,      // anchor is mate 1?
-									!filt[mate ^ 1],// opposite mate filtered out?
-									shs[mate],      // seed hits for anchor
-									ebwtFw,         // bowtie index
-									&ebwtBw,        // rev bowtie index
-									ref,            // packed reference strings
-									sw,             // dyn prog aligner, anchor
-									osw,            // dyn prog aligner, opposite
-									sc,             // scoring scheme
-									pepol,          // paired-end policy
-									-1,             // # mms allowed in a seed
-									0,              // length of a seed
-									0,              // interval between seeds
-									minsc[mate],    // min score for anchor
-									minsc[mate^1],  // min score for opp.
-									nceil[mate],    // N ceil for anchor
-									nceil[mate^1],  // N ceil for opp.
-									nofw[mate],     // don't align forward read
-									norc[mate],     // don't align revcomp read
-									maxhalf,        // max width on one DP side
-									doUngapped,     // do ungapped alignment
-									mxIter[mate],   // max extend loop iters
-									mxUg[mate],     // max # ungapped extends
-									mxDp[mate],     // max # DPs
-									streak[mate],   // stop after streak of this many end-to-end fails
-									streak[mate],   // stop after streak of this many ungap fails
-									streak[mate],   // stop after streak of this many dp fails
-									mtStreak[mate], // max mate fails per seed range
-									doExtend,       // extend seed hits
-									enable8,        // use 8-bit SSE where possible
-									cminlen,        // checkpoint if read is longer
-									cpow2,          // checkpointer interval, log2
-									doTri,          // triangular mini-fills?
-									tighten,        // -M score tightening mode
-									ca,             // seed alignment cache
-									rnd,            // pseudo-random source
-									wlm,            // group walk left metrics
-									swmSeed,        // DP metrics, seed extend
-									swmMate,        // DP metrics, mate finding
-									prm,            // per-read metrics
-									&msinkwrap,     // for organizing hits
-									true,           // seek mate immediately
-									true,           // report hits once found
-									gReportDiscordant,// look for discordant alns?
-									gReportMixed,   // look for unpaired alns?
-									exhaustive[mate]);
-								// Might be done, but just with this mate
-							} else {
-								// Unpaired dynamic programming driver
-								ret = sd.extendSeeds(
-									*rds[mate],     // read
-									mate == 0,      // mate #1?
-									shs[mate],      // seed hits
-									ebwtFw,         // bowtie index
-									&ebwtBw,        // rev bowtie index
-									ref,            // packed reference strings
-									sw,             // dynamic prog aligner
-									sc,             // scoring scheme
-									-1,             // # mms allowed in a seed
-									0,              // length of a seed
-									0,              // interval between seeds
-									minsc[mate],    // minimum score for valid
-									nceil[mate],    // N ceil for anchor
-									maxhalf,        // max width on one DP side
-									doUngapped,     // do ungapped alignment
-									mxIter[mate],   // max extend loop iters
-									mxUg[mate],     // max # ungapped extends
-									mxDp[mate],     // max # DPs
-									streak[mate],   // stop after streak of this many end-to-end fails
-									streak[mate],   // stop after streak of this many ungap fails
-									doExtend,       // extend seed hits
-									enable8,        // use 8-bit SSE where possible
-									cminlen,        // checkpoint if read is longer
-									cpow2,          // checkpointer interval, log2
-									doTri,          // triangular mini-fills
-									tighten,        // -M score tightening mode
-									ca,             // seed alignment cache
-									rnd,            // pseudo-random source
-									wlm,            // group walk left metrics
-									swmSeed,        // DP metrics, seed extend
-									prm,            // per-read metrics
-									&msinkwrap,     // for organizing hits
-									true,           // report hits once found
-									exhaustive[mate]);
+				// If an earlier read/pair had exactly the same sequence,
+				// replay its alignments rather than searching again
+				const ReadResultEntry *cached = NULL;
+				if(useCache) {
+					cached = rcache.lookup(
+						ps->bufa(),
+						pair ? &ps->bufb() : NULL,
+						filt,
+						rdseed);
+				}
+				if(cached != NULL) {
+					msinkwrap.replayReported(cached->alns);
+					exhaustive[0] = cached->exhaust[0];
+					exhaustive[1] = cached->exhaust[1];
+					// Choose among the alignments as if the search had run
+					rnd = cached->rnd;
+					// This read did none of the search work, so only the
+					// metrics that end up in its SAM record carry over
+					cached->restoreMetrics(prm);
+					olm.srreads++;
+					olm.srbases += (rdlens[0] + (pair ? rdlens[1] : 0));
+				} else {
+					size_t seedsTried = 0;
+					size_t nUniqueSeeds = 0, nRepeatSeeds = 0, seedHitTot = 0;
+					// Effort limits for one index; each index of a set gets its own
+					const size_t mxDpIdx[2]   = { mxDp[0],   mxDp[1]   };
+					const size_t mxUgIdx[2]   = { mxUg[0],   mxUg[1]   };
+					const size_t mxIterIdx[2] = { mxIter[0], mxIter[1] };
+					// Search each index of the set in turn; the alignments found in all
+					// of them are reported to msinkwrap and compete in finishRead()
+					for(size_t xi = 0; xi < multiseed_ebwtFw.size(); xi++) {
+						const Ebwt&             ebwtFw = *multiseed_ebwtFw[xi];
+						const Ebwt&             ebwtBw = *multiseed_ebwtBw[xi];
+						const BitPairReference& ref    = *multiseed_refs[xi];
+						if(xi > 0) {
+							if(msinkwrap.state().done()) {
+								break;
 							}
-							assert_gt(ret, 0);
-							MERGE_SW(sw);
-							MERGE_SW(osw);
-							// Clear out the exact hits so that we don't try to
-							// extend them again later!
-							shs[mate].clearExactE2eHits();
-							if(ret == EXTEND_EXHAUSTED_CANDIDATES) {
-								// Not done yet
-							} else if(ret == EXTEND_POLICY_FULFILLED) {
-								// Policy is satisfied for this mate at least
-								if(msinkwrap.state().doneWithMate(mate == 0)) {
-									done[mate] = true;
-								}
-								if(msinkwrap.state().doneWithMate(mate == 1)) {
-									done[mate^1] = true;
+							// Start afresh on the next index; seed hits, redundancy
+							// checks and cached ranges are all specific to one index
+							ca.nextRead();
+							sd.nextRead(paired, rdrows[0], rdrows[1]);
+							for(size_t mate = 0; mate < 2; mate++) {
+								if(filt[mate] && (mate == 0 || pair)) {
+									shs[mate].clear();
+									shs[mate].nextRead(mate == 0 ? ps->bufa() : ps->bufb());
 								}
-							} else if(ret == EXTEND_PERFECT_SCORE) {
-								// We exhausted this mode at least
-								done[mate] = true;
-							} else if(ret == EXTEND_EXCEEDED_HARD_LIMIT) {
-								// We exceeded a per-read limit
-								done[mate] = true;
-							} else if(ret == EXTEND_EXCEEDED_SOFT_LIMIT) {
-								// Not done yet
-							} else {
-								//
-								cerr << "Bad return value: " << ret << endl;
-								throw 1;
-							}
-							if(!done[mate]) {
-								TAlScore perfectScore = sc.perfectScore(rdlens[mate]);
-								if(!done[mate] && minsc[mate] == perfectScore) {
-									done[mate] = true;
+								done[mate] = !filt[mate] ||
+								             msinkwrap.state().doneWithMate(mate == 0);
+								nelt[mate] = minedfw[mate] = minedrc[mate] = 0;
+								if(!allHits) {
+									mxDp[mate]   = mxDpIdx[mate] + max(prm.nExDps, prm.nMateDps);
+									mxUg[mate]   = mxUgIdx[mate] + max(prm.nExUgs, prm.nMateUgs);
+									mxIter[mate] = mxIterIdx[mate] + prm.nExIters;
 								}
 							}
+							matemap[0] = 0; matemap[1] = 1;
 						}
-					}
-					// 1-mismatch
-					if(do1mmUpFront && !seedSumm) {
-						for(size_t matei = 0; matei < (pair ? 2:1); matei++) {
-							size_t mate = matemap[matei];
-							if(!filt[mate] || done[mate] || nelt[mate] > eePeEeltLimit) {
-								// Done with this mate
-								shs[mate].clear1mmE2eHits();
-								nelt[mate] = 0;
-								continue;
-							}
-							nelt[mate] = 0;
-							assert(!msinkwrap.maxed());
-							assert(msinkwrap.repOk());
-							//rnd.init(ROTL(rds[mate]->seed, 10));
-							assert(shs[mate].empty());
-							assert(shs[mate].repOk(&ca.current()));
-							bool yfw = minedfw[mate] <= 1 && !nofw[mate];
-							bool yrc = minedrc[mate] <= 1 && !norc[mate];
-							if(yfw || yrc) {
-								// Clear out the exact hits
-								swmSeed.mm1atts++;
-								al.oneMmSearch(
-									&ebwtFw,        // BWT index
-									&ebwtBw,        // BWT' index
-									*rds[mate],     // read
-									sc,             // scoring scheme
-									minsc[mate],    // minimum score
-									!yfw,           // don't align forward read
-									!yrc,           // don't align revcomp read
-									localAlign,     // must be legal local alns?
-									false,          // do exact match
-									true,           // do 1mm
-									shs[mate],      // seed hits (hits installed here)
-									sdm);           // metrics
-								nelt[mate] = shs[mate].num1mmE2eHits();
-							}
-						}
-						// Possibly reorder the mates
-						matemap[0] = 0; matemap[1] = 1;
-						if(nelt[0] > 0 && nelt[1] > 0 && nelt[0] > nelt[1]) {
-							// Do the mate with fewer exact hits first
-							// TODO: Consider mates & orientations separately?
-							matemap[0] = 1; matemap[1] = 0;
-						}
-						for(size_t matei = 0; matei < (seedSumm ? 0:2); matei++) {
-							size_t mate = matemap[matei];
-							if(nelt[mate] == 0 || nelt[mate] > eePeEeltLimit) {
-								continue;
-							}
-							if(msinkwrap.state().doneWithMate(mate == 0)) {
-								done[mate] = true;
-								continue;
+						msinkwrap.setRefOffset(multiseed_refOff[xi]);
+						// Find end-to-end exact alignments for each read
+						if(doExactUpFront) {
+							for(size_t matei = 0; matei < (pair ? 2:1); matei++) {
+								size_t mate = matemap[matei];
+								if(!filt[mate] || done[mate] || msinkwrap.state().doneWithMate(mate == 0)) {
+									continue;
+								}
+								swmSeed.exatts++;
+								nelt[mate] = al.exactSweep(
+									ebwtFw,        // index
+									*rds[mate],    // read
+									sc,            // scoring scheme
+									nofw[mate],    // nofw?
+									norc[mate],    // norc?
+									2,             // max # edits we care about
+									minedfw[mate], // minimum # edits for fw mate
+									minedrc[mate], // minimum # edits for rc mate
+									true,          // report 0mm hits
+									shs[mate],     // put end-to-end results here
+									sdm);          // metrics
+								size_t bestmin = min(minedfw[mate], minedrc[mate]);
+								if(bestmin == 0) {
+									sdm.bestmin0++;
+								} else if(bestmin == 1) {
+									sdm.bestmin1++;
+								} else {
+									assert_eq(2, bestmin);
+									sdm.bestmin2++;
+								}
 							}
-							int ret = 0;
-							if(pair) {
-								// Paired-end dynamic programming driver
-								ret = sd.extendSeedsPaired(
-									*rds[mate],     // mate to align as anchor
-									*rds[mate ^ 1], // mate to align as opp.
-									mate == 0,      // anchor is mate 1?
-									!filt[mate ^ 1],// opposite mate filtered out?
-									shs[mate],      // seed hits for anchor
-									ebwtFw,         // bowtie index
-									&ebwtBw,        // rev bowtie index
-									ref,            // packed reference strings
-									sw,             // dyn prog aligner, anchor
-									osw,            // dyn prog aligner, opposite
-									sc,             // scoring scheme
-									pepol,          // paired-end policy
-									-1,             // # mms allowed in a seed
-									0,              // length of a seed
-									0,              // interval between seeds
-									minsc[mate],    // min score for anchor
-									minsc[mate^1],  // min score for opp.
-									nceil[mate],    // N ceil for anchor
-									nceil[mate^1],  // N ceil for opp.
-									nofw[mate],     // don't align forward read
-									norc[mate],     // don't align revcomp read
-									maxhalf,        // max width on one DP side
-									doUngapped,     // do ungapped alignment
-									mxIter[mate],   // max extend loop iters
-									mxUg[mate],     // max # ungapped extends
-									mxDp[mate],     // max # DPs
-									streak[mate],   // stop after streak of this many end-to-end fails
-									streak[mate],   // stop after streak of this many ungap fails
-									streak[mate],   // stop after streak of this many dp fails
-									mtStreak[mate], // max mate fails per seed range
-									doExtend,       // extend seed hits
-									enable8,        // use 8-bit SSE where possible
-									cminlen,        // checkpoint if read is longer
-									cpow2,          // checkpointer interval, log2
-									doTri,          // triangular mini-fills?
-									tighten,        // -M score tightening mode
-									ca,             // seed alignment cache
-									rnd,            // pseudo-random source
-									wlm,            // group walk left metrics
-									swmSeed,        // DP metrics, seed extend
-									swmMate,        // DP metrics, mate finding
-									prm,            // per-read metrics
-									&msinkwrap,     // for organizing hits
-									true,           // seek mate immediately
-									true,           // report hits once found
-									gReportDiscordant,// look for discordant alns?
-									gReportMixed,   // look for unpaired alns?
-									exhaustive[mate]);
-								// Might be done, but just with this mate
-							} else {
-								// Unpaired dynamic programming driver
-								ret = sd.extendSeeds(
-									*rds[mate],     // read
-									mate == 0,      // mate #1?
-									shs[mate],      // seed hits
-									ebwtFw,         // bowtie index
-									&ebwtBw,        // rev bowtie index
-									ref,            // packed reference strings
-									sw,             // dynamic prog aligner
-									sc,             // scoring scheme
-									-1,             // # mms allowed in a seed
-									0,              // length of a seed
-									0,              // interval between seeds
-									minsc[mate],    // minimum score for valid
-									nceil[mate],    // N ceil for anchor
-									maxhalf,        // max width on one DP side
-									doUngapped,     // do ungapped alignment
-									mxIter[mate],   // max extend loop iters
-									mxUg[mate],     // max # ungapped extends
-									mxDp[mate],     // max # DPs
-									streak[mate],   // stop after streak of this many end-to-end fails
-									streak[mate],   // stop after streak of this many ungap fails
-									doExtend,       // extend seed hits
-									enable8,        // use 8-bit SSE where possible
-									cminlen,        // checkpoint if read is longer
-									cpow2,          // checkpointer interval, log2
-									doTri,          // triangular mini-fills?
-									tighten,        // -M score tightening mode
-									ca,             // seed alignment cache
-									rnd,            // pseudo-random source
-									wlm,            // group walk left metrics
-									swmSeed,        // DP metrics, seed extend
-									prm,            // per-read metrics
-									&msinkwrap,     // for organizing hits
-									true,           // report hits once found
-									exhaustive[mate]);
+							matemap[0] = 0; matemap[1] = 1;
+							if(nelt[0] > 0 && nelt[1] > 0 && nelt[0] > nelt[1]) {
+								// Do the mate with fewer exact hits first
+								// TODO: Consider mates & orientations separately?
+								matemap[0] = 1; matemap[1] = 0;
 							}
-							assert_gt(ret, 0);
-							MERGE_SW(sw);
-							MERGE_SW(osw);
-							// Clear out the 1mm hits so that we don't try to
-							// extend them again later!
-							shs[mate].clear1mmE2eHits();
-							if(ret == EXTEND_EXHAUSTED_CANDIDATES) {
-								// Not done yet
-							} else if(ret == EXTEND_POLICY_FULFILLED) {
-								// Policy is satisfied for this mate at least
+							for(size_t matei = 0; matei < (seedSumm ? 0:2); matei++) {
+								size_t mate = matemap[matei];
+								if(nelt[mate] == 0 || nelt[mate] > eePeEeltLimit) {
+									shs[mate].clearExactE2eHits();
+									continue;
+								}
 								if(msinkwrap.state().doneWithMate(mate == 0)) {
+									shs[mate].clearExactE2eHits();
 									done[mate] = true;
+									continue;
 								}
-								if(msinkwrap.state().doneWithMate(mate == 1)) {
-									done[mate^1] = true;
+								assert(filt[mate]);
+								assert(matei == 0 || pair);
+								assert(!msinkwrap.maxed());
+								assert(msinkwrap.repOk());
+								int ret = 0;
+								if(pair) {
+									// Paired-end dynamic programming driver
+									ret = sd.extendSeedsPaired(
+										*rds[mate],     // mate to align as anchor
+										*rds[mate ^ 1], // mate to align as opp.
+										mate == 0,      // anchor is mate 1?
+										!filt[mate ^ 1],// opposite mate filtered out?
+										shs[mate],      // seed hits for anchor
+										ebwtFw,         // bowtie index
+										&ebwtBw,        // rev bowtie index
+										ref,            // packed reference strings
+										sw,             // dyn prog aligner, anchor
+										osw,            // dyn prog aligner, opposite
+										sc,             // scoring scheme
+										pepol,          // paired-end policy
+										-1,             // # mms allowed in a seed
+										0,              // length of a seed
+										0,              // interval between seeds
+										minsc[mate],    // min score for anchor
+										minsc[mate^1],  // min score for opp.
+										nceil[mate],    // N ceil for anchor
+										nceil[mate^1],  // N ceil for opp.
+										nofw[mate],     // don't align forward read
+										norc[mate],     // don't align revcomp read
+										maxhalf,        // max width on one DP side
+										doUngapped,     // do ungapped alignment
+										doBpFilter,     // bit-parallel filter before DP
+										mxIter[mate],   // max extend loop iters
+										mxUg[mate],     // max # ungapped extends
+										mxDp[mate],     // max # DPs
+										streak[mate],   // stop after streak of this many end-to-end fails
+										streak[mate],   // stop after streak of this many ungap fails
+										streak[mate],   // stop after streak of this many dp fails
+										mtStreak[mate], // max mate fails per seed range
+										doExtend,       // extend seed hits
+										enable8,        // use 8-bit SSE where possible
+										cminlen,        // checkpoint if read is longer
+										cpow2,          // checkpointer interval, log2
+										doTri,          // triangular mini-fills?
+										tighten,        // -M score tightening mode
+										ca,             // seed alignment cache
+										rnd,            // pseudo-random source
+										wlm,            // group walk left metrics
+										swmSeed,        // DP metrics, seed extend
+										swmMate,        // DP metrics, mate finding
+										prm,            // per-read metrics
+										&msinkwrap,     // for organizing hits
+										true,           // seek mate immediately
+										true,           // report hits once found
+										gReportDiscordant,// look for discordant alns?
+										gReportMixed,   // look for unpaired alns?
+										exhaustive[mate]);
+									// Might be done, but just with this mate
+								} else {
+									// Unpaired dynamic programming driver
+									ret = sd.extendSeeds(
+										*rds[mate],     // read
+										mate == 0,      // mate #1?
+										shs[mate],      // seed hits
+										ebwtFw,         // bowtie index
+										&ebwtBw,        // rev bowtie index
+										ref,            // packed reference strings
+										sw,             // dynamic prog aligner
+										sc,             // scoring scheme
+										-1,             // # mms allowed in a seed
+										0,              // length of a seed
+										0,              // interval between seeds
+										minsc[mate],    // minimum score for valid
+										nceil[mate],    // N ceil for anchor
+										maxhalf,        // max width on one DP side
+										doUngapped,     // do ungapped alignment
+										doBpFilter,     // bit-parallel filter before DP
+										mxIter[mate],   // max extend loop iters
+										mxUg[mate],     // max # ungapped extends
+										mxDp[mate],     // max # DPs
+										streak[mate],   // stop after streak of this many end-to-end fails
+										streak[mate],   // stop after streak of this many ungap fails
+										doExtend,       // extend seed hits
+										enable8,        // use 8-bit SSE where possible
+										cminlen,        // checkpoint if read is longer
+										cpow2,          // checkpointer interval, log2
+										doTri,          // triangular mini-fills
+										tighten,        // -M score tightening mode
+										ca,             // seed alignment cache
+										rnd,            // pseudo-random source
+										wlm,            // group walk left metrics
+										swmSeed,        // DP metrics, seed extend
+										prm,            // per-read metrics
+										&msinkwrap,     // for organizing hits
+										true,           // report hits once found
+										exhaustive[mate]);
 								}
-							} else if(ret == EXTEND_PERFECT_SCORE) {
-								// We exhausted this mode at least
-								done[mate] = true;
-							} else if(ret == EXTEND_EXCEEDED_HARD_LIMIT) {
-								// We exceeded a per-read limit
-								done[mate] = true;
-							} else if(ret == EXTEND_EXCEEDED_SOFT_LIMIT) {
-								// Not done yet
-							} else {
-								//
-								cerr << "Bad return value: " << ret << endl;
-								throw 1;
-							}
-							if(!done[mate]) {
-								TAlScore perfectScore = sc.perfectScore(rdlens[mate]);
-								if(!done[mate] && minsc[mate] == perfectScore) {
+								assert_gt(ret, 0);
+								MERGE_SW(sw);
+								MERGE_SW(osw);
+								// Clear out the exact hits so that we don't try to
+								// extend them again later!
+								shs[mate].clearExactE2eHits();
+								if(ret == EXTEND_EXHAUSTED_CANDIDATES) {
+									// Not done yet
+								} else if(ret == EXTEND_POLICY_FULFILLED) {
+									// Policy is satisfied for this mate at least
+									if(msinkwrap.state().doneWithMate(mate == 0)) {
+										done[mate] = true;
+									}
+									if(msinkwrap.state().doneWithMate(mate == 1)) {
+										done[mate^1] = true;
+									}
+								} else if(ret == EXTEND_PERFECT_SCORE) {
+									// We exhausted this mode at least
 									done[mate] = true;
+								} else if(ret == EXTEND_EXCEEDED_HARD_LIMIT) {
+									// We exceeded a per-read limit
+									done[mate] = true;
+								} else if(ret == EXTEND_EXCEEDED_SOFT_LIMIT) {
+									// Not done yet
+								} else {
+									//
+									cerr << "Bad return value: " << ret << endl;
+									throw 1;
+								}
+								if(!done[mate]) {
+									TAlScore perfectScore = sc.perfectScore(rdlens[mate]);
+									if(!done[mate] && minsc[mate] == perfectScore) {
+										done[mate] = true;
+									}
 								}
 							}
 						}
-					}
-					int seedlens[2] = { multiseedLen, multiseedLen };
-					nrounds[0] = min<size_t>(nrounds[0], interval[0]);
-					nrounds[1] = min<size_t>(nrounds[1], interval[1]);
-					Constraint gc = Constraint::penaltyFuncBased(scoreMin);
-					size_t seedsTried = 0;
-					size_t nUniqueSeeds = 0, nRepeatSeeds = 0, seedHitTot = 0;
-					for(size_t roundi = 0; roundi < nSeedRounds; roundi++) {
-						ca.nextRead(); // Clear cache in preparation for new search
-						shs[0].clearSeeds();
-						shs[1].clearSeeds();
-						assert(shs[0].empty());
-						assert(shs[1].empty());
-						assert(shs[0].repOk(&ca.current()));
-						assert(shs[1].repOk(&ca.current()));
-						//if(roundi > 0) {
-						//	if(seedlens[0] > 8) seedlens[0]--;
-						//	if(seedlens[1] > 8) seedlens[1]--;
-						//}
-						for(size_t matei = 0; matei < (pair ? 2:1); matei++) {
-							size_t mate = matemap[matei];
-							if(done[mate] || msinkwrap.state().doneWithMate(mate == 0)) {
-								// Done with this mate
-								done[mate] = true;
-								continue;
-							}
-							if(roundi >= nrounds[mate]) {
-								// Not doing this round for this mate
-								continue;
-							}
-							// Figure out the seed offset
-							if(interval[mate] <= (int)roundi) {
-								// Can't do this round, seeds already packed as
-								// tight as possible
-								continue; 
-							}
-							size_t offset = (interval[mate] * roundi) / nrounds[mate];
-							assert(roundi == 0 || offset > 0);
-							assert(!msinkwrap.maxed());
-							assert(msinkwrap.repOk());
-							//rnd.init(ROTL(rds[mate]->seed, 10));
-							assert(shs[mate].repOk(&ca.current()));
-							swmSeed.sdatts++;
-							// Set up seeds
-							seeds[mate]->clear();
-							Seed::mmSeeds(
-								multiseedMms,    // max # mms per seed
-								seedlens[mate],  // length of a multiseed seed
-								*seeds[mate],    // seeds
-								gc);             // global constraint
-							// Check whether the offset would drive the first seed
-							// off the end
-							if(offset > 0 && (*seeds[mate])[0].len + offset > rds[mate]->length()) {
-								continue;
-							}
-							// Instantiate the seeds
-							std::pair<int, int> inst = al.instantiateSeeds(
-								*seeds[mate],   // search seeds
-								offset,         // offset to begin extracting
-								interval[mate], // interval between seeds
-								*rds[mate],     // read to align
-								sc,             // scoring scheme
-								nofw[mate],     // don't align forward read
-								norc[mate],     // don't align revcomp read
-								ca,             // holds some seed hits from previous reads
-								shs[mate],      // holds all the seed hits
-								sdm);           // metrics
-							assert(shs[mate].repOk(&ca.current()));
-							if(inst.first + inst.second == 0) {
-								// No seed hits!  Done with this mate.
+						// 1-mismatch
+						if(do1mmUpFront && !seedSumm) {
+							for(size_t matei = 0; matei < (pair ? 2:1); matei++) {
+								size_t mate = matemap[matei];
+								if(!filt[mate] || done[mate] || nelt[mate] > eePeEeltLimit) {
+									// Done with this mate
+									shs[mate].clear1mmE2eHits();
+									nelt[mate] = 0;
+									continue;
+								}
+								nelt[mate] = 0;
+								assert(!msinkwrap.maxed());
+								assert(msinkwrap.repOk());
+								//rnd.init(ROTL(rds[mate]->seed, 10));
 								assert(shs[mate].empty());
-								done[mate] = true;
-								break;
-							}
-							seedsTried += (inst.first + inst.second);
-							// Align seeds
-							al.searchAllSeeds(
-								*seeds[mate],     // search seeds
-								&ebwtFw,          // BWT index
-								&ebwtBw,          // BWT' index
-								*rds[mate],       // read
-								sc,               // scoring scheme
-								ca,               // alignment cache
-								shs[mate],        // store seed hits here
-								sdm,              // metrics
-								prm);             // per-read metrics
-							assert(shs[mate].repOk(&ca.current()));
-							if(shs[mate].empty()) {
-								// No seed alignments!  Done with this mate.
-								done[mate] = true;
-								break;
-							}
-						}
-						// shs contain what we need to know to update our seed
-						// summaries for this seeding
-						for(size_t mate = 0; mate < 2; mate++) {
-							if(!shs[mate].empty()) {
-								nUniqueSeeds += shs[mate].numUniqueSeeds();
-								nRepeatSeeds += shs[mate].numRepeatSeeds();
-								seedHitTot += shs[mate].numElts();
-							}
-						}
-						double uniqFactor[2] = { 0.0f, 0.0f };
-						for(size_t i = 0; i < 2; i++) {
-							if(!shs[i].empty()) {
-								swmSeed.sdsucc++;
-								uniqFactor[i] = shs[i].uniquenessFactor();
+								assert(shs[mate].repOk(&ca.current()));
+								bool yfw = minedfw[mate] <= 1 && !nofw[mate];
+								bool yrc = minedrc[mate] <= 1 && !norc[mate];
+								if(yfw || yrc) {
+									// Clear out the exact hits
+									swmSeed.mm1atts++;
+									al.oneMmSearch(
+										&ebwtFw,        // BWT index
+										&ebwtBw,        // BWT' index
+										*rds[mate],     // read
+										sc,             // scoring scheme
+										minsc[mate],    // minimum score
+										!yfw,           // don't align forward read
+										!yrc,           // don't align revcomp read
+										localAlign,     // must be legal local alns?
+										false,          // do exact match
+										true,           // do 1mm
+										shs[mate],      // seed hits (hits installed here)
+										sdm);           // metrics
+									nelt[mate] = shs[mate].num1mmE2eHits();
+								}
 							}
-						}
-						// Possibly reorder the mates
-						matemap[0] = 0; matemap[1] = 1;
-						if(!shs[0].empty() && !shs[1].empty() && uniqFactor[1] > uniqFactor[0]) {
-							// Do the mate with fewer exact hits first
-							// TODO: Consider mates & orientations separately?
-							matemap[0] = 1; matemap[1] = 0;
-						}
-						for(size_t matei = 0; matei < (pair ? 2:1); matei++) {
-							size_t mate = matemap[matei];
-							if(done[mate] || msinkwrap.state().doneWithMate(mate == 0)) {
-								// Done with this mate
-								done[mate] = true;
-								continue;
+							// Possibly reorder the mates
+							matemap[0] = 0; matemap[1] = 1;
+							if(nelt[0] > 0 && nelt[1] > 0 && nelt[0] > nelt[1]) {
+								// Do the mate with fewer exact hits first
+								// TODO: Consider mates & orientations separately?
+								matemap[0] = 1; matemap[1] = 0;
 							}
-							assert(!msinkwrap.maxed());
-							assert(msinkwrap.repOk());
-							//rnd.init(ROTL(rds[mate]->seed, 10));
-							assert(shs[mate].repOk(&ca.current()));
-							if(!seedSumm) {
-								// If there aren't any seed hits...
-								if(shs[mate].empty()) {
-									continue; // on to the next mate
+							for(size_t matei = 0; matei < (seedSumm ? 0:2); matei++) {
+								size_t mate = matemap[matei];
+								if(nelt[mate] == 0 || nelt[mate] > eePeEeltLimit) {
+									continue;
+								}
+								if(msinkwrap.state().doneWithMate(mate == 0)) {
+									done[mate] = true;
+									continue;
 								}
-								// Sort seed hits into ranks
-								shs[mate].rankSeedHits(rnd, msinkwrap.allHits());
 								int ret = 0;
 								if(pair) {
 									// Paired-end dynamic programming driver
@@ -3648,9 +3550,9 @@ static void multiseedSearchWorker(void *vp) {
 										osw,            // dyn prog aligner, opposite
 										sc,             // scoring scheme
 										pepol,          // paired-end policy
-										multiseedMms,   // # mms allowed in a seed
-										seedlens[mate], // length of a seed
-										interval[mate], // interval between seeds
+										-1,             // # mms allowed in a seed
+										0,              // length of a seed
+										0,              // interval between seeds
 										minsc[mate],    // min score for anchor
 										minsc[mate^1],  // min score for opp.
 										nceil[mate],    // N ceil for anchor
@@ -3659,6 +3561,7 @@ static void multiseedSearchWorker(void *vp) {
 										norc[mate],     // don't align revcomp read
 										maxhalf,        // max width on one DP side
 										doUngapped,     // do ungapped alignment
+										doBpFilter,     // bit-parallel filter before DP
 										mxIter[mate],   // max extend loop iters
 										mxUg[mate],     // max # ungapped extends
 										mxDp[mate],     // max # DPs
@@ -3696,13 +3599,14 @@ static void multiseedSearchWorker(void *vp) {
 										ref,            // packed reference strings
 										sw,             // dynamic prog aligner
 										sc,             // scoring scheme
-										multiseedMms,   // # mms allowed in a seed
-										seedlens[mate], // length of a seed
-										interval[mate], // interval between seeds
+										-1,             // # mms allowed in a seed
+										0,              // length of a seed
+										0,              // interval between seeds
 										minsc[mate],    // minimum score for valid
 										nceil[mate],    // N ceil for anchor
 										maxhalf,        // max width on one DP side
 										doUngapped,     // do ungapped alignment
+										doBpFilter,     // bit-parallel filter before DP
 										mxIter[mate],   // max extend loop iters
 										mxUg[mate],     // max # ungapped extends
 										mxDp[mate],     // max # DPs
@@ -3726,6 +3630,9 @@ static void multiseedSearchWorker(void *vp) {
 								assert_gt(ret, 0);
 								MERGE_SW(sw);
 								MERGE_SW(osw);
+								// Clear out the 1mm hits so that we don't try to
+								// extend them again later!
+								shs[mate].clear1mmE2eHits();
 								if(ret == EXTEND_EXHAUSTED_CANDIDATES) {
 									// Not done yet
 								} else if(ret == EXTEND_POLICY_FULFILLED) {
@@ -3737,7 +3644,7 @@ static void multiseedSearchWorker(void *vp) {
 										done[mate^1] = true;
 									}
 								} else if(ret == EXTEND_PERFECT_SCORE) {
-									// We exhausted this made at least
+									// We exhausted this mode at least
 									done[mate] = true;
 								} else if(ret == EXTEND_EXCEEDED_HARD_LIMIT) {
 									// We exceeded a per-read limit
@@ -3749,18 +3656,357 @@ static void multiseedSearchWorker(void *vp) {
 									cerr << "Bad return value: " << ret << endl;
 									throw 1;
 								}
-							} // if(!seedSumm)
-						} // for(size_t matei = 0; matei < 2; matei++)
-						
-						// We don't necessarily have to continue investigating both
-						// mates.  We continue on a mate only if its average
-						// interval length is high (> 1000)
-						for(size_t mate = 0; mate < 2; mate++) {
-							if(!done[mate] && shs[mate].averageHitsPerSeed() < seedBoostThresh) {
-								done[mate] = true;
+								if(!done[mate]) {
+									TAlScore perfectScore = sc.perfectScore(rdlens[mate]);
+									if(!done[mate] && minsc[mate] == perfectScore) {
+										done[mate] = true;
+									}
+								}
+							}
+						}
+						int seedlens[2] = { multiseedLen, multiseedLen };
+						nrounds[0] = min<size_t>(nrounds[0], interval[0]);
+						nrounds[1] = min<size_t>(nrounds[1], interval[1]);
+						// With --adaptive-seed, all rounds are shifted so that
+						// the first round's seeds avoid Ns and low qualities
+						size_t seedBase[2] = { 0, 0 };
+						if(adaptiveSeed) {
+							for(size_t mate = 0; mate < (pair ? 2:1); mate++) {
+								if(filt[mate]) {
+									seedBase[mate] = SeedAligner::adaptiveSeedOffset(
+										*rds[mate], seedlens[mate], interval[mate]);
+								}
 							}
 						}
-					} // end loop over reseeding rounds
+						Constraint gc = Constraint::penaltyFuncBased(scoreMin);
+						for(size_t roundi = 0; roundi < nSeedRounds; roundi++) {
+							// Whether extension tried every seed hit this round
+							bool roundExhausted[2] = { false, false };
+							ca.nextRead(); // Clear cache in preparation for new search
+							shs[0].clearSeeds();
+							shs[1].clearSeeds();
+							assert(shs[0].empty());
+							assert(shs[1].empty());
+							assert(shs[0].repOk(&ca.current()));
+							assert(shs[1].repOk(&ca.current()));
+							//if(roundi > 0) {
+							//	if(seedlens[0] > 8) seedlens[0]--;
+							//	if(seedlens[1] > 8) seedlens[1]--;
+							//}
+							for(size_t matei = 0; matei < (pair ? 2:1); matei++) {
+								size_t mate = matemap[matei];
+								if(done[mate] || msinkwrap.state().doneWithMate(mate == 0)) {
+									// Done with this mate
+									done[mate] = true;
+									continue;
+								}
+								if(roundi >= nrounds[mate]) {
+									// Not doing this round for this mate
+									continue;
+								}
+								if(smemMaxOcc > 0 && roundi > 0) {
+									// Exact-match seeds don't depend on an offset,
+									// so there's nothing to re-seed with
+									continue;
+								}
+								// Figure out the seed offset
+								if(interval[mate] <= (int)roundi) {
+									// Can't do this round, seeds already packed as
+									// tight as possible
+									continue; 
+								}
+								size_t offset = (interval[mate] * roundi) / nrounds[mate];
+								assert(roundi == 0 || offset > 0);
+								offset = (seedBase[mate] + offset) % interval[mate];
+								assert(!msinkwrap.maxed());
+								assert(msinkwrap.repOk());
+								//rnd.init(ROTL(rds[mate]->seed, 10));
+								assert(shs[mate].repOk(&ca.current()));
+								swmSeed.sdatts++;
+								if(smemMaxOcc > 0) {
+									// Seed with maximal exact matches
+									size_t nsmem = al.searchSmems(
+										&ebwtFw,          // BWT index
+										&ebwtBw,          // BWT' index
+										*rds[mate],       // read
+										multiseedLen,     // minimum seed length
+										smemMaxOcc,       // max # occurrences
+										nofw[mate],       // don't align forward read
+										norc[mate],       // don't align revcomp read
+										ca,               // alignment cache
+										shs[mate],        // store seed hits here
+										sdm,              // metrics
+										prm);             // per-read metrics
+									seedsTried += nsmem;
+									if(shs[mate].empty()) {
+										// No seed alignments!  Done with this mate.
+										done[mate] = true;
+										break;
+									}
+									continue;
+								}
+								// Set up seeds
+								seeds[mate]->clear();
+								Seed::mmSeeds(
+									multiseedMms,    // max # mms per seed
+									seedlens[mate],  // length of a multiseed seed
+									*seeds[mate],    // seeds
+									gc);             // global constraint
+								// Check whether the offset would drive the first seed
+								// off the end
+								if(offset > 0 && (*seeds[mate])[0].len + offset > rds[mate]->length()) {
+									continue;
+								}
+								// Instantiate the seeds
+								std::pair<int, int> inst = al.instantiateSeeds(
+									*seeds[mate],   // search seeds
+									offset,         // offset to begin extracting
+									interval[mate], // interval between seeds
+									*rds[mate],     // read to align
+									sc,             // scoring scheme
+									nofw[mate],     // don't align forward read
+									norc[mate],     // don't align revcomp read
+									ca,             // holds some seed hits from previous reads
+									shs[mate],      // holds all the seed hits
+									sdm);           // metrics
+								assert(shs[mate].repOk(&ca.current()));
+								if(inst.first + inst.second == 0) {
+									// No seed hits!  Done with this mate.
+									assert(shs[mate].empty());
+									done[mate] = true;
+									break;
+								}
+								seedsTried += (inst.first + inst.second);
+								// Align seeds
+								al.searchAllSeeds(
+									*seeds[mate],     // search seeds
+									&ebwtFw,          // BWT index
+									&ebwtBw,          // BWT' index
+									*rds[mate],       // read
+									sc,               // scoring scheme
+									ca,               // alignment cache
+									shs[mate],        // store seed hits here
+									sdm,              // metrics
+									prm);             // per-read metrics
+								assert(shs[mate].repOk(&ca.current()));
+								if(shs[mate].empty()) {
+									// No seed alignments!  Done with this mate.
+									done[mate] = true;
+									break;
+								}
+							}
+							// shs contain what we need to know to update our seed
+							// summaries for this seeding
+							for(size_t mate = 0; mate < 2; mate++) {
+								if(!shs[mate].empty()) {
+									nUniqueSeeds += shs[mate].numUniqueSeeds();
+									nRepeatSeeds += shs[mate].numRepeatSeeds();
+									seedHitTot += shs[mate].numElts();
+								}
+							}
+							double uniqFactor[2] = { 0.0f, 0.0f };
+							for(size_t i = 0; i < 2; i++) {
+								if(!shs[i].empty()) {
+									swmSeed.sdsucc++;
+									uniqFactor[i] = shs[i].uniquenessFactor();
+								}
+							}
+							// Possibly reorder the mates
+							matemap[0] = 0; matemap[1] = 1;
+							if(!shs[0].empty() && !shs[1].empty() && uniqFactor[1] > uniqFactor[0]) {
+								// Do the mate with fewer exact hits first
+								// TODO: Consider mates & orientations separately?
+								matemap[0] = 1; matemap[1] = 0;
+							}
+							for(size_t matei = 0; matei < (pair ? 2:1); matei++) {
+								size_t mate = matemap[matei];
+								if(done[mate] || msinkwrap.state().doneWithMate(mate == 0)) {
+									// Done with this mate
+									done[mate] = true;
+									continue;
+								}
+								assert(!msinkwrap.maxed());
+								assert(msinkwrap.repOk());
+								//rnd.init(ROTL(rds[mate]->seed, 10));
+								assert(shs[mate].repOk(&ca.current()));
+								if(!seedSumm) {
+									// If there aren't any seed hits...
+									if(shs[mate].empty()) {
+										continue; // on to the next mate
+									}
+									// Sort seed hits into ranks
+									shs[mate].rankSeedHits(rnd, msinkwrap.allHits());
+									int ret = 0;
+									if(pair) {
+										// Paired-end dynamic programming driver
+										ret = sd.extendSeedsPaired(
+											*rds[mate],     // mate to align as anchor
+											*rds[mate ^ 1], // mate to align as opp.
+											mate == 0,      // anchor is mate 1?
+											!filt[mate ^ 1],// opposite mate filtered out?
+											shs[mate],      // seed hits for anchor
+											ebwtFw,         // bowtie index
+											&ebwtBw,        // rev bowtie index
+											ref,            // packed reference strings
+											sw,             // dyn prog aligner, anchor
+											osw,            // dyn prog aligner, opposite
+											sc,             // scoring scheme
+											pepol,          // paired-end policy
+											multiseedMms,   // # mms allowed in a seed
+											seedlens[mate], // length of a seed
+											interval[mate], // interval between seeds
+											minsc[mate],    // min score for anchor
+											minsc[mate^1],  // min score for opp.
+											nceil[mate],    // N ceil for anchor
+											nceil[mate^1],  // N ceil for opp.
+											nofw[mate],     // don't align forward read
+											norc[mate],     // don't align revcomp read
+											maxhalf,        // max width on one DP side
+											doUngapped,     // do ungapped alignment
+											doBpFilter,     // bit-parallel filter before DP
+											mxIter[mate],   // max extend loop iters
+											mxUg[mate],     // max # ungapped extends
+											mxDp[mate],     // max # DPs
+											streak[mate],   // stop after streak of this many end-to-end fails
+											streak[mate],   // stop after streak of this many ungap fails
+											streak[mate],   // stop after streak of this many dp fails
+											mtStreak[mate], // max mate fails per seed range
+											doExtend,       // extend seed hits
+											enable8,        // use 8-bit SSE where possible
+											cminlen,        // checkpoint if read is longer
+											cpow2,          // checkpointer interval, log2
+											doTri,          // triangular mini-fills?
+											tighten,        // -M score tightening mode
+											ca,             // seed alignment cache
+											rnd,            // pseudo-random source
+											wlm,            // group walk left metrics
+											swmSeed,        // DP metrics, seed extend
+											swmMate,        // DP metrics, mate finding
+											prm,            // per-read metrics
+											&msinkwrap,     // for organizing hits
+											true,           // seek mate immediately
+											true,           // report hits once found
+											gReportDiscordant,// look for discordant alns?
+											gReportMixed,   // look for unpaired alns?
+											exhaustive[mate]);
+										// Might be done, but just with this mate
+									} else {
+										// Unpaired dynamic programming driver
+										ret = sd.extendSeeds(
+											*rds[mate],     // read
+											mate == 0,      // mate #1?
+											shs[mate],      // seed hits
+											ebwtFw,         // bowtie index
+											&ebwtBw,        // rev bowtie index
+											ref,            // packed reference strings
+											sw,             // dynamic prog aligner
+											sc,             // scoring scheme
+											multiseedMms,   // # mms allowed in a seed
+											seedlens[mate], // length of a seed
+											interval[mate], // interval between seeds
+											minsc[mate],    // minimum score for valid
+											nceil[mate],    // N ceil for anchor
+											maxhalf,        // max width on one DP side
+											doUngapped,     // do ungapped alignment
+											doBpFilter,     // bit-parallel filter before DP
+											mxIter[mate],   // max extend loop iters
+											mxUg[mate],     // max # ungapped extends
+											mxDp[mate],     // max # DPs
+											streak[mate],   // stop after streak of this many end-to-end fails
+											streak[mate],   // stop after streak of this many ungap fails
+											doExtend,       // extend seed hits
+											enable8,        // use 8-bit SSE where possible
+											cminlen,        // checkpoint if read is longer
+											cpow2,          // checkpointer interval, log2
+											doTri,          // triangular mini-fills?
+											tighten,        // -M score tightening mode
+											ca,             // seed alignment cache
+											rnd,            // pseudo-random source
+											wlm,            // group walk left metrics
+											swmSeed,        // DP metrics, seed extend
+											prm,            // per-read metrics
+											&msinkwrap,     // for organizing hits
+											true,           // report hits once found
+											exhaustive[mate]);
+									}
+									assert_gt(ret, 0);
+									MERGE_SW(sw);
+									MERGE_SW(osw);
+									if(ret == EXTEND_EXHAUSTED_CANDIDATES) {
+										// Not done yet; every hit was extended
+										// unless there were too many to try
+										roundExhausted[mate] = !sd.sampledHits();
+									} else if(ret == EXTEND_POLICY_FULFILLED) {
+										// Policy is satisfied for this mate at least
+										if(msinkwrap.state().doneWithMate(mate == 0)) {
+											done[mate] = true;
+										}
+										if(msinkwrap.state().doneWithMate(mate == 1)) {
+											done[mate^1] = true;
+										}
+									} else if(ret == EXTEND_PERFECT_SCORE) {
+										// We exhausted this made at least
+										done[mate] = true;
+									} else if(ret == EXTEND_EXCEEDED_HARD_LIMIT) {
+										// We exceeded a per-read limit
+										done[mate] = true;
+									} else if(ret == EXTEND_EXCEEDED_SOFT_LIMIT) {
+										// Not done yet
+									} else {
+										//
+										cerr << "Bad return value: " << ret << endl;
+										throw 1;
+									}
+								} // if(!seedSumm)
+							} // for(size_t matei = 0; matei < 2; matei++)
+						
+							// We don't necessarily have to continue investigating both
+							// mates.  We continue on a mate only if its average
+							// interval length is high (> 1000)
+							for(size_t mate = 0; mate < 2; mate++) {
+								if(!done[mate] && shs[mate].averageHitsPerSeed() < seedBoostThresh) {
+									done[mate] = true;
+								}
+							}
+							// With --adaptive-seed, also stop re-seeding a mate once
+							// every hit for this round's seeds has been extended, with
+							// none left out by sampling, and no alignment these seeds
+							// missed could change the best or second-best score.  A missed end-to-end alignment
+							// needs more than multiseedMms edits in each disjoint
+							// seed, and at least as many edits as exactSweep found.
+							if(adaptiveSeed && !localAlign && khits == 1 && !msinkwrap.allHits()) {
+								for(size_t mate = 0; mate < (pair ? 2:1); mate++) {
+									if(done[mate] || !roundExhausted[mate]) {
+										continue;
+									}
+									size_t edits = shs[mate].numDisjointSeeds(
+										seedlens[mate], nofw[mate], norc[mate]) * (multiseedMms + 1);
+									size_t mined = nofw[mate] ? minedrc[mate] :
+									               (norc[mate] ? minedfw[mate] :
+									                min(minedfw[mate], minedrc[mate]));
+									edits = max(edits, mined);
+									// Cheapest edit; a gap position past the
+									// first costs only the extension penalty
+									TAlScore minpen = min<TAlScore>(sc.mmpMin, sc.n(0));
+									minpen = min<TAlScore>(minpen, sc.readGapExtend());
+									minpen = min<TAlScore>(minpen, sc.refGapExtend());
+									// Best score any missed alignment could have
+									TAlScore missed = sc.perfectScore(rdlens[mate]) - (TAlScore)edits * minpen;
+									if(missed < minsc[mate]) {
+										done[mate] = true;
+									} else if(pair) {
+										done[mate] = msinkwrap.hasSecondBestPair() &&
+										             msinkwrap.secondBestPair() >=
+										             missed + sc.perfectScore(rdlens[mate ^ 1]);
+									} else {
+										done[mate] = msinkwrap.hasSecondBestUnp1() &&
+										             msinkwrap.secondBestUnp1() >= missed;
+									}
+								}
+							}
+						} // end loop over reseeding rounds
+					} // end loop over indexes
+					msinkwrap.setRefOffset(0);
 					if(seedsTried != 0) {
 						prm.seedPctUnique = (float)nUniqueSeeds / seedsTried;
 						prm.seedPctRep = (float)nRepeatSeeds / seedsTried;
@@ -3787,7 +4033,26 @@ static void multiseedSearchWorker(void *vp) {
 						assert_leq(prm.nUgFail,  streak[i]);
 						assert_leq(prm.nEeFail,  streak[i]);
 					}
+					if(useCache) {
+						ReadResultEntry& e = rcache.insert(
+							ps->bufa(),
+							pair ? &ps->bufb() : NULL,
+							filt,
+							rdseed);
+						msinkwrap.saveReported(e.alns);
+						e.exhaust[0] = exhaustive[0];
+						e.exhaust[1] = exhaustive[1];
+						e.rnd = rnd;
+						e.prm = prm;
+					}
+				}
 
+				if(useCache) {
+					// Choose among equally good alignments using the name
+					// too, as without the cache, so duplicates don't all
+					// pile up on the same copy of a repeat
+					rnd.init(rnd.nextU32() ^ nmseed);
+				}
 				// Commit and report paired-end/unpaired alignments
 				//uint32_t sd = rds[0]->seed ^ rds[1]->seed;
 				//rnd.init(ROTL(sd, 20));
@@ -3831,6 +4096,7 @@ static void multiseedSearchWorker(void *vp) {
 	if(dpLog    != NULL) dpLog->close();
 	if(dpLogOpp != NULL) dpLogOpp->close();
 
+	EArena::setThreadArena(NULL);
 	return;
 }
 
@@ -3840,13 +4106,13 @@ void multiseedSearchWorker_2p5::operator()() {
 static void multiseedSearchWorker_2p5(void *vp) {
 	int tid = *((int*)vp);
 #endif
-	assert(multiseed_ebwtFw != NULL);
-	assert(multiseedMms == 0 || multiseed_ebwtBw != NULL);
+	assert_eq(1, multiseed_ebwtFw.size());
+	assert(multiseedMms == 0 || multiseed_ebwtBw[0] != NULL);
 	PairedPatternSource&    patsrc   = *multiseed_patsrc;
-	const Ebwt&             ebwtFw   = *multiseed_ebwtFw;
-	const Ebwt&             ebwtBw   = *multiseed_ebwtBw;
+	const Ebwt&             ebwtFw   = *multiseed_ebwtFw[0];
+	const Ebwt&             ebwtBw   = *multiseed_ebwtBw[0];
 	const Scoring&          sc       = *multiseed_sc;
-	const BitPairReference& ref      = *multiseed_refs;
+	const BitPairReference& ref      = *multiseed_refs[0];
 	AlnSink&                msink    = *multiseed_msink;
 	OutFileBuf*             metricsOfb = multiseed_metricsOfb;
 
@@ -3931,6 +4197,11 @@ static void multiseedSearchWorker_2p5(void *vp) {
 	
 	PerReadMetrics prm;
 
+	// Scratch arena for transient per-read buffers (e.g. sort buffers);
+	// reset at each read boundary
+	EArena scratch(64 * 1024, MISC_CAT);
+	EArena::setThreadArena(&scratch);
+
 	// Used by thread with threadid == 1 to measure time elapsed
 	time_t iTime = time(0);
 
@@ -3997,7 +4268,7 @@ static void multiseedSearchWorker_2p5(void *vp) {
 			prm.doFmString = sam_print_zm;
 			// If we're reporting how long each read takes, get the initial time
 			// measurement here
-			if(sam_print_xt) {
+			if(sam_print_xt || maxLatencyMs > 0) {
 				gettimeofday(&prm.tv_beg, &prm.tz_beg);
 			}
 			// Try to align this read
@@ -4007,6 +4278,7 @@ static void multiseedSearchWorker_2p5(void *vp) {
 			const size_t rdlen1 = ps->bufa().length();
 			const size_t rdlen2 = pair ? ps->bufb().length() : 0;
 			olm.bases += (rdlen1 + rdlen2);
+			scratch.reset();
 			// Check if read is identical to previous read
 			rnd.init(ROTL(ps->bufa().seed, 5));
 			msinkwrap.nextRead(
@@ -4166,6 +4438,7 @@ static void multiseedSearchWorker_2p5(void *vp) {
 	// One last metrics merge
 	MERGE_METRICS(metrics, nthreads > 1);
 
+	EArena::setThreadArena(NULL);
 	return;
 }
 
@@ -4176,47 +4449,57 @@ static void multiseedSearchWorker_2p5(void *vp) {
  */
 static void multiseedSearch(
 	Scoring& sc,
-	PairedPatternSource& patsrc,  // pattern source
-	AlnSink& msink,             // hit sink
-	Ebwt& ebwtFw,                 // index of original text
-	Ebwt& ebwtBw,                 // index of mirror text
+	PairedPatternSource& patsrc,   // pattern source
+	AlnSink& msink,                // hit sink
+	const EList<string>& idxBases, // basename of each index in the set
+	EList<Ebwt*>& ebwtFws,         // index of original text, for each
+	EList<Ebwt*>& ebwtBws,         // index of mirror text, for each
 	OutFileBuf *metricsOfb)
 {
+	assert_eq(idxBases.size(), ebwtFws.size());
+	assert_eq(idxBases.size(), ebwtBws.size());
 	multiseed_patsrc = &patsrc;
 	multiseed_msink  = &msink;
-	multiseed_ebwtFw = &ebwtFw;
-	multiseed_ebwtBw = &ebwtBw;
+	multiseed_ebwtFw = ebwtFws;
+	multiseed_ebwtBw = ebwtBws;
 	multiseed_sc     = &sc;
 	multiseed_metricsOfb      = metricsOfb;
-	Timer *_t = new Timer(cerr, "Time loading reference: ", timing);
-	auto_ptr<BitPairReference> refs(
-		new BitPairReference(
-			adjIdxBase,
-			false,
-			sanityCheck,
-			NULL,
-			NULL,
-			false,
-			useMm,
-			useShmem,
-			mmSweep,
-			gVerbose,
-			startVerbose)
-	);
-	delete _t;
-	if(!refs->loaded()) throw 1;
-	multiseed_refs = refs.get();
+	multiseed_refs.clear();
+	multiseed_refOff.clear();
+	TRefId nrefs = 0;
+	for(size_t i = 0; i < idxBases.size(); i++) {
+		Timer *_t = new Timer(cerr, "Time loading reference: ", timing);
+		multiseed_refs.push_back(
+			new BitPairReference(
+				idxBases[i],
+				false,
+				sanityCheck,
+				NULL,
+				NULL,
+				false,
+				useMm,
+				useShmem,
+				mmSweep,
+				gVerbose,
+				startVerbose)
+		);
+		delete _t;
+		if(!multiseed_refs.back()->loaded()) throw 1;
+		// Ids of this index's references follow those of earlier indexes
+		multiseed_refOff.push_back(nrefs);
+		nrefs += (TRefId)ebwtFws[i]->nPat();
+	}
 #ifdef WITH_TBB
 	tbb::task_group tbb_grp;
 #else
 	AutoArray<tthread::thread*> threads(nthreads+1);
 	AutoArray<int> tids(nthreads+1);
 #endif
-	{
+	for(size_t i = 0; i < ebwtFws.size(); i++) {
 		// Load the other half of the index into memory
-		assert(!ebwtFw.isInMemory());
+		assert(!ebwtFws[i]->isInMemory());
 		Timer _t(cerr, "Time loading forward index: ", timing);
-		ebwtFw.loadIntoMemory(
+		ebwtFws[i]->loadIntoMemory(
 			0,  // colorspace?
 			-1, // not the reverse index
 			true,         // load SA samp? (yes, need forward index's SA samp)
@@ -4226,19 +4509,21 @@ static void multiseedSearch(
 			startVerbose);
 	}
 	if(multiseedMms > 0 || do1mmUpFront) {
-		// Load the other half of the index into memory
-		assert(!ebwtBw.isInMemory());
-		Timer _t(cerr, "Time loading mirror index: ", timing);
-		ebwtBw.loadIntoMemory(
-			0, // colorspace?
-			// It's bidirectional search, so we need the reverse to be
-			// constructed as the reverse of the concatenated strings.
-			1,
-			false,        // don't load SA samp in reverse index
-			true,         // yes, need ftab in reverse index
-			false,        // don't load rstarts in reverse index
-			!noRefNames,  // load names?
-			startVerbose);
+		for(size_t i = 0; i < ebwtBws.size(); i++) {
+			// Load the other half of the index into memory
+			assert(!ebwtBws[i]->isInMemory());
+			Timer _t(cerr, "Time loading mirror index: ", timing);
+			ebwtBws[i]->loadIntoMemory(
+				0, // colorspace?
+				// It's bidirectional search, so we need the reverse to be
+				// constructed as the reverse of the concatenated strings.
+				1,
+				false,        // don't load SA samp in reverse index
+				true,         // yes, need ftab in reverse index
+				false,        // don't load rstarts in reverse index
+				!noRefNames,  // load names?
+				startVerbose);
+		}
 	}
 	// Start the metrics thread
 	{
@@ -4270,10 +4555,31 @@ static void multiseedSearch(
 	if(!metricsPerRead && (metricsOfb != NULL || metricsStderr)) {
 		metrics.reportInterval(metricsOfb, metricsStderr, true, false, NULL);
 	}
+	for(size_t i = 0; i < multiseed_refs.size(); i++) {
+		delete multiseed_refs[i];
+	}
+	multiseed_refs.clear();
 }
 
 static string argstr;
 
+/**
+ * Print percentiles of the time from when work started on each read or
+ * pair to when its SAM records were pushed out, for --max-latency.
+ */
+static void printLatencies(const LatencyHist& lat) {
+	const double pcts[] = { 0.5, 0.9, 0.99, 0.999 };
+	const char *names[] = { "50%", "90%", "99%", "99.9%" };
+	std::ostringstream oss;
+	oss << std::fixed << std::setprecision(1)
+	    << "Latency in ms over " << lat.size() << " reads/pairs:";
+	for(size_t i = 0; i < 4; i++) {
+		oss << " " << names[i] << " " << (lat.percentile(pcts[i]) / 1000.0);
+	}
+	oss << " max " << (lat.max() / 1000.0) << endl;
+	cerr << oss.str().c_str();
+}
+
 template<typename TStr>
 static void driver(
 	const char * type,
@@ -4304,7 +4610,8 @@ static void driver(
 		fuzzy,         // true -> try to parse fuzzy fastq
 		fastaContLen,  // length of sampled reads for FastaContinuous...
 		fastaContFreq, // frequency of sampled reads for FastaContinuous...
-		skipReads      // skip the first 'skip' patterns
+		skipReads,     // skip the first 'skip' patterns
+		maxLatencyMs > 0 // parse reads as soon as they arrive
 	);
 	if(gVerbose || startVerbose) {
 		cerr << "Creating PatternSource: "; logTime(cerr, true);
@@ -4319,6 +4626,14 @@ static void driver(
 		qualities2,  // qualities associated with m2
 		pp,          // read read-in parameters
 		gVerbose || startVerbose); // be talkative
+	if(sortWindow > 0) {
+		patsrc = new SortedPatternSource(
+			patsrc,      // source to wrap
+			sortWindow,  // # reads/pairs to sort at a time
+			skipReads,   // drop reads before this rdid
+			qUpto,       // stop before this rdid
+			pp);         // read read-in parameters
+	}
 	// Open hit output file
 	if(gVerbose || startVerbose) {
 		cerr << "Opening hit output file: "; logTime(cerr, true);
@@ -4333,51 +4648,110 @@ static void driver(
 	if(gVerbose || startVerbose) {
 		cerr << "About to initialize fw Ebwt: "; logTime(cerr, true);
 	}
-	adjIdxBase = adjustEbwtBase(argv0, bt2indexBase, gVerbose);
-	Ebwt ebwt(
-		adjIdxBase,
-	    0,        // index is colorspace
-		-1,       // fw index
-	    true,     // index is for the forward direction
-	    /* overriding: */ offRate,
-		0, // amount to add to index offrate or <= 0 to do nothing
-	    useMm,    // whether to use memory-mapped files
-	    useShmem, // whether to use shared memory
-	    mmSweep,  // sweep memory-mapped files
-	    !noRefNames, // load names?
-		true,        // load SA sample?
-		true,        // load ftab?
-		true,        // load rstarts?
-	    gVerbose, // whether to be talkative
-	    startVerbose, // talkative during initialization
-	    false /*passMemExc*/,
-	    sanityCheck);
-	Ebwt* ebwtBw = NULL;
-	// We need the mirror index if mismatches are allowed
-	if(multiseedMms > 0 || do1mmUpFront) {
-		if(gVerbose || startVerbose) {
-			cerr << "About to initialize rev Ebwt: "; logTime(cerr, true);
+	// -x may name a set of indexes separated by commas, e.g. a host genome
+	// plus a panel of contaminants, or a genome split into several indexes;
+	// reads are aligned against all of them in one pass
+	EList<string> idxBases;
+	{
+		ifstream in((bt2indexBase + ".1." + gEbwt_ext).c_str());
+		if(in.is_open() || bt2indexBase.find(',') == string::npos) {
+			idxBases.push_back(bt2indexBase);
+		} else {
+			tokenize(bt2indexBase, ",", idxBases);
 		}
-		ebwtBw = new Ebwt(
-			adjIdxBase + ".rev",
-			0,       // index is colorspace
-			1,       // TODO: maybe not
-		    false, // index is for the reverse direction
-		    /* overriding: */ offRate,
+	}
+	if(idxBases.size() > 1 && bowtie2p5) {
+		cerr << "Error: a set of indexes can't be used with --test-25" << endl;
+		throw 1;
+	}
+	if(idxBases.size() > 1 && !msNoCache) {
+		// The across-read seed cache holds BW ranges for a single index
+		cerr << "Warning: --cache is ignored when aligning against a set of indexes" << endl;
+		msNoCache = true;
+	}
+	EList<Ebwt*> ebwtFws, ebwtBws;
+	EList<HotSeeds*> hotSeeds;
+	EList<Ftab2*> ftab2s; // 2 per index: forward, mirror
+	for(size_t i = 0; i < idxBases.size(); i++) {
+		idxBases[i] = adjustEbwtBase(argv0, idxBases[i], gVerbose);
+		ebwtFws.push_back(new Ebwt(
+			idxBases[i],
+			0,        // index is colorspace
+			-1,       // fw index
+			true,     // index is for the forward direction
+			/* overriding: */ offRate,
 			0, // amount to add to index offrate or <= 0 to do nothing
-		    useMm,    // whether to use memory-mapped files
-		    useShmem, // whether to use shared memory
-		    mmSweep,  // sweep memory-mapped files
-		    !noRefNames, // load names?
+			useMm,    // whether to use memory-mapped files
+			useShmem, // whether to use shared memory
+			mmSweep,  // sweep memory-mapped files
+			!noRefNames, // load names?
 			true,        // load SA sample?
 			true,        // load ftab?
 			true,        // load rstarts?
-		    gVerbose,    // whether to be talkative
-		    startVerbose, // talkative during initialization
-		    false /*passMemExc*/,
-		    sanityCheck);
+			gVerbose, // whether to be talkative
+			startVerbose, // talkative during initialization
+			false /*passMemExc*/,
+			sanityCheck));
+		hotSeeds.push_back(NULL);
+		if(useHotSeeds) {
+			// Precomputed offsets for the index's most frequent seeds
+			HotSeeds *hot = new HotSeeds();
+			if(hot->load(idxBases[i] + ".hot." + gEbwt_ext, idxBases[i],
+			             ebwtFws.back()->eh().len(), useMm, gVerbose || startVerbose))
+			{
+				ebwtFws.back()->setHotSeeds(hot);
+				hotSeeds.back() = hot;
+			} else {
+				delete hot;
+			}
+		}
+		ebwtBws.push_back(NULL);
+		// We need the mirror index if mismatches are allowed
+		if(multiseedMms > 0 || do1mmUpFront) {
+			if(gVerbose || startVerbose) {
+				cerr << "About to initialize rev Ebwt: "; logTime(cerr, true);
+			}
+			ebwtBws.back() = new Ebwt(
+				idxBases[i] + ".rev",
+				0,       // index is colorspace
+				1,       // TODO: maybe not
+				false, // index is for the reverse direction
+				/* overriding: */ offRate,
+				0, // amount to add to index offrate or <= 0 to do nothing
+				useMm,    // whether to use memory-mapped files
+				useShmem, // whether to use shared memory
+				mmSweep,  // sweep memory-mapped files
+				!noRefNames, // load names?
+				true,        // load SA sample?
+				true,        // load ftab?
+				true,        // load rstarts?
+				gVerbose,    // whether to be talkative
+				startVerbose, // talkative during initialization
+				false /*passMemExc*/,
+				sanityCheck);
+		}
+		// Second levels of the ftabs; each Ebwt's lookups use its own
+		ftab2s.push_back(NULL);
+		ftab2s.push_back(NULL);
+		if(useFtab2) {
+			for(int fw = 1; fw >= 0; fw--) {
+				Ebwt* e = fw ? ebwtFws.back() : ebwtBws.back();
+				if(e == NULL) continue;
+				Ftab2 *f2 = new Ftab2();
+				if(f2->load(idxBases[i] + (fw ? ".ftab2." : ".rev.ftab2.") + gEbwt_ext,
+				            fw ? idxBases[i] : (idxBases[i] + ".rev"),
+				            *e, useMm, gVerbose || startVerbose))
+				{
+					e->setFtab2(f2);
+					ftab2s[ftab2s.size() - (fw ? 2 : 1)] = f2;
+				} else {
+					delete f2;
+				}
+			}
+		}
 	}
-	if(sanityCheck && !os.empty()) {
+	Ebwt& ebwt = *ebwtFws[0];
+	if(sanityCheck && !os.empty() && idxBases.size() == 1) {
 		// Sanity check number of patterns and pattern lengths in Ebwt
 		// against original strings
 		assert_eq(os.size(), ebwt.nPat());
@@ -4386,7 +4760,7 @@ static void driver(
 		}
 	}
 	// Sanity-check the restored version of the Ebwt
-	if(sanityCheck && !os.empty()) {
+	if(sanityCheck && !os.empty() && idxBases.size() == 1) {
 		ebwt.loadIntoMemory(
 			0,
 			-1, // fw index
@@ -4400,10 +4774,14 @@ static void driver(
 	}
 	OutputQueue oq(
 		*fout,                   // out file buffer
-		reorder && nthreads > 1, // whether to reorder when there's >1 thread
+		// whether to reorder; needed when there's >1 thread, or when reads
+		// are sorted and we must put them back in input order
+		(reorder && nthreads > 1) || (sortWindow > 0 && nthreads == 1),
 		nthreads,                // # threads
-		nthreads > 1,            // whether to be thread-safe
-		skipReads);              // first read will have this rdid
+		// whether to be thread-safe; the --max-latency flusher is a thread
+		nthreads > 1 || maxLatencyMs > 0,
+		skipReads,               // first read will have this rdid
+		maxLatencyMs > 0);       // whether to track per-read latencies
 	{
 		Timer _t(cerr, "Time searching: ", timing);
 		// Set up penalities
@@ -4426,12 +4804,19 @@ static void driver(
 			penRdGapLinear, // linear coeff for read gap cost
 			penRfGapLinear, // linear coeff for ref gap cost
 			gGapBarrier);   // # rows at top/bot only entered diagonally
+		// References of all indexes in the set, in order
 		EList<size_t> reflens;
-		for(size_t i = 0; i < ebwt.nPat(); i++) {
-			reflens.push_back(ebwt.plen()[i]);
+		EList<string> refnames, idxnames;
+		for(size_t i = 0; i < ebwtFws.size(); i++) {
+			for(size_t j = 0; j < ebwtFws[i]->nPat(); j++) {
+				reflens.push_back(ebwtFws[i]->plen()[j]);
+			}
+			idxnames.clear();
+			readEbwtRefnames(idxBases[i], idxnames);
+			for(size_t j = 0; j < idxnames.size(); j++) {
+				refnames.push_back(idxnames[j]);
+			}
 		}
-		EList<string> refnames;
-		readEbwtRefnames(adjIdxBase, refnames);
 		SamConfig samc(
 			refnames,               // reference sequence names
 			reflens,                // reference sequence lengths
@@ -4512,6 +4897,13 @@ static void driver(
 		if(!metricsFile.empty() && metricsIval > 0) {
 			metricsOfb = new OutFileBuf(metricsFile);
 		}
+		// With --max-latency, push out the header now and then everything
+		// finished every maxLatencyMs while searching
+		auto_ptr<OutputFlusher> flusher;
+		if(maxLatencyMs > 0) {
+			fout->flushAll();
+			flusher.reset(new OutputFlusher(oq, maxLatencyMs));
+		}
 		// Do the search for all input reads
 		assert(patsrc != NULL);
 		assert(mssink != NULL);
@@ -4519,15 +4911,26 @@ static void driver(
 			sc,      // scoring scheme
 			*patsrc, // pattern source
 			*mssink, // hit sink
-			ebwt,    // BWT
-			*ebwtBw, // BWT'
+			idxBases, // index basenames
+			ebwtFws, // BWTs
+			ebwtBws, // BWT's
 			metricsOfb);
-		// Evict any loaded indexes from memory
-		if(ebwt.isInMemory()) {
-			ebwt.evictFromMemory();
+		flusher.reset();
+		if(maxLatencyMs > 0) {
+			oq.flushAll();
 		}
-		if(ebwtBw != NULL) {
-			delete ebwtBw;
+		// Evict any loaded indexes from memory
+		for(size_t i = 0; i < ebwtFws.size(); i++) {
+			if(ebwtFws[i]->isInMemory()) {
+				ebwtFws[i]->evictFromMemory();
+			}
+			delete ebwtFws[i];
+			if(ebwtBws[i] != NULL) {
+				delete ebwtBws[i];
+			}
+			delete hotSeeds[i];
+			delete ftab2s[2*i];
+			delete ftab2s[2*i+1];
 		}
 		if(!gQuiet && !seedSumm) {
 			size_t repThresh = mhits;
@@ -4543,6 +4946,9 @@ static void driver(
 		oq.flush(true);
 		assert_eq(oq.numStarted(), oq.numFinished());
 		assert_eq(oq.numStarted(), oq.numFlushed());
+		if(maxLatencyMs > 0 && !gQuiet) {
+			printLatencies(oq.latencies());
+		}
 		delete patsrc;
 		delete mssink;
 		delete metricsOfb;
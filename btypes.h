@@ -26,6 +26,9 @@
 #define OFF_LEN_MASK 0xc000000000000000
 #define LS_SIZE 0x100000000000000
 #define OFF_SIZE 8
+// SA samples are held in memory in this many bytes each when every offset
+// fits; see Ebwt::offsAt()
+#define OFFS_PACKED_BYTES 5
 
 typedef uint64_t TIndexOffU;
 typedef int64_t TIndexOff;
@@ -35,6 +38,8 @@ typedef int64_t TIndexOff;
 #define OFF_LEN_MASK 0xc0000000
 #define LS_SIZE 0x10000000
 #define OFF_SIZE 4
+// SA samples are never packed in small-index mode
+#define OFFS_PACKED_BYTES OFF_SIZE
 
 typedef uint32_t TIndexOffU;
 typedef int TIndexOff;
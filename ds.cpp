@@ -21,6 +21,8 @@
 
 MemoryTally gMemTally;
 
+DS_THREAD_LOCAL EArena *EArena::threadArena_ = NULL;
+
 /**
  * Tally a memory allocation of size amt bytes.
  */
@@ -54,6 +56,27 @@ void MemoryTally::del(int cat, uint64_t amt) {
 
 using namespace std;
 
+/**
+ * Hashable wrapper for uint64_t, for testing EHashSet.
+ */
+struct U64 {
+	U64(uint64_t v_ = 0) : v(v_) { }
+	bool operator==(const U64& o) const { return v == o.v; }
+	uint64_t hash() const { return v; }
+	uint64_t v;
+};
+
+/**
+ * Key plus original index, ordered by key only, for testing sort
+ * stability.
+ */
+struct U64Pair {
+	U64Pair(uint64_t k_ = 0, uint64_t i_ = 0) : k(k_), i(i_) { }
+	bool operator<(const U64Pair& o) const { return k < o.k; }
+	uint64_t k;
+	uint64_t i;
+};
+
 int main(void) {
 	cerr << "Test EHeap 1...";
 	{
@@ -150,6 +173,62 @@ int main(void) {
 		}
 	}
 	cerr << "PASSED" << endl;
+
+	cerr << "Test EHashSet 1...";
+	{
+		EHashSet<U64> h;
+		ESet<uint64_t> s;
+		RandomSource rnd(12);
+		for(size_t epoch = 0; epoch < 5; epoch++) {
+			h.clear();
+			s.clear();
+			assert(h.empty());
+			for(size_t i = 0; i < 3000; i++) {
+				uint64_t v = rnd.nextU32() % 5000;
+				bool hins = h.insert(U64(v));
+				bool sins = s.insert(v);
+				if(hins != sins) {
+					throw 1;
+				}
+			}
+			assert_eq(s.size(), h.size());
+			for(uint64_t v = 0; v < 5000; v++) {
+				if(h.contains(U64(v)) != s.contains(v)) {
+					throw 1;
+				}
+			}
+		}
+	}
+	cerr << "PASSED" << endl;
+
+	cerr << "Test EList sort with EArena 1...";
+	{
+		// Sort (key, original index) pairs by key only and check that the
+		// result is sorted and stable, with and without a scratch arena
+		EArena arena(256);
+		RandomSource rnd(77);
+		for(int pass = 0; pass < 2; pass++) {
+			EArena::setThreadArena(pass == 0 ? NULL : &arena);
+			for(size_t n = 0; n < 300; n += 7) {
+				arena.reset();
+				EList<U64Pair> l;
+				for(size_t i = 0; i < n; i++) {
+					l.push_back(U64Pair(rnd.nextU32() % 20, i));
+				}
+				l.sort();
+				for(size_t i = 1; i < l.size(); i++) {
+					if(l[i].k < l[i-1].k) {
+						throw 1;
+					}
+					if(l[i].k == l[i-1].k && l[i].i < l[i-1].i) {
+						throw 1;
+					}
+				}
+			}
+		}
+		EArena::setThreadArena(NULL);
+	}
+	cerr << "PASSED" << endl;
 }
 
 #endif /*def MAIN_SSTRING*/
@@ -26,6 +26,10 @@
 #include <stdint.h>
 #include <string.h>
 #include <limits>
+#include <new>
+#if __cplusplus >= 201103L
+#include <type_traits>
+#endif
 #include "assert_helpers.h"
 #include "threading.h"
 #include "random_source.h"
@@ -101,6 +105,260 @@ protected:
 
 extern MemoryTally gMemTally;
 
+/**
+ * IsTriviallyCopyable<T>::value is true iff T can be copied with memcpy
+ * rather than element-by-element with operator=.
+ */
+template<typename T>
+struct IsTriviallyCopyable {
+#if __cplusplus >= 201103L
+	enum { value = std::is_trivially_copyable<T>::value };
+#else
+	enum { value = __has_trivial_copy(T) && __has_trivial_assign(T) };
+#endif
+};
+
+/**
+ * Copy n elements from src to dst, which must not overlap.  Uses memcpy
+ * when T is trivially copyable, operator= otherwise.
+ */
+template<typename T>
+inline void copyElts(T* dst, const T* src, size_t n) {
+	if(IsTriviallyCopyable<T>::value) {
+		if(n > 0) memcpy((void*)dst, (const void*)src, n * sizeof(T));
+	} else {
+		for(size_t i = 0; i < n; i++) {
+			// Note: operator= is used
+			dst[i] = src[i];
+		}
+	}
+}
+
+/**
+ * HasXfer<T>::value is true iff T has an xfer(T&) member that takes over
+ * another T's contents, leaving it empty.  Specialize it for element
+ * types that own heap buffers so that EList can move them rather than
+ * copy them with operator= when it expands.
+ */
+template<typename T>
+struct HasXfer {
+	enum { value = false };
+};
+
+/**
+ * Move n elements from src to dst, which must not overlap.  Uses xfer()
+ * when T has one, copyElts() otherwise.  Elements of src are left in an
+ * unspecified but destructible state.
+ */
+template<typename T, bool X = HasXfer<T>::value>
+struct MoveElts {
+	static void move(T* dst, T* src, size_t n) {
+		copyElts(dst, src, n);
+	}
+};
+
+template<typename T>
+struct MoveElts<T, true> {
+	static void move(T* dst, T* src, size_t n) {
+		for(size_t i = 0; i < n; i++) {
+			dst[i].xfer(src[i]);
+		}
+	}
+};
+
+#if __cplusplus >= 201103L
+# define DS_THREAD_LOCAL thread_local
+#elif defined(_MSC_VER)
+# define DS_THREAD_LOCAL __declspec(thread)
+#else
+# define DS_THREAD_LOCAL __thread
+#endif
+
+/**
+ * A bump allocator for short-lived scratch memory.  Allocations are
+ * carved out of a list of chunks and are never freed individually;
+ * instead, the caller either rewinds to a mark() taken earlier or calls
+ * reset() at a natural boundary (e.g. between reads).  If a round of
+ * allocations spilled into more than one chunk, reset() replaces them
+ * with a single chunk big enough for all of them, so that once the
+ * arena has seen its high water mark no further heap calls are made.
+ *
+ * Each thread can install one arena with setThreadArena(); containers
+ * that need temporary buffers (e.g. EList::sort()) use it when present
+ * and fall back to the heap otherwise.
+ */
+class EArena {
+
+public:
+
+	/**
+	 * A position in the arena that can later be rewound to.
+	 */
+	struct Mark {
+		size_t chunk;
+		size_t off;
+	};
+
+	explicit EArena(size_t initsz = 64 * 1024, int cat = 0) :
+		cat_(cat),
+		initsz_(initsz),
+		nchunk_(0),
+		cur_(0),
+		off_(0)
+	{
+		assert_gt(initsz_, 0);
+	}
+
+	~EArena() { free(); }
+
+	/**
+	 * Return a pointer to a block of at least 'bytes' bytes, aligned to
+	 * a 16-byte boundary.  Valid until the next reset() or a rewind()
+	 * to a mark taken before the allocation.
+	 */
+	void* alloc(size_t bytes) {
+		bytes = (bytes + 15) & ~((size_t)15);
+		if(cur_ < nchunk_ && off_ + bytes <= szs_[cur_]) {
+			void *ret = chunks_[cur_] + off_;
+			off_ += bytes;
+			return ret;
+		}
+		return allocSlow(bytes);
+	}
+
+	/**
+	 * Allocate an uninitialized array of n Ts.  Only appropriate for
+	 * trivially copyable T.
+	 */
+	template<typename T>
+	T* allocArray(size_t n) {
+		return reinterpret_cast<T*>(alloc(n * sizeof(T)));
+	}
+
+	/**
+	 * Return the current position so that subsequent allocations can be
+	 * released with rewind().
+	 */
+	Mark mark() const {
+		Mark m;
+		m.chunk = cur_;
+		m.off = off_;
+		return m;
+	}
+
+	/**
+	 * Release everything allocated since mark m was taken.
+	 */
+	void rewind(const Mark& m) {
+		assert(m.chunk < cur_ || (m.chunk == cur_ && m.off <= off_));
+		cur_ = m.chunk;
+		off_ = m.off;
+	}
+
+	/**
+	 * Release all allocations.  If more than one chunk is in use,
+	 * coalesce them into one.
+	 */
+	void reset() {
+		if(nchunk_ > 1) {
+			size_t tot = 0;
+			for(size_t i = 0; i < nchunk_; i++) {
+				tot += szs_[i];
+			}
+			free();
+			addChunk(tot);
+		}
+		cur_ = 0;
+		off_ = 0;
+	}
+
+	/**
+	 * Return total number of bytes held by the arena.
+	 */
+	size_t capacity() const {
+		size_t tot = 0;
+		for(size_t i = 0; i < nchunk_; i++) {
+			tot += szs_[i];
+		}
+		return tot;
+	}
+
+	/**
+	 * Install the given arena as the calling thread's scratch arena.
+	 * Pass NULL to uninstall.
+	 */
+	static void setThreadArena(EArena *a) { threadArena_ = a; }
+
+	/**
+	 * Return the calling thread's scratch arena, or NULL if none is
+	 * installed.
+	 */
+	static EArena* threadArena() { return threadArena_; }
+
+protected:
+
+	/**
+	 * Move on to the first later chunk that can satisfy the request,
+	 * adding a new chunk if there isn't one.
+	 */
+	void* allocSlow(size_t bytes) {
+		for(size_t i = cur_ + 1; i < nchunk_; i++) {
+			if(bytes <= szs_[i]) {
+				cur_ = i;
+				off_ = bytes;
+				return chunks_[i];
+			}
+		}
+		size_t sz = (nchunk_ == 0 ? initsz_ : szs_[nchunk_-1] * 2);
+		while(sz < bytes) sz *= 2;
+		addChunk(sz);
+		cur_ = nchunk_ - 1;
+		off_ = bytes;
+		return chunks_[cur_];
+	}
+
+	/**
+	 * Append a new chunk of sz bytes.
+	 */
+	void addChunk(size_t sz) {
+		if(nchunk_ == MAX_CHUNKS) {
+			throw std::bad_alloc();
+		}
+		chunks_[nchunk_] = new char[sz];
+		szs_[nchunk_] = sz;
+		nchunk_++;
+		gMemTally.add(cat_, sz);
+	}
+
+	/**
+	 * Free all chunks.
+	 */
+	void free() {
+		for(size_t i = 0; i < nchunk_; i++) {
+			delete[] chunks_[i];
+			gMemTally.del(cat_, szs_[i]);
+		}
+		nchunk_ = cur_ = off_ = 0;
+	}
+
+	static const size_t MAX_CHUNKS = 48;
+
+	int    cat_;                 // memory category
+	size_t initsz_;              // size of first chunk
+	char  *chunks_[MAX_CHUNKS];  // chunk buffers
+	size_t szs_[MAX_CHUNKS];     // chunk sizes
+	size_t nchunk_;              // # chunks allocated
+	size_t cur_;                 // chunk currently being carved
+	size_t off_;                 // offset of next free byte in cur_ chunk
+
+	static DS_THREAD_LOCAL EArena *threadArena_;
+
+private:
+
+	EArena(const EArena&);
+	EArena& operator=(const EArena&);
+};
+
 /**
  * A simple fixed-length array of type T, automatically freed in the
  * destructor.
@@ -765,12 +1023,27 @@ public:
 	}
 	
 	/**
-	 * Sort some of the contents.
+	 * Sort some of the contents.  The sort is stable.  Short ranges are
+	 * insertion-sorted in place.  Longer ranges of trivially copyable
+	 * elements are merge-sorted using a buffer from the thread's scratch
+	 * arena, if one is installed, so that no heap allocation is needed.
 	 */
 	void sortPortion(size_t begin, size_t num) {
 		assert_leq(begin+num, cur_);
 		if(num < 2) return;
-		std::stable_sort(list_ + begin, list_ + begin + num);
+		T *b = list_ + begin;
+		if(num <= (size_t)SORT_RUN) {
+			insertionSort(b, num);
+			return;
+		}
+		EArena *arena = EArena::threadArena();
+		if(IsTriviallyCopyable<T>::value && arena != NULL) {
+			EArena::Mark m = arena->mark();
+			mergeSort(b, num, arena->allocArray<T>(num));
+			arena->rewind(m);
+		} else {
+			std::stable_sort(b, b + num);
+		}
 	}
 	
 	/**
@@ -930,8 +1203,9 @@ private:
 	}
 
 	/**
-	 * Expand the list_ buffer until it has exactly 'newsz' elements.  Copy
-	 * old contents into new buffer using operator=.
+	 * Expand the list_ buffer until it has exactly 'newsz' elements.  Move
+	 * old contents into new buffer using memcpy if T is trivially copyable,
+	 * xfer() if T has one (see HasXfer) or operator= otherwise.
 	 */
 	void expandCopyExact(size_t newsz) {
 		if(newsz <= sz_) return;
@@ -939,10 +1213,7 @@ private:
 		assert(tmp != NULL);
 		size_t cur = cur_;
 		if(list_ != NULL) {
- 			for(size_t i = 0; i < cur_; i++) {
-				// Note: operator= is used
-				tmp[i] = list_[i];
-			}
+			MoveElts<T>::move(tmp, list_, cur_);
 			free();
 		}
 		list_ = tmp;
@@ -978,6 +1249,55 @@ private:
 		assert_gt(sz_, 0);
 	}
 
+	/**
+	 * Stable in-place insertion sort of the n elements starting at b.
+	 */
+	static void insertionSort(T *b, size_t n) {
+		for(size_t i = 1; i < n; i++) {
+			if(!(b[i] < b[i-1])) continue;
+			T tmp = b[i];
+			size_t j = i;
+			do {
+				b[j] = b[j-1];
+				j--;
+			} while(j > 0 && tmp < b[j-1]);
+			b[j] = tmp;
+		}
+	}
+
+	/**
+	 * Stable bottom-up merge sort of the n elements starting at b, using
+	 * buf (room for n elements) as scratch space.  T must be trivially
+	 * copyable.
+	 */
+	static void mergeSort(T *b, size_t n, T *buf) {
+		for(size_t i = 0; i < n; i += SORT_RUN) {
+			insertionSort(b + i, std::min<size_t>((size_t)SORT_RUN, n - i));
+		}
+		T *src = b, *dst = buf;
+		for(size_t w = (size_t)SORT_RUN; w < n; w *= 2) {
+			for(size_t lo = 0; lo < n; lo += 2 * w) {
+				size_t mid = std::min(lo + w, n);
+				size_t hi  = std::min(lo + 2 * w, n);
+				size_t i = lo, j = mid, k = lo;
+				while(i < mid && j < hi) {
+					// Take from the left run on ties to keep it stable
+					if(src[j] < src[i]) dst[k++] = src[j++];
+					else                dst[k++] = src[i++];
+				}
+				copyElts(dst + k, src + i, mid - i); k += mid - i;
+				copyElts(dst + k, src + j, hi - j);
+			}
+			std::swap(src, dst);
+		}
+		if(src != b) {
+			copyElts(b, src, n);
+		}
+	}
+
+	// Ranges up to this long are insertion-sorted
+	enum { SORT_RUN = 16 };
+
 	int cat_;      // memory category, for accounting purposes
 	int allocCat_; // category at time of allocation
 	T *list_;      // list pointer, returned from new[]
@@ -2001,9 +2321,7 @@ private:
 			newsz *= 2;
 		}
 		T* tmp = alloc(newsz);
-		for(size_t i = 0; i < cur_; i++) {
-			tmp[i] = list_[i];
-		}
+		copyElts(tmp, list_, cur_);
 		free();
 		list_ = tmp;
 		sz_ = newsz;
@@ -2015,6 +2333,159 @@ private:
 	size_t cur_; // occupancy (AKA size)
 };
 
+/**
+ * Expandable set using an open-addressed hash table with linear probing.
+ * T must supply operator== and a uint64_t hash() member.
+ *
+ * Clearing is O(1): each slot is tagged with the epoch in which it was
+ * filled, and clear() simply starts a new epoch.  This makes the set a good
+ * fit for per-read bookkeeping that is cleared far more often than it is
+ * large.  Elements can be added but not removed.
+ */
+template <typename T>
+class EHashSet {
+public:
+
+	explicit EHashSet(int cat = 0) :
+		cat_(cat),
+		keys_(NULL),
+		epochs_(NULL),
+		sz_(0),
+		cur_(0),
+		epoch_(1)
+	{ }
+
+	/**
+	 * Destructor.
+	 */
+	~EHashSet() { free(); }
+
+	/**
+	 * Return number of elements.
+	 */
+	size_t size() const { return cur_; }
+
+	/**
+	 * Return true iff there are no elements.
+	 */
+	bool empty() const { return cur_ == 0; }
+
+	/**
+	 * Insert a new element into the set.  Return false iff it was already
+	 * present.
+	 */
+	bool insert(const T& el) {
+		if((cur_ + 1) * 2 > sz_) {
+			expandCopy(sz_ == 0 ? 64 : sz_ * 2);
+		}
+		size_t i = probe(el);
+		if(epochs_[i] == epoch_) {
+			return false;
+		}
+		keys_[i] = el;
+		epochs_[i] = epoch_;
+		cur_++;
+		return true;
+	}
+
+	/**
+	 * Return true iff this set contains 'el'.
+	 */
+	bool contains(const T& el) const {
+		if(cur_ == 0) {
+			return false;
+		}
+		return epochs_[probe(el)] == epoch_;
+	}
+
+	/**
+	 * Empty the set without deallocating or touching the table.
+	 */
+	void clear() {
+		cur_ = 0;
+		if(++epoch_ == 0) {
+			// Epoch counter wrapped; really clear the tags this once
+			if(epochs_ != NULL) {
+				memset(epochs_, 0, sz_ * sizeof(uint32_t));
+			}
+			epoch_ = 1;
+		}
+	}
+
+	/**
+	 * Return memory category.
+	 */
+	int cat() const { return cat_; }
+
+private:
+
+	// Not copyable
+	EHashSet(const EHashSet<T>& o);
+	EHashSet& operator=(const EHashSet<T>& o);
+
+	/**
+	 * Return the slot holding 'el' if it's in the current epoch, otherwise
+	 * the first slot not in the current epoch along its probe sequence.
+	 */
+	size_t probe(const T& el) const {
+		assert_gt(sz_, 0);
+		const size_t mask = sz_ - 1;
+		size_t i = (size_t)((el.hash() * 0x9E3779B97F4A7C15llu) >> 32) & mask;
+		while(epochs_[i] == epoch_ && !(keys_[i] == el)) {
+			i = (i + 1) & mask;
+		}
+		return i;
+	}
+
+	/**
+	 * Grow the table to 'newsz' slots (a power of 2) and re-insert every
+	 * element from the current epoch.
+	 */
+	void expandCopy(size_t newsz) {
+		assert_eq(0, newsz & (newsz - 1));
+		T *okeys = keys_;
+		uint32_t *oepochs = epochs_;
+		size_t osz = sz_;
+		keys_ = new T[newsz];
+		epochs_ = new uint32_t[newsz];
+		memset(epochs_, 0, newsz * sizeof(uint32_t));
+		gMemTally.add(cat_, newsz * (sizeof(T) + sizeof(uint32_t)));
+		sz_ = newsz;
+		for(size_t i = 0; i < osz; i++) {
+			if(oepochs[i] == epoch_) {
+				size_t j = probe(okeys[i]);
+				keys_[j] = okeys[i];
+				epochs_[j] = epoch_;
+			}
+		}
+		if(okeys != NULL) {
+			delete[] okeys;
+			delete[] oepochs;
+			gMemTally.del(cat_, osz * (sizeof(T) + sizeof(uint32_t)));
+		}
+	}
+
+	/**
+	 * Free the table and tally the release.
+	 */
+	void free() {
+		if(keys_ != NULL) {
+			delete[] keys_;
+			delete[] epochs_;
+			gMemTally.del(cat_, sz_ * (sizeof(T) + sizeof(uint32_t)));
+			keys_ = NULL;
+			epochs_ = NULL;
+		}
+	}
+
+	int       cat_;    // memory category, for accounting purposes
+	T        *keys_;   // slots
+	uint32_t *epochs_; // epoch in which each slot was filled
+	size_t    sz_;     // # slots; always a power of 2
+	size_t    cur_;    // # elements in current epoch
+	uint32_t  epoch_;  // current epoch; never 0
+};
+
 template <typename T, int S = 128>
 class ELSet {
 
@@ -2657,9 +3128,7 @@ private:
 		size_t newsz = sz_ * 2;
 		while(newsz < thresh) newsz *= 2;
 		std::pair<K, V>* tmp = alloc(newsz);
-		for(size_t i = 0; i < cur_; i++) {
-			tmp[i] = list_[i];
-		}
+		copyElts(tmp, list_, cur_);
 		free();
 		list_ = tmp;
 		sz_ = newsz;
@@ -26,6 +26,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
 #include <stdexcept>
 #include "assert_helpers.h"
 
@@ -154,6 +156,16 @@ public:
 		_done = false;
 	}
 
+	/**
+	 * If partial is true, refill the buffer with whatever input is
+	 * available (as long as there is some) rather than waiting for a full
+	 * buffer's worth.  Matters for pipes and terminals, where input may
+	 * trickle in.  Only applies to C-style files.
+	 */
+	void setPartial(bool partial) {
+		_partial = partial;
+	}
+
 	/**
 	 * Restore state as though we just started reading the input
 	 * stream.
@@ -195,6 +207,9 @@ public:
 				} else if(_ins != NULL) {
 					_ins->read((char*)_buf, BUF_SZ);
 					_buf_sz = _ins->gcount();
+				} else if(_partial) {
+					assert(_in != NULL);
+					_buf_sz = readSome();
 				} else {
 					assert(_in != NULL);
 					_buf_sz = fread(_buf, 1, BUF_SZ, _in);
@@ -205,7 +220,7 @@ public:
 					// caller
 					_done = true;
 					return -1;
-				} else if(_buf_sz < BUF_SZ) {
+				} else if(_buf_sz < BUF_SZ && !_partial) {
 					// Exhausted
 					_done = true;
 				}
@@ -434,10 +449,27 @@ private:
 		_ins = NULL;
 		_cur = _buf_sz = BUF_SZ;
 		_done = false;
+		_partial = false;
 		_lastn_cur = 0;
 		// no need to clear _buf[]
 	}
 
+	/**
+	 * Read whatever is available from _in, up to a buffer's worth, waiting
+	 * only if nothing is.  Returns 0 only at end of input.
+	 */
+	size_t readSome() {
+		ssize_t r;
+		do {
+			r = ::read(fileno(_in), _buf, BUF_SZ);
+		} while(r < 0 && errno == EINTR);
+		if(r < 0) {
+			std::cerr << "Error: could not read input: " << strerror(errno) << std::endl;
+			throw 1;
+		}
+		return (size_t)r;
+	}
+
 	static const size_t BUF_SZ = 256 * 1024;
 	FILE     *_in;
 	std::ifstream *_inf;
@@ -445,6 +477,7 @@ private:
 	size_t    _cur;
 	size_t    _buf_sz;
 	bool      _done;
+	bool      _partial;     // refill with whatever input is available
 	uint8_t   _buf[BUF_SZ]; // (large) input buffer
 	size_t    _lastn_cur;
 	char      _lastn_buf[LASTN_BUF_SZ]; // buffer of the last N chars dispensed
@@ -690,6 +723,18 @@ public:
 		cur_ = 0;
 	}
 
+	/**
+	 * Hand everything written so far to the OS, including anything
+	 * buffered by the C library, so that readers of the output see it.
+	 */
+	void flushAll() {
+		if(cur_ > 0) flush();
+		if(fflush(out_) != 0) {
+			std::cerr << "Error while flushing output" << std::endl;
+			throw 1;
+		}
+	}
+
 	/**
 	 * Return true iff this stream is closed.
 	 */
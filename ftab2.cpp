@@ -0,0 +1,274 @@
+/*
+ * Copyright 2011, Ben Langmead <langmea@cs.jhu.edu>
+ *
+ * This file is part of Bowtie 2.
+ *
+ * Bowtie 2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bowtie 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bowtie 2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <stdio.h>
+#include <sys/stat.h>
+#ifdef BOWTIE_MM
+#include <sys/mman.h>
+#endif
+#include "ftab2.h"
+#include "ds.h"
+#include "mem_ids.h"
+#include "timer.h"
+#include "word_io.h"
+
+using namespace std;
+
+const uint32_t Ftab2::NO_SUB;
+
+/**
+ * A partial split of an ftab bucket visited by Ftab2::build().
+ */
+struct Ftab2Node {
+	TIndexOffU ptop;  // top of range in the partner index
+	TIndexOffU pbot;  // bot of range in the partner index
+	uint32_t   rel;   // top of range in the index, relative to bucket top
+	int        depth; // # chars past the ftab
+};
+
+/**
+ * Split every ftab bucket of 'ebwt' with at least 'minRows' rows by the
+ * next 'subChars' characters, using the partner index 'partner' (the
+ * mirror index if 'ebwt' is the forward index, and vice versa), and
+ * write the table, tagged with the fingerprint 'fp' of 'ebwt', to
+ * 'fname'.  Both indexes' ftabs must be in memory.  Returns the number
+ * of buckets split.
+ *
+ * Extending a string by a character in the partner index gives the size
+ * of the range for each possible next character; in 'ebwt', the ranges
+ * for the four characters are laid out one after the other in character
+ * order, as in Ebwt::mapBiLFEx().  Buckets holding a suffix too short to
+ * extend (at the end of the text) are left unsplit.
+ */
+size_t Ftab2::build(
+	const Ebwt& ebwt,
+	const Ebwt& partner,
+	int subChars,
+	size_t minRows,
+	const string& fname,
+	uint64_t fp,
+	bool verbose)
+{
+	assert_gt(subChars, 0);
+	assert_eq(ebwt.eh().ftabChars(), partner.eh().ftabChars());
+	Timer _t(cout, "  Time building second-level ftab: ", verbose);
+	const int fc = ebwt.eh().ftabChars();
+	const TIndexOffU nbuckets = ebwt.eh().ftabLen() - 1;
+	const size_t nleaf = (size_t)1 << (2 * subChars);
+	EList<uint32_t> idx(MISC_CAT);
+	EList<uint32_t> sub(MISC_CAT);
+	EList<uint32_t> leaves(MISC_CAT);
+	EList<Ftab2Node> stack(MISC_CAT);
+	idx.resizeExact(nbuckets);
+	idx.fill(NO_SUB);
+	leaves.resizeExact(nleaf);
+	size_t nsub = 0;
+	for(TIndexOffU fi = 0; fi < nbuckets; fi++) {
+		TIndexOffU top = ebwt.ftabHi(fi);
+		TIndexOffU bot = ebwt.ftabLo(fi+1);
+		if(bot - top < minRows || (uint64_t)(bot - top) >= (uint64_t)NO_SUB) {
+			continue;
+		}
+		// The partner's ftab consumes the same characters in the opposite
+		// order
+		TIndexOffU pfi = 0;
+		for(int i = 0; i < fc; i++) {
+			pfi = (pfi << 2) | ((fi >> (2 * i)) & 3);
+		}
+		stack.clear();
+		stack.expand();
+		stack.back().ptop = partner.ftabHi(pfi);
+		stack.back().pbot = partner.ftabLo(pfi+1);
+		stack.back().rel = 0;
+		stack.back().depth = 0;
+		assert_eq(bot - top, stack.back().pbot - stack.back().ptop);
+		size_t nl = 0;
+		TIndexOffU tot = 0;
+		while(!stack.empty()) {
+			Ftab2Node n = stack.back();
+			stack.pop_back();
+			if(n.depth == subChars) {
+				assert_lt(nl, nleaf);
+				leaves[nl++] = n.rel;
+				tot += (n.pbot - n.ptop);
+				continue;
+			}
+			TIndexOffU tops[4] = {0, 0, 0, 0}, bots[4] = {0, 0, 0, 0};
+			if(n.pbot > n.ptop) {
+				partner.mapLFEx(n.ptop, n.pbot, tops, bots);
+			}
+			uint32_t rels[4];
+			uint32_t rel = n.rel;
+			for(int c = 0; c < 4; c++) {
+				rels[c] = rel;
+				rel += (uint32_t)(bots[c] - tops[c]);
+			}
+			// Push in reverse so that leaves come out in character order
+			for(int c = 3; c >= 0; c--) {
+				stack.expand();
+				stack.back().ptop = tops[c];
+				stack.back().pbot = bots[c];
+				stack.back().rel = rels[c];
+				stack.back().depth = n.depth + 1;
+			}
+		}
+		assert_eq(nleaf, nl);
+		if(tot != bot - top) {
+			continue;
+		}
+		idx[fi] = (uint32_t)nsub++;
+		for(size_t i = 0; i < nleaf; i++) {
+			sub.push_back(leaves[i]);
+		}
+	}
+	if(verbose) {
+		cout << "  Split " << nsub << " of " << nbuckets << " ftab buckets by "
+		     << subChars << " more chars" << endl;
+	}
+	ofstream out(fname.c_str(), ios::binary);
+	if(!out.good()) {
+		cerr << "Could not open second-level ftab file \"" << fname.c_str()
+		     << "\" for writing." << endl;
+		throw 1;
+	}
+	writeU<uint32_t>(out, 1);
+	writeU<uint32_t>(out, (uint32_t)fc);
+	writeU<uint32_t>(out, (uint32_t)subChars);
+	writeU<uint32_t>(out, (uint32_t)nsub);
+	writeU<uint64_t>(out, fp);
+	writeU<TIndexOffU>(out, ebwt.eh().len());
+	out.write((const char*)idx.ptr(), idx.size() * sizeof(uint32_t));
+	out.write((const char*)sub.ptr(), sub.size() * sizeof(uint32_t));
+	out.close();
+	if(out.fail()) {
+		cerr << "Error writing second-level ftab file \"" << fname.c_str() << "\"." << endl;
+		throw 1;
+	}
+	return nsub;
+}
+
+/**
+ * Read or memory-map the table in 'fname'.  Returns false, leaving the
+ * table empty, if there's no such file or it wasn't built from 'ebwt',
+ * whose basename is 'idxBase' (a warning is printed in that case).
+ */
+bool Ftab2::load(
+	const string& fname,
+	const string& idxBase,
+	const Ebwt& ebwt,
+	bool useMm,
+	bool verbose)
+{
+	unload();
+	FILE *f = fopen(fname.c_str(), "rb");
+	if(f == NULL) return false;
+	struct stat sbuf;
+	if(fstat(fileno(f), &sbuf) == -1) {
+		fclose(f);
+		return false;
+	}
+	size_t sz = (size_t)sbuf.st_size;
+	const size_t hdrSz = 4 * sizeof(uint32_t) + sizeof(uint64_t) + sizeof(TIndexOffU);
+	if(sz < hdrSz) {
+		fclose(f);
+		cerr << "Warning: ignoring truncated second-level ftab file \"" << fname.c_str() << "\"" << endl;
+		return false;
+	}
+#ifdef BOWTIE_MM
+	if(useMm) {
+		void *p = mmap((void *)0, sz, PROT_READ, MAP_SHARED, fileno(f), 0);
+		if(p == (void *)(-1)) {
+			perror("mmap");
+			cerr << "Error: Could not memory-map the second-level ftab file " << fname.c_str() << endl;
+			fclose(f);
+			throw 1;
+		}
+		buf_ = (char*)p;
+		mmapped_ = true;
+	} else
+#endif
+	{
+		buf_ = new char[sz];
+		if(fread(buf_, 1, sz, f) != sz) {
+			delete[] buf_;
+			buf_ = NULL;
+			fclose(f);
+			cerr << "Error: Could not read the second-level ftab file " << fname.c_str() << endl;
+			throw 1;
+		}
+	}
+	fclose(f);
+	bufSz_ = sz;
+	const uint32_t *h = (const uint32_t*)buf_;
+	uint64_t fp = *(const uint64_t*)(buf_ + 4 * sizeof(uint32_t));
+	TIndexOffU bwtLen = *(const TIndexOffU*)(buf_ + 4 * sizeof(uint32_t) + sizeof(uint64_t));
+	size_t nbuckets = (size_t)ebwt.eh().ftabLen() - 1;
+	const char *problem = NULL;
+	if(h[0] != 1) {
+		problem = "it was built on a machine with different endianness";
+	} else if((int)h[1] != ebwt.eh().ftabChars() || bwtLen != ebwt.eh().len() ||
+	          fp != Ebwt::fingerprint(idxBase))
+	{
+		problem = "it doesn't match the index; rebuild it with bowtie2-build --ftab2-chars";
+	} else if(h[2] < 1 || h[2] > 8 ||
+	          hdrSz + (nbuckets + ((size_t)h[3] << (2 * h[2]))) * sizeof(uint32_t) != sz)
+	{
+		problem = "it is truncated";
+	}
+	if(problem != NULL) {
+		cerr << "Warning: ignoring second-level ftab file \"" << fname.c_str() << "\" because "
+		     << problem << endl;
+		unload();
+		return false;
+	}
+	ftabChars_ = (int)h[1];
+	subChars_ = (int)h[2];
+	nsub_ = h[3];
+	idx_ = (const uint32_t*)(buf_ + hdrSz);
+	sub_ = idx_ + nbuckets;
+	if(verbose) {
+		cerr << "Loaded second-level ftab splitting " << nsub_ << " buckets by "
+		     << subChars_ << " chars from \"" << fname.c_str() << "\"" << endl;
+	}
+	return true;
+}
+
+/**
+ * Free or unmap the table.
+ */
+void Ftab2::unload() {
+	if(buf_ != NULL) {
+#ifdef BOWTIE_MM
+		if(mmapped_) {
+			munmap(buf_, bufSz_);
+		} else
+#endif
+		{
+			delete[] buf_;
+		}
+	}
+	buf_ = NULL;
+	bufSz_ = 0;
+	mmapped_ = false;
+	idx_ = sub_ = NULL;
+	ftabChars_ = subChars_ = 0;
+	nsub_ = 0;
+}
@@ -0,0 +1,174 @@
+/*
+ * Copyright 2011, Ben Langmead <langmea@cs.jhu.edu>
+ *
+ * This file is part of Bowtie 2.
+ *
+ * Bowtie 2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bowtie 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bowtie 2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * ftab2.h
+ *
+ * A sparse second level for an index's ftab.  The ftab maps each
+ * ftabChars-mer to its BW range.  For ftab buckets holding many rows, the
+ * second level splits the bucket by the next 'subChars' characters (in the
+ * order the ftab consumes them), so that a lookup can consume ftabChars +
+ * subChars characters at once instead of taking subChars more LF steps.
+ * Buckets too small to be worth splitting have no second level, and
+ * lookups in them fall back to the plain ftab.  A flat ftab over
+ * ftabChars + subChars characters would need 4^subChars times the space.
+ *
+ * Each split bucket has 4^subChars 32-bit entries giving the start of each
+ * sub-range relative to the bucket's top.  The sub-ranges are computed
+ * with the partner index (mirror for forward and vice versa) the same way
+ * bidirectional search does, by extending the bucket's string with
+ * mapBiLFEx-style counts.
+ *
+ * The table is written by bowtie2-build --ftab2-chars to NAME.ftab2.bt2
+ * (forward index) and NAME.rev.ftab2.bt2 (mirror index) and loaded by
+ * bowtie2-align if present.  Its layout, in native endianness, is:
+ *
+ *   uint32_t   1 (endianness check)
+ *   uint32_t   ftabChars
+ *   uint32_t   subChars
+ *   uint32_t   # split buckets
+ *   uint64_t   Ebwt::fingerprint() of the index the table was built from
+ *   TIndexOffU length of the BWT the table was built from
+ *   uint32_t   4^ftabChars x index of bucket's sub-table, or 0xffffffff
+ *   uint32_t   # split buckets x 4^subChars sub-range starts
+ */
+
+#ifndef FTAB2_H_
+#define FTAB2_H_
+
+#include <stdint.h>
+#include <string>
+#include "assert_helpers.h"
+#include "btypes.h"
+#include "bt2_idx.h"
+
+class Ftab2 {
+
+public:
+
+	Ftab2() :
+		idx_(NULL),
+		sub_(NULL),
+		ftabChars_(0),
+		subChars_(0),
+		nsub_(0),
+		buf_(NULL),
+		bufSz_(0),
+		mmapped_(false)
+	{ }
+
+	~Ftab2() { unload(); }
+
+	/**
+	 * Split every ftab bucket of 'ebwt' with at least 'minRows' rows by the
+	 * next 'subChars' characters, using the partner index 'partner' (the
+	 * mirror index if 'ebwt' is the forward index, and vice versa), and
+	 * write the table, tagged with the fingerprint 'fp' of 'ebwt', to
+	 * 'fname'.  Both indexes' ftabs must be in memory.  Returns the number
+	 * of buckets split.
+	 */
+	static size_t build(
+		const Ebwt& ebwt,
+		const Ebwt& partner,
+		int subChars,
+		size_t minRows,
+		const std::string& fname,
+		uint64_t fp,
+		bool verbose);
+
+	/**
+	 * Read or memory-map the table in 'fname'.  Returns false, leaving
+	 * the table empty, if there's no such file or it wasn't built from
+	 * 'ebwt', whose basename is 'idxBase'.
+	 */
+	bool load(
+		const std::string& fname,
+		const std::string& idxBase,
+		const Ebwt& ebwt,
+		bool useMm,
+		bool verbose);
+
+	/**
+	 * Free or unmap the table.
+	 */
+	void unload();
+
+	/**
+	 * Return the number of characters a successful loHi() consumes.
+	 */
+	int chars() const { return ftabChars_ + subChars_; }
+
+	/**
+	 * Like Ebwt::ftabLoHi(seq, off, false, top, bot), but for the chars()
+	 * characters starting at 'off'.  Returns false if the ftab bucket they
+	 * fall in has no second level or they include an N; the caller should
+	 * then use the plain ftab.
+	 */
+	bool loHi(
+		const Ebwt& ebwt,
+		const BTDnaString& seq,
+		size_t off,
+		TIndexOffU& top,
+		TIndexOffU& bot) const
+	{
+		assert_eq(ftabChars_, ebwt.eh().ftabChars());
+		const size_t nc = (size_t)chars();
+		assert_leq(off + nc, seq.length());
+		// Compile the characters in the order the ftab consumes them
+		uint64_t key = 0;
+		for(size_t i = 0; i < nc; i++) {
+			int c = (ebwt.fw() ? seq[off + i] : seq[off + nc - i - 1]);
+			if(c > 3) return false;
+			key = (key << 2) | (uint64_t)c;
+		}
+		TIndexOffU fi = (TIndexOffU)(key >> (2 * subChars_));
+		uint32_t si = (uint32_t)(key & ((1 << (2 * subChars_)) - 1));
+		uint32_t t = idx_[fi];
+		if(t == NO_SUB) return false;
+		const uint32_t* sub = sub_ + (size_t)t * ((size_t)1 << (2 * subChars_));
+		TIndexOffU btop = ebwt.ftabHi(fi);
+		top = btop + sub[si];
+		if(si + 1 < ((uint32_t)1 << (2 * subChars_))) {
+			bot = btop + sub[si+1];
+		} else {
+			bot = ebwt.ftabLo(fi+1);
+		}
+		assert_geq(bot, top);
+		return true;
+	}
+
+	bool   empty()     const { return nsub_ == 0; }
+	size_t numSplit()  const { return nsub_; }
+	int    subChars()  const { return subChars_; }
+
+	static const uint32_t NO_SUB = 0xffffffff;
+
+protected:
+
+	const uint32_t* idx_;       // sub-table index for each ftab bucket
+	const uint32_t* sub_;       // sub-tables
+	int             ftabChars_; // ftabChars of the index
+	int             subChars_;  // # extra chars consumed by second level
+	size_t          nsub_;      // # split buckets
+	char*           buf_;       // file contents
+	size_t          bufSz_;     // size of file contents
+	bool            mmapped_;   // buf_ is memory-mapped, not allocated
+};
+
+#endif /*FTAB2_H_*/
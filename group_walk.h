@@ -84,6 +84,7 @@
 #include <limits>
 #include "ds.h"
 #include "bt2_idx.h"
+#include "hot_seeds.h"
 #include "read.h"
 #include "reference.h"
 #include "mem_ids.h"
@@ -168,13 +169,14 @@ struct WalkMetrics {
 		resolves += m.resolves;
 		refresolves += m.refresolves;
 		reports += m.reports;
+		hotresolves += m.hotresolves;
 	}
 	
 	/**
 	 * Set all to 0.
 	 */
 	void reset() {
-		bwops = branches = resolves = refresolves = reports = 0;
+		bwops = branches = resolves = refresolves = reports = hotresolves = 0;
 	}
 
 	uint64_t bwops;       // Burrows-Wheeler operations
@@ -182,6 +184,7 @@ struct WalkMetrics {
 	uint64_t resolves;    // # offs resolved with BW walk-left
 	uint64_t refresolves; // # resolutions caused by reference scanning
 	uint64_t reports;     // # offs reported (1 can be reported many times)
+	uint64_t hotresolves; // # offs copied from the hot-seed table
 	MUTEX_T mutex_m;
 };
 
@@ -1100,6 +1103,12 @@ public:
 #ifndef NDEBUG
 		inited_ = true;
 #endif
+		// Copy offsets of frequent seeds from the hot-seed table, if any,
+		// so that the walk below only has to resolve the rest
+		const HotSeeds* hot = ebwtFw.hotSeeds();
+		if(hot != NULL) {
+			met.hotresolves += hot->resolve(sa.topf, sa.offs);
+		}
 		// Init GWHit
 		hit_.init(sa, 0, false, 0);
 		// Init corresponding GWState
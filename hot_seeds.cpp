@@ -0,0 +1,258 @@
+/*
+ * Copyright 2011, Ben Langmead <langmea@cs.jhu.edu>
+ *
+ * This file is part of Bowtie 2.
+ *
+ * Bowtie 2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bowtie 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bowtie 2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <stdio.h>
+#include <sys/stat.h>
+#ifdef BOWTIE_MM
+#include <sys/mman.h>
+#endif
+#include "hot_seeds.h"
+#include "bt2_idx.h"
+#include "ds.h"
+#include "mem_ids.h"
+#include "timer.h"
+#include "word_io.h"
+
+using namespace std;
+
+/**
+ * An SA range visited by the k-mer search in HotSeeds::build().
+ */
+struct HotNode {
+	TIndexOffU top;   // top of range
+	TIndexOffU bot;   // bot of range
+	size_t     depth; // length of the string the range is for
+};
+
+/**
+ * Order SA ranges by decreasing size.
+ */
+static bool hotLarger(
+	const pair<TIndexOffU, TIndexOffU>& a,
+	const pair<TIndexOffU, TIndexOffU>& b)
+{
+	return (a.second - a.first) > (b.second - b.first);
+}
+
+/**
+ * Find the SA ranges of all k-mers that occur at least 'minOcc' times
+ * in the forward index 'ebwt', keep the 'maxSeeds' largest, resolve
+ * the offsets of all their rows, and write the table, tagged with the
+ * index's fingerprint 'fp', to 'fname'.  The index's SA sample must be
+ * in memory.  Returns the number of ranges written.
+ *
+ * The ranges are found by extending strings one character to the left
+ * at a time, starting from the single characters, and dropping any
+ * whose range has fallen below 'minOcc' rows, since extending can only
+ * shrink it further.
+ */
+size_t HotSeeds::build(
+	const Ebwt& ebwt,
+	size_t seedLen,
+	size_t minOcc,
+	size_t maxSeeds,
+	const string& fname,
+	uint64_t fp,
+	bool verbose)
+{
+	assert(ebwt.offsLoaded());
+	assert_gt(seedLen, 0);
+	assert_gt(minOcc, 0);
+	Timer _t(cout, "  Time building hot-seed table: ", verbose);
+	EList<pair<TIndexOffU, TIndexOffU> > hot(MISC_CAT);
+	EList<HotNode> stack(MISC_CAT);
+	const TIndexOffU* fchr = ebwt.fchr();
+	for(int c = 0; c < 4; c++) {
+		if(fchr[c+1] - fchr[c] >= minOcc) {
+			stack.expand();
+			stack.back().top = fchr[c];
+			stack.back().bot = fchr[c+1];
+			stack.back().depth = 1;
+		}
+	}
+	while(!stack.empty()) {
+		HotNode n = stack.back();
+		stack.pop_back();
+		if(n.depth == seedLen) {
+			hot.push_back(make_pair(n.top, n.bot));
+			continue;
+		}
+		TIndexOffU tops[4] = {0, 0, 0, 0}, bots[4] = {0, 0, 0, 0};
+		ebwt.mapLFEx(n.top, n.bot, tops, bots);
+		for(int c = 0; c < 4; c++) {
+			if(bots[c] - tops[c] >= minOcc) {
+				stack.expand();
+				stack.back().top = tops[c];
+				stack.back().bot = bots[c];
+				stack.back().depth = n.depth + 1;
+			}
+		}
+	}
+	size_t nfound = hot.size();
+	if(hot.size() > maxSeeds) {
+		nth_element(hot.ptr(), hot.ptr() + maxSeeds, hot.ptr() + hot.size(), hotLarger);
+		hot.resize(maxSeeds);
+	}
+	hot.sort(); // by top
+	size_t noffs = 0;
+	for(size_t i = 0; i < hot.size(); i++) {
+		noffs += (hot[i].second - hot[i].first);
+	}
+	if(verbose) {
+		cout << "  " << nfound << " " << seedLen << "-mers occur at least "
+		     << minOcc << " times; keeping " << hot.size() << " with "
+		     << noffs << " occurrences" << endl;
+	}
+	ofstream out(fname.c_str(), ios::binary);
+	if(!out.good()) {
+		cerr << "Could not open hot-seed file \"" << fname.c_str()
+		     << "\" for writing." << endl;
+		throw 1;
+	}
+	writeU<uint32_t>(out, 1);
+	writeU<uint32_t>(out, (uint32_t)seedLen);
+	writeU<uint64_t>(out, fp);
+	writeU<TIndexOffU>(out, ebwt.eh().len());
+	writeU<TIndexOffU>(out, (TIndexOffU)hot.size());
+	writeU<TIndexOffU>(out, (TIndexOffU)noffs);
+	TIndexOffU first = 0;
+	for(size_t i = 0; i < hot.size(); i++) {
+		writeU<TIndexOffU>(out, hot[i].first);
+		writeU<TIndexOffU>(out, hot[i].second);
+		writeU<TIndexOffU>(out, first);
+		first += (hot[i].second - hot[i].first);
+	}
+	for(size_t i = 0; i < hot.size(); i++) {
+		for(TIndexOffU row = hot[i].first; row < hot[i].second; row++) {
+			writeU<TIndexOffU>(out, ebwt.getOffset(row));
+		}
+	}
+	out.close();
+	if(out.fail()) {
+		cerr << "Error writing hot-seed file \"" << fname.c_str() << "\"." << endl;
+		throw 1;
+	}
+	return hot.size();
+}
+
+/**
+ * Read or memory-map the table in 'fname'.  Returns false, leaving the
+ * table empty, if there's no such file or it wasn't built from the index
+ * with basename 'idxBase' and BWT length 'bwtLen' (a warning is printed
+ * in that case).
+ */
+bool HotSeeds::load(
+	const string& fname,
+	const string& idxBase,
+	TIndexOffU bwtLen,
+	bool useMm,
+	bool verbose)
+{
+	unload();
+	FILE *f = fopen(fname.c_str(), "rb");
+	if(f == NULL) return false;
+	struct stat sbuf;
+	if(fstat(fileno(f), &sbuf) == -1) {
+		fclose(f);
+		return false;
+	}
+	size_t sz = (size_t)sbuf.st_size;
+	const size_t hdrSz = 2 * sizeof(uint32_t) + sizeof(uint64_t) + 3 * sizeof(TIndexOffU);
+	if(sz < hdrSz) {
+		fclose(f);
+		cerr << "Warning: ignoring truncated hot-seed file \"" << fname.c_str() << "\"" << endl;
+		return false;
+	}
+#ifdef BOWTIE_MM
+	if(useMm) {
+		void *p = mmap((void *)0, sz, PROT_READ, MAP_SHARED, fileno(f), 0);
+		if(p == (void *)(-1)) {
+			perror("mmap");
+			cerr << "Error: Could not memory-map the hot-seed file " << fname.c_str() << endl;
+			fclose(f);
+			throw 1;
+		}
+		buf_ = (char*)p;
+		mmapped_ = true;
+	} else
+#endif
+	{
+		buf_ = new char[sz];
+		if(fread(buf_, 1, sz, f) != sz) {
+			delete[] buf_;
+			buf_ = NULL;
+			fclose(f);
+			cerr << "Error: Could not read the hot-seed file " << fname.c_str() << endl;
+			throw 1;
+		}
+	}
+	fclose(f);
+	bufSz_ = sz;
+	const uint32_t *h32 = (const uint32_t*)buf_;
+	const uint64_t fp = *(const uint64_t*)(buf_ + 2 * sizeof(uint32_t));
+	const TIndexOffU *h = (const TIndexOffU*)(buf_ + 2 * sizeof(uint32_t) + sizeof(uint64_t));
+	const char *problem = NULL;
+	if(h32[0] != 1) {
+		problem = "it was built on a machine with different endianness";
+	} else if(h[0] != bwtLen || fp != Ebwt::fingerprint(idxBase)) {
+		problem = "it doesn't match the index; rebuild it with bowtie2-build --hot-seeds";
+	} else if(hdrSz + (3 * (size_t)h[1] + (size_t)h[2]) * sizeof(TIndexOffU) != sz) {
+		problem = "it is truncated";
+	}
+	if(problem != NULL) {
+		cerr << "Warning: ignoring hot-seed file \"" << fname.c_str() << "\" because "
+		     << problem << endl;
+		unload();
+		return false;
+	}
+	seedLen_ = h32[1];
+	nranges_ = h[1];
+	noffs_ = h[2];
+	ranges_ = h + 3;
+	offs_ = ranges_ + 3 * nranges_;
+	if(verbose) {
+		cerr << "Loaded " << nranges_ << " hot " << seedLen_ << "-mers ("
+		     << noffs_ << " offsets) from \"" << fname.c_str() << "\"" << endl;
+	}
+	return true;
+}
+
+/**
+ * Free or unmap the table.
+ */
+void HotSeeds::unload() {
+	if(buf_ != NULL) {
+#ifdef BOWTIE_MM
+		if(mmapped_) {
+			munmap(buf_, bufSz_);
+		} else
+#endif
+		{
+			delete[] buf_;
+		}
+	}
+	buf_ = NULL;
+	bufSz_ = 0;
+	mmapped_ = false;
+	ranges_ = offs_ = NULL;
+	nranges_ = noffs_ = seedLen_ = 0;
+}
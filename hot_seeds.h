@@ -0,0 +1,168 @@
+/*
+ * Copyright 2011, Ben Langmead <langmea@cs.jhu.edu>
+ *
+ * This file is part of Bowtie 2.
+ *
+ * Bowtie 2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bowtie 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bowtie 2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * hot_seeds.h
+ *
+ * A table of precomputed reference offsets for the BW rows of the most
+ * frequent k-mers in the forward index, for k equal to (or shorter than)
+ * the seed length.  All rows whose suffixes start with the same k-mer form
+ * one SA range, and the SA range of any seed of length >= k that starts
+ * with that k-mer lies inside it.  So when a seed hit's range falls within
+ * a "hot" range, its offsets can be copied out of the table instead of
+ * being resolved by walking left to an SA sample, which for satellite and
+ * other highly repetitive seeds is where most walk-left BW ops are spent.
+ *
+ * The table is written by bowtie2-build --hot-seeds to NAME.hot.bt2 and is
+ * loaded (or memory-mapped, with --mm) by bowtie2-align if present.  Its
+ * layout, in native endianness, is:
+ *
+ *   uint32_t   1 (endianness check)
+ *   uint32_t   k
+ *   uint64_t   Ebwt::fingerprint() of the index the table was built from
+ *   TIndexOffU length of the BWT the table was built from
+ *   TIndexOffU # ranges
+ *   TIndexOffU # offsets
+ *   # ranges x { TIndexOffU top, bot, idx of first offset }, sorted by top
+ *   # offsets x TIndexOffU offset, in row order within each range
+ */
+
+#ifndef HOT_SEEDS_H_
+#define HOT_SEEDS_H_
+
+#include <stdint.h>
+#include <string>
+#include "assert_helpers.h"
+#include "btypes.h"
+
+class Ebwt;
+
+class HotSeeds {
+
+public:
+
+	HotSeeds() :
+		ranges_(NULL),
+		offs_(NULL),
+		nranges_(0),
+		noffs_(0),
+		seedLen_(0),
+		buf_(NULL),
+		bufSz_(0),
+		mmapped_(false)
+	{ }
+
+	~HotSeeds() { unload(); }
+
+	/**
+	 * Find the SA ranges of all k-mers that occur at least 'minOcc' times
+	 * in the forward index 'ebwt', keep the 'maxSeeds' largest, resolve
+	 * the offsets of all their rows, and write the table, tagged with the
+	 * index's fingerprint 'fp', to 'fname'.  The index's SA sample must be
+	 * in memory.  Returns the number of ranges written.
+	 */
+	static size_t build(
+		const Ebwt& ebwt,
+		size_t seedLen,
+		size_t minOcc,
+		size_t maxSeeds,
+		const std::string& fname,
+		uint64_t fp,
+		bool verbose);
+
+	/**
+	 * Read or memory-map the table in 'fname'.  Returns false, leaving
+	 * the table empty, if there's no such file or it wasn't built from
+	 * the index with basename 'idxBase' and BWT length 'bwtLen'.
+	 */
+	bool load(
+		const std::string& fname,
+		const std::string& idxBase,
+		TIndexOffU bwtLen,
+		bool useMm,
+		bool verbose);
+
+	/**
+	 * Free or unmap the table.
+	 */
+	void unload();
+
+	/**
+	 * If rows [top, bot) all lie in one of the table's ranges, return a
+	 * pointer to the offset of row 'top', followed by those of the rows
+	 * after it.  Otherwise return NULL.
+	 */
+	const TIndexOffU* lookup(TIndexOffU top, TIndexOffU bot) const {
+		assert_gt(bot, top);
+		if(nranges_ == 0) return NULL;
+		// Find the last range with a top <= 'top'
+		size_t lo = 0, hi = nranges_;
+		while(hi - lo > 1) {
+			size_t mid = (lo + hi) >> 1;
+			if(ranges_[mid * 3] <= top) {
+				lo = mid;
+			} else {
+				hi = mid;
+			}
+		}
+		const TIndexOffU* r = ranges_ + lo * 3;
+		if(r[0] > top || bot > r[1]) return NULL;
+		return offs_ + r[2] + (top - r[0]);
+	}
+
+	/**
+	 * Fill in the as-yet-unresolved elements of 'offs', the offsets of the
+	 * SA range starting at row 'top', if the range lies inside one of the
+	 * table's ranges.  Returns the number of elements filled in.
+	 */
+	template<typename T>
+	size_t resolve(TIndexOffU top, T& offs) const {
+		size_t sz = offs.size();
+		if(sz == 0) return 0;
+		const TIndexOffU* o = lookup(top, (TIndexOffU)(top + sz));
+		if(o == NULL) return 0;
+		size_t nres = 0;
+		for(size_t i = 0; i < sz; i++) {
+			if(offs[i] == OFF_MASK) {
+				offs[i] = o[i];
+				nres++;
+			}
+			assert_eq(o[i], offs[i]);
+		}
+		return nres;
+	}
+
+	bool   empty()     const { return nranges_ == 0; }
+	size_t numRanges() const { return nranges_; }
+	size_t numOffs()   const { return noffs_; }
+	size_t seedLen()   const { return seedLen_; }
+
+protected:
+
+	const TIndexOffU* ranges_;  // top, bot, first offset idx for each range
+	const TIndexOffU* offs_;    // offsets for all rows of all ranges
+	size_t            nranges_; // # ranges
+	size_t            noffs_;   // # offsets
+	size_t            seedLen_; // k
+	char*             buf_;     // file contents
+	size_t            bufSz_;   // size of file contents
+	bool              mmapped_; // buf_ is memory-mapped, not allocated
+};
+
+#endif /*HOT_SEEDS_H_*/
@@ -160,6 +160,39 @@ int main(void) {
 		}
 	}
 	cerr << " PASSED" << endl;
+
+	cerr << "Random testing (hashed vs. merged) ... ";
+	{
+		RandomSource rnd(34523);
+		EIvalHashSet list1;
+		for(size_t c = 0; c < 10; c++) {
+			EIvalMergeList list2((size_t)16);
+			list1.clear();
+			size_t num_intervals = 40;
+			uint32_t max_width = 200;
+			for(size_t i = 0; i < num_intervals; i++) {
+				uint32_t start = rnd.nextU32() % max_width/2;
+				uint32_t end = (rnd.nextU32() % (max_width - start - 1) + start)+1;
+				bool orient = (rnd.nextU2() == 0);
+				TRefId ref = (TRefId)(rnd.nextU32() % 5);
+				list1.add(Interval(ref, start, orient, end-start));
+				list2.add(Interval(ref, start, orient, end-start));
+			}
+			assert_eq(num_intervals, list1.size());
+			assert(list1.repOk());
+			for(uint32_t i = 0; i < max_width+1; i++) {
+				for(int fwi = 0; fwi < 2; fwi++) {
+					bool fw = (fwi == 0);
+					for(TRefId refi = 0; refi < 5; refi++) {
+						ASSERT_ONLY(bool l1 = list1.locusPresent(Coord(refi, i, fw)));
+						ASSERT_ONLY(bool l2 = list2.locusPresent(Coord(refi, i, fw)));
+						assert_eq(l1, l2);
+					}
+				}
+			}
+		}
+	}
+	cerr << " PASSED" << endl;
 }
 
 #endif /*def MAIN_IVAL_DS*/
@@ -296,4 +296,92 @@ protected:
 	EList<EIvalMergeList> bins_;
 };
 
+/**
+ * Hashed version of the above.  Short intervals, such as the seed diagonal or
+ * the core diagonals of a seed-extension rectangle, are stored as the set of
+ * individual loci they cover, so that both add() and locusPresent() are
+ * expected O(1) and clearing between reads is O(1).  Any longer intervals are
+ * kept in an EIvalMergeList.
+ */
+class EIvalHashSet {
+public:
+
+	static const TRefOff MAX_HASHED_LEN = 64;
+
+	explicit EIvalHashSet(int cat = 0) :
+		loci_(cat),
+		long_(cat),
+		nival_(0)
+	{ }
+
+	/**
+	 * Add a new interval to the list.
+	 */
+	void add(const Interval& i) {
+		nival_++;
+		if(i.len() > MAX_HASHED_LEN) {
+			long_.add(i);
+			return;
+		}
+		Coord c = i.upstream();
+		for(TRefOff j = 0; j < i.len(); j++) {
+			loci_.insert(c);
+			c.adjustOff(1);
+		}
+	}
+
+#ifndef NDEBUG
+	/**
+	 * Check that this interval list is internally consistent.
+	 */
+	bool repOk() const {
+		assert(long_.repOk());
+		return true;
+	}
+#endif
+	
+	/**
+	 * Remove all ranges from the list.
+	 */
+	void reset() { clear(); }
+	
+	/**
+	 * Remove all ranges from the list.
+	 */
+	void clear() {
+		loci_.clear();
+		long_.clear();
+		nival_ = 0;
+	}
+	
+	/**
+	 * Return true iff this locus is present in one of the intervals in the
+	 * list.
+	 */
+	bool locusPresent(const Coord& loc) const {
+		return loci_.contains(loc) || (!long_.empty() && long_.locusPresent(loc));
+	}
+	
+	/**
+	 * Return the number of intervals added since the last call to reset() or
+	 * clear().
+	 */
+	size_t size() const {
+		return nival_;
+	}
+	
+	/**
+	 * Return true iff list is empty.
+	 */
+	bool empty() const {
+		return nival_ == 0;
+	}
+	
+protected:
+	
+	EHashSet<Coord> loci_;  // loci covered by short intervals
+	EIvalMergeList  long_;  // long intervals
+	size_t          nival_; // # intervals added
+};
+
 #endif /*ndef IVAL_LIST_H_*/
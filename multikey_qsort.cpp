@@ -19,5 +19,17 @@
 
 #include "multikey_qsort.h"
 
-// 5 64-element buckets for bucket-sorting A, C, G, T, $
-TIndexOffU bkts[4][4 * 1024 * 1024];
+// Buckets for bucket-sorting A, C, G, T; one set per thread
+static DS_THREAD_LOCAL TSufBkts *bkts = NULL;
+
+TSufBkts& sufBuckets() {
+	if(bkts == NULL) {
+		bkts = (TSufBkts*)new TIndexOffU[4 * BUCKET_SORT_CUTOFF];
+	}
+	return *bkts;
+}
+
+void freeSufBuckets() {
+	delete[] (TIndexOffU*)bkts;
+	bkts = NULL;
+}
@@ -27,6 +27,7 @@
 #include "diff_sample.h"
 #include "sstring.h"
 #include "btypes.h"
+#include "ds.h"
 
 using namespace std;
 
@@ -805,8 +806,19 @@ void qsortSufDcU8(
 #define BUCKET_SORT_CUTOFF (4 * 1024 * 1024)
 #define SELECTION_SORT_CUTOFF 6
 
-// 5 64-element buckets for bucket-sorting A, C, G, T, $
-extern TIndexOffU bkts[4][4 * 1024 * 1024];
+typedef TIndexOffU TSufBkts[4][BUCKET_SORT_CUTOFF];
+
+/**
+ * Return this thread's buckets for bucket-sorting A, C, G, T, allocating
+ * them on first use.  Each thread gets its own so that the forward and
+ * mirror indexes can be built concurrently.
+ */
+extern TSufBkts& sufBuckets();
+
+/**
+ * Free this thread's buckets, if it has any.
+ */
+extern void freeSufBuckets();
 
 /**
  * Straightforwardly obtain a uint8_t-ized version of t[off].  This
@@ -1009,6 +1021,7 @@ static void bucketSortSufDcU8(
 		}
 		return;
 	}
+	TSufBkts& bkts = sufBuckets();
 	for(size_t i = begin; i < end; i++) {
 		size_t off = depth + s[i];
 		uint8_t c = (off < hlen) ? get_uint8(host, off) : hi;
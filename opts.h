@@ -113,6 +113,8 @@ enum {
 	ARG_SSE8_NO,                // --no-sse8
 	ARG_UNGAPPED,               // --ungapped
 	ARG_UNGAPPED_NO,            // --no-ungapped
+	ARG_BP_FILTER,              // --bp-filter
+	ARG_BP_FILTER_NO,           // --no-bp-filter
 	ARG_TIGHTEN,                // --tighten
 	ARG_UNGAP_THRESH,           // --ungap-thresh
 	ARG_EXACT_UPFRONT,          // --exact-upfront
@@ -123,6 +125,8 @@ enum {
 	ARG_VERSION,                // --version
 	ARG_SEED_OFF,               // --seed-off
 	ARG_SEED_BOOST_THRESH,      // --seed-boost
+	ARG_ADAPTIVE_SEED,          // --adaptive-seed
+	ARG_SMEM_SEEDS,             // --smem-seeds
 	ARG_READ_TIMES,             // --read-times
 	ARG_EXTEND_ITERS,           // --extends
 	ARG_DP_MATE_STREAK_THRESH,  // --db-mate-streak
@@ -142,6 +146,11 @@ enum {
 	ARG_TRI,                    // --tri
 	ARG_LOCAL_SEED_CACHE_SZ,    // --local-seed-cache-sz
 	ARG_CURRENT_SEED_CACHE_SZ,  // --seed-cache-sz
+	ARG_DEDUP_CACHE,            // --dedup-cache
+	ARG_SORT_WINDOW,            // --sort-window
+	ARG_MAX_LATENCY,            // --max-latency
+	ARG_NO_HOT_SEEDS,           // --no-hot-seeds
+	ARG_NO_FTAB2,               // --no-ftab2
 	ARG_SAM_NO_UNAL,            // --no-unal
 	ARG_NON_DETERMINISTIC,      // --non-deterministic
 	ARG_TEST_25,                // --test-25
@@ -151,7 +160,8 @@ enum {
 	ARG_DESC_PRIORITIZE,        // --desc-prioritize
 	ARG_DESC_FMOPS,             // --desc-fmops
 	ARG_LOG_DP,                 // --log-dp
-	ARG_LOG_DP_OPP              // --log-dp-opp
+	ARG_LOG_DP_OPP,             // --log-dp-opp
+	ARG_DP_KERNELS              // --kernels
 };
 
 #endif
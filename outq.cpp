@@ -17,6 +17,7 @@
  * along with Bowtie 2.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <time.h>
 #include "outq.h"
 
 /**
@@ -36,6 +37,9 @@ void OutputQueue::beginRead(TReadId rdid, size_t threadId) {
 			lines_.resize(rdid - cur_ + 1);
 			started_.resize(rdid - cur_ + 1);
 			finished_.resize(rdid - cur_ + 1);
+			if(trackLatency_) {
+				begs_.resize(rdid - cur_ + 1);
+			}
 			for(size_t i = oldsz; i < lines_.size(); i++) {
 				started_[i] = finished_[i] = false;
 			}
@@ -46,9 +50,14 @@ void OutputQueue::beginRead(TReadId rdid, size_t threadId) {
 }
 
 /**
- * Writer is finished writing to 
+ * Writer is finished writing to rec.
  */
-void OutputQueue::finishRead(const BTString& rec, TReadId rdid, size_t threadId) {
+void OutputQueue::finishRead(
+	const BTString& rec,
+	TReadId rdid,
+	size_t threadId,
+	uint64_t begUs)
+{
 	ThreadSafe t(&mutex_m, threadSafe_);
 	if(reorder_) {
 		assert_geq(rdid, cur_);
@@ -58,12 +67,18 @@ void OutputQueue::finishRead(const BTString& rec, TReadId rdid, size_t threadId)
 		assert(started_[rdid - cur_]);
 		assert(!finished_[rdid - cur_]);
 		lines_[rdid - cur_] = rec;
+		if(trackLatency_) {
+			begs_[rdid - cur_] = begUs;
+		}
 		nfinished_++;
 		finished_[rdid - cur_] = true;
 		flush(false, false); // don't force; already have lock
 	} else {
 		// obuf_ is the OutFileBuf for the output file
 		obuf_.writeString(rec);
+		if(trackLatency_) {
+			unsynced_.push_back(begUs);
+		}
 		nfinished_++;
 		nflushed_++;
 	}
@@ -90,6 +105,12 @@ void OutputQueue::flush(bool force, bool getLock) {
 			assert(finished_[i]);
 			obuf_.writeString(lines_[i]);
 		}
+		if(trackLatency_) {
+			for(size_t i = 0; i < nflush; i++) {
+				unsynced_.push_back(begs_[i]);
+			}
+			begs_.erase(0, nflush);
+		}
 		lines_.erase(0, nflush);
 		started_.erase(0, nflush);
 		finished_.erase(0, nflush);
@@ -98,6 +119,63 @@ void OutputQueue::flush(bool force, bool getLock) {
 	}
 }
 
+/**
+ * Write every record that can be written in order and push it all the way
+ * through obuf_ to the OS.
+ */
+void OutputQueue::flushAll() {
+	ThreadSafe t(&mutex_m, threadSafe_);
+	flush(true, false); // force; already have lock
+	if(nsynced_ == nflushed_) {
+		return;
+	}
+	obuf_.flushAll();
+	nsynced_ = nflushed_;
+	if(trackLatency_) {
+		uint64_t now = nowUs();
+		for(size_t i = 0; i < unsynced_.size(); i++) {
+			lat_.add(now > unsynced_[i] ? now - unsynced_[i] : 0);
+		}
+		unsynced_.clear();
+	}
+}
+
+OutputFlusher::OutputFlusher(OutputQueue& oq, size_t ivalMs) :
+	oq_(oq),
+	ivalMs_(ivalMs),
+	quit_(false)
+{
+	assert_gt(ivalMs, 0);
+#ifdef WITH_TBB
+	thread_ = new tbb::tbb_thread(OutputFlusher::loop, (void*)this);
+#else
+	thread_ = new tthread::thread(OutputFlusher::loop, (void*)this);
+#endif
+}
+
+OutputFlusher::~OutputFlusher() {
+	{
+		ThreadSafe ts(&mutex_m);
+		quit_ = true;
+	}
+	thread_->join();
+	delete thread_;
+}
+
+/**
+ * Flusher thread body: flush, sleep, repeat until told to quit.
+ */
+void OutputFlusher::loop(void *vp) {
+	OutputFlusher *f = (OutputFlusher*)vp;
+	struct timespec ival;
+	ival.tv_sec  = (time_t)(f->ivalMs_ / 1000);
+	ival.tv_nsec = (long)(f->ivalMs_ % 1000) * 1000000;
+	while(!f->quitting()) {
+		nanosleep(&ival, NULL);
+		f->oq_.flushAll();
+	}
+}
+
 #ifdef OUTQ_MAIN
 
 #include <iostream>
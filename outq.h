@@ -20,6 +20,12 @@
 #ifndef OUTQ_H_
 #define OUTQ_H_
 
+#include <string.h>
+#include <sys/time.h>
+#include <algorithm>
+#ifdef WITH_TBB
+# include <tbb/tbb_thread.h>
+#endif
 #include "assert_helpers.h"
 #include "ds.h"
 #include "sstring.h"
@@ -27,6 +33,80 @@
 #include "threading.h"
 #include "mem_ids.h"
 
+/**
+ * Counts latencies, in microseconds, in buckets whose bounds grow 8 per
+ * power of 2, so percentiles are accurate to within about 12% in constant
+ * space.
+ */
+class LatencyHist {
+
+	static const size_t NBUCKETS = 8 + 61 * 8;
+
+public:
+
+	LatencyHist() { clear(); }
+
+	void clear() {
+		memset(cnt_, 0, sizeof(cnt_));
+		n_ = max_ = 0;
+	}
+
+	/**
+	 * Count one latency.
+	 */
+	void add(uint64_t us) {
+		cnt_[bucket(us)]++;
+		n_++;
+		if(us > max_) max_ = us;
+	}
+
+	/**
+	 * Return an upper bound on the latency that fraction p of the counted
+	 * latencies don't exceed, or 0 if none were counted.
+	 */
+	uint64_t percentile(double p) const {
+		uint64_t target = (uint64_t)(p * n_ + 0.999999);
+		if(target == 0) target = 1;
+		uint64_t cum = 0;
+		for(size_t i = 0; i < NBUCKETS; i++) {
+			cum += cnt_[i];
+			if(cum >= target) {
+				return std::min(upper(i), max_);
+			}
+		}
+		return max_;
+	}
+
+	uint64_t size() const { return n_; }
+	uint64_t max()  const { return max_; }
+
+protected:
+
+	/**
+	 * Latencies under 8 get a bucket each; after that each power of 2 is
+	 * split into 8 buckets.
+	 */
+	static size_t bucket(uint64_t us) {
+		if(us < 8) return (size_t)us;
+		size_t e = 3;
+		while((us >> (e + 1)) != 0) e++;
+		return 8 + (e - 3) * 8 + (size_t)((us >> (e - 3)) & 7);
+	}
+
+	/**
+	 * Largest latency that falls in bucket b.
+	 */
+	static uint64_t upper(size_t b) {
+		if(b < 8) return b;
+		size_t e = (b - 8) / 8 + 3, sub = (b - 8) % 8;
+		return (((uint64_t)9 + sub) << (e - 3)) - 1;
+	}
+
+	uint64_t cnt_[NBUCKETS];
+	uint64_t n_;
+	uint64_t max_;
+};
+
 /**
  * Encapsulates a list of lines of output.  If the earliest as-yet-unreported
  * read has id N and Bowtie 2 wants to write a record for read with id N+1, we
@@ -45,17 +125,22 @@ public:
 		bool reorder,
 		size_t nthreads,
 		bool threadSafe,
-		TReadId rdid = 0) :
+		TReadId rdid = 0,
+		bool trackLatency = false) :
 		obuf_(obuf),
 		cur_(rdid),
 		nstarted_(0),
 		nfinished_(0),
 		nflushed_(0),
+		nsynced_(0),
 		lines_(RES_CAT),
 		started_(RES_CAT),
 		finished_(RES_CAT),
+		begs_(RES_CAT),
+		unsynced_(RES_CAT),
 		reorder_(reorder),
 		threadSafe_(threadSafe),
+		trackLatency_(trackLatency),
         mutex_m()
 	{
 		assert(nthreads <= 1 || threadSafe);
@@ -68,9 +153,15 @@ public:
 	void beginRead(TReadId rdid, size_t threadId);
 	
 	/**
-	 * Writer is finished writing to 
+	 * Writer is finished writing to rec.  If latencies are being tracked,
+	 * begUs is when work on the read started, in microseconds since the
+	 * epoch.
 	 */
-	void finishRead(const BTString& rec, TReadId rdid, size_t threadId);
+	void finishRead(
+		const BTString& rec,
+		TReadId rdid,
+		size_t threadId,
+		uint64_t begUs = 0);
 	
 	/**
 	 * Return the number of records currently being buffered.
@@ -105,6 +196,30 @@ public:
 	 */
 	void flush(bool force = false, bool getLock = true);
 
+	/**
+	 * Write every record that can be written in order and push it all the
+	 * way through obuf_ to the OS.  If latencies are being tracked, count
+	 * one for each record pushed out.
+	 */
+	void flushAll();
+
+	/**
+	 * Return the histogram of latencies from when work on a read started to
+	 * when its records were pushed out by flushAll().
+	 */
+	const LatencyHist& latencies() const {
+		return lat_;
+	}
+
+	/**
+	 * Return the current time in microseconds since the epoch.
+	 */
+	static uint64_t nowUs() {
+		struct timeval tv;
+		gettimeofday(&tv, NULL);
+		return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+	}
+
 protected:
 
 	OutFileBuf&     obuf_;
@@ -112,31 +227,77 @@ protected:
 	TReadId         nstarted_;
 	TReadId         nfinished_;
 	TReadId         nflushed_;
+	TReadId         nsynced_;      // # records pushed out by flushAll()
 	EList<BTString> lines_;
 	EList<bool>     started_;
 	EList<bool>     finished_;
+	EList<uint64_t> begs_;         // start times for lines_
+	EList<uint64_t> unsynced_;     // start times for records not yet pushed out
+	LatencyHist     lat_;          // latencies of records pushed out
 	bool            reorder_;
 	bool            threadSafe_;
+	bool            trackLatency_; // fill in begs_, unsynced_ and lat_
 	MUTEX_T         mutex_m;
 };
 
+/**
+ * Thread that calls flushAll() on an OutputQueue every so many
+ * milliseconds, so that no finished record waits much longer than that to
+ * reach the output, however slowly reads arrive.
+ */
+class OutputFlusher {
+
+public:
+
+	OutputFlusher(OutputQueue& oq, size_t ivalMs);
+
+	/**
+	 * Stop the thread; the caller does the last flush.
+	 */
+	~OutputFlusher();
+
+protected:
+
+	static void loop(void *vp);
+
+	/**
+	 * Return true iff the thread has been told to exit.
+	 */
+	bool quitting() {
+		ThreadSafe ts(&mutex_m);
+		return quit_;
+	}
+
+	OutputQueue&      oq_;
+	size_t            ivalMs_; // time between flushes
+	bool              quit_;   // true -> thread exits; guarded by mutex_m
+	MUTEX_T           mutex_m;
+#ifdef WITH_TBB
+	tbb::tbb_thread  *thread_;
+#else
+	tthread::thread  *thread_;
+#endif
+};
+
 class OutputQueueMark {
 public:
 	OutputQueueMark(
 		OutputQueue& q,
 		const BTString& rec,
 		TReadId rdid,
-		size_t threadId) :
+		size_t threadId,
+		uint64_t begUs = 0) :
 		q_(q),
 		rec_(rec),
 		rdid_(rdid),
-		threadId_(threadId)
+		threadId_(threadId),
+		begUs_(begUs)
 	{
 		q_.beginRead(rdid, threadId);
 	}
 	
 	~OutputQueueMark() {
-		q_.finishRead(rec_, rdid_, threadId_);
+		q_.finishRead(rec_, rdid_, threadId_, begUs_);
 	}
 	
 protected:
@@ -144,6 +305,7 @@ protected:
 	const BTString& rec_;
 	TReadId rdid_;
 	size_t threadId_;
+	uint64_t begUs_;
 };
 
 #endif
@@ -305,6 +305,122 @@ pair<TReadId, TReadId> PairedDualPatternSource::readCnt() const {
 	return make_pair(rets, retp);
 }
 
+/**
+ * Return the sort key for a read: the smallest hash of any canonical
+ * 15-mer with no Ns, or the max value if there isn't one.  The hash is an
+ * invertible mix, so distinct k-mers get distinct keys and low-complexity
+ * k-mers don't crowd the front of the order.
+ */
+uint64_t SortedPatternSource::minimizer(const BTDnaString& seq) {
+	const size_t k = 15;
+	const uint64_t mask = (1llu << (2 * k)) - 1;
+	uint64_t fw = 0, rc = 0, best = std::numeric_limits<uint64_t>::max();
+	size_t valid = 0;
+	for(size_t i = 0; i < seq.length(); i++) {
+		int c = (int)seq[i];
+		if(c > 3) {
+			valid = 0;
+			continue;
+		}
+		fw = ((fw << 2) | (uint64_t)c) & mask;
+		rc = (rc >> 2) | ((uint64_t)(3 - c) << (2 * (k - 1)));
+		if(++valid >= k) {
+			uint64_t h = fw < rc ? fw : rc;
+			h ^= h >> 33;
+			h *= 0xff51afd7ed558ccdllu;
+			h ^= h >> 33;
+			h *= 0xc4ceb9fe1a85ec53llu;
+			h ^= h >> 33;
+			if(h < best) best = h;
+		}
+	}
+	return best;
+}
+
+/**
+ * Read up to window_ reads/pairs from src_, remember them, and sort them
+ * by key.  Ties go to the read that came first.  Assumes lock is held.
+ */
+void SortedPatternSource::refill(Read& ra, Read& rb, bool fixName) {
+	bufa_.clear();
+	bufb_.clear();
+	paired_.clear();
+	order_.clear();
+	cur_ = 0;
+	while(!done_ && order_.size() < window_) {
+		TReadId rdid = 0, endid = 0;
+		bool success = false, done = false, paired = false;
+		do {
+			src_->nextReadPair(
+				ra, rb, rdid, endid, success, done, paired, fixName);
+		} while(!success && !done);
+		if(!success) {
+			done_ = true;
+			break;
+		}
+		if(rdid >= upto_) {
+			// The search loop quits at the first read past the limit, so
+			// nothing after it needs buffering
+			done_ = true;
+			break;
+		}
+		if(rdid < skip_) {
+			continue;
+		}
+		size_t i = order_.size();
+		bufa_.expand();
+		bufa_.back().save(ra);
+		bufb_.expand();
+		bufb_.back().save(rb);
+		uint64_t key = minimizer(ra.patFw);
+		if(!rb.empty()) {
+			uint64_t keyb = minimizer(rb.patFw);
+			if(keyb < key) key = keyb;
+		}
+		paired_.push_back(paired);
+		order_.push_back(make_pair(key, i));
+	}
+	order_.sort();
+}
+
+/**
+ * Dispense the next read or pair in key order, refilling and sorting the
+ * window first if it's used up.
+ */
+bool SortedPatternSource::nextReadPair(
+	Read& ra,
+	Read& rb,
+	TReadId& rdid,
+	TReadId& endid,
+	bool& success,
+	bool& done,
+	bool& paired,
+	bool fixName)
+{
+	ThreadSafe ts(&mutex_m);
+	if(cur_ >= order_.size()) {
+		refill(ra, rb, fixName);
+	}
+	if(cur_ >= order_.size()) {
+		assert(done_);
+		ra.reset();
+		rb.reset();
+		success = false;
+		done = true;
+		paired = false;
+		return false;
+	}
+	size_t i = order_[cur_++].second;
+	bufa_[i].restore(ra);
+	bufb_[i].restore(rb);
+	paired = paired_[i];
+	rdid = ra.rdid;
+	endid = ra.endid;
+	success = true;
+	done = false;
+	return paired;
+}
+
 /**
  * Given the values for all of the various arguments used to specify
  * the read and quality input, create a list of pattern sources to
@@ -968,8 +1084,17 @@ bool FastqPatternSource::read(
 			// In case the original quality string is one shorter
 			mytrim5--;
 		}
+		// Read the line without looking past its end, which could wait on
+		// the next record in --max-latency mode
+		size_t buflen = 0;
+		while(true) {
+			c = fb_.get();
+			if(c < 0 || c == '\n' || c == '\r') break;
+			if(buflen < sizeof(buf) - 1) buf[buflen++] = (char)c;
+		}
+		buf[buflen] = '\0';
 		qualToks_.clear();
-		tokenizeQualLine(fb_, buf, 4096, qualToks_);
+		tokenize(string(buf), " ", qualToks_);
 		for(unsigned int j = 0; j < qualToks_.size(); ++j) {
 			char c = intToPhred33(atoi(qualToks_[j].c_str()), solQuals_);
 			assert_geq(c, 33);
@@ -993,7 +1118,11 @@ bool FastqPatternSource::read(
 			r.qual.resize(r.patFw.length());
 			assert_eq((int)r.qual.length(), dstLen);
 		}
-		peekOverNewline(fb_);
+		if(stream_) {
+			getRestOfNewline(fb_, c);
+		} else {
+			peekOverNewline(fb_);
+		}
 	} else {
 		// Non-integer qualities
 		altBufIdx = 0;
@@ -1101,18 +1230,28 @@ bool FastqPatternSource::read(
 			}
 		}
 
-		if(c == '\r' || c == '\n') {
-			c = peekOverNewline(fb_);
-		} else {
+		if(c != '\r' && c != '\n') {
 			c = peekToEndOfLine(fb_);
+		} else if(stream_) {
+			// Don't leave half of a "\r\n" to the next record
+			getRestOfNewline(fb_, c);
+		} else {
+			c = peekOverNewline(fb_);
 		}
 	}
 	r.readOrigBuf.install(fb_.lastN(), fb_.lastNLen());
 	fb_.resetLastN();
 
-	c = fb_.get();
-	// Should either be at end of file or at beginning of next record
-	assert(c == -1 || c == '@');
+	if(stream_) {
+		// Looking for the next record's '@' could wait on input that
+		// hasn't arrived yet; leave it and any newlines before it for the
+		// next call
+		first_ = true;
+	} else {
+		c = fb_.get();
+		// Should either be at end of file or at beginning of next record
+		assert(c == -1 || c == '@');
+	}
 
 	// Set up a default name if one hasn't been set
 	if(r.name.empty()) {
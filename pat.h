@@ -38,6 +38,7 @@
 #include "search_globals.h"
 #include "sstring.h"
 #include "ds.h"
+#include "mem_ids.h"
 #include "read.h"
 #include "util.h"
 
@@ -105,7 +106,8 @@ struct PatternParams {
 		bool fuzzy_,
 		int sampleLen_,
 		int sampleFreq_,
-		uint32_t skip_) :
+		uint32_t skip_,
+		bool stream_) :
 		format(format_),
 		fileParallel(fileParallel_),
 		seed(seed_),
@@ -116,7 +118,8 @@ struct PatternParams {
 		fuzzy(fuzzy_),
 		sampleLen(sampleLen_),
 		sampleFreq(sampleFreq_),
-		skip(skip_) { }
+		skip(skip_),
+		stream(stream_) { }
 
 	int format;           // file format
 	bool fileParallel;    // true -> wrap files with separate PairedPatternSources
@@ -129,6 +132,7 @@ struct PatternParams {
 	int sampleLen;        // length of sampled reads for FastaContinuous...
 	int sampleFreq;       // frequency of sampled reads for FastaContinuous...
 	uint32_t skip;        // skip the first 'skip' patterns
+	bool stream;          // true -> parse reads as soon as they arrive
 };
 
 /**
@@ -501,6 +505,175 @@ protected:
 	const EList<PatternSource*>* srcb_; /// PatternSources for 2nd mates
 };
 
+/**
+ * The parts of a Read that a PatternSource fills in, kept compactly while
+ * the read waits in a SortedPatternSource window.  The reverse and
+ * reverse-complement strings are rebuilt when the read is handed out.
+ */
+struct WindowRead {
+
+	/**
+	 * Remember the parsed fields of r.
+	 */
+	void save(const Read& r) {
+		patFw = r.patFw;
+		qual = r.qual;
+		name = r.name;
+		readOrigBuf = r.readOrigBuf;
+		rdid = r.rdid;
+		endid = r.endid;
+		mate = r.mate;
+		seed = r.seed;
+		ns = r.ns_;
+		color = r.color;
+		primer = r.primer;
+		trimc = r.trimc;
+		filter = r.filter;
+		trimmed5 = r.trimmed5;
+		trimmed3 = r.trimmed3;
+	}
+
+	/**
+	 * Overwrite r with the remembered read and rebuild its derived
+	 * strings.
+	 */
+	void restore(Read& r) const {
+		r.reset();
+		r.patFw = patFw;
+		r.qual = qual;
+		r.name = name;
+		r.readOrigBuf = readOrigBuf;
+		r.rdid = rdid;
+		r.endid = endid;
+		r.mate = mate;
+		r.seed = seed;
+		r.ns_ = ns;
+		r.color = color;
+		r.primer = primer;
+		r.trimc = trimc;
+		r.filter = filter;
+		r.trimmed5 = trimmed5;
+		r.trimmed3 = trimmed3;
+		r.constructRevComps();
+		r.constructReverses();
+	}
+
+	BTDnaString patFw;       // forward-strand sequence
+	BTString    qual;        // quality values
+	BTString    name;        // read name
+	SStringExpandable<char> readOrigBuf; // original record
+	TReadId     rdid;        // read id
+	TReadId     endid;       // end id
+	int         mate;        // 0 = single-end, 1 = mate1, 2 = mate2
+	uint32_t    seed;        // pseudo-random seed
+	size_t      ns;          // # Ns
+	bool        color;       // colorspace?
+	char        primer;      // primer base, for csfasta files
+	char        trimc;       // trimmed color, for csfasta files
+	char        filter;      // filter char, if format has one
+	int         trimmed5;    // amount trimmed off 5' end
+	int         trimmed3;    // amount trimmed off 3' end
+};
+
+/**
+ * Wraps another PairedPatternSource and dispenses its reads a window at a
+ * time, in order of a cheap sequence key (the smallest canonical k-mer
+ * hash over both mates) rather than input order.  Reads drawn from the
+ * same region of the genome then tend to be aligned back to back, so the
+ * index blocks, reference stretches and seed-cache entries one read
+ * touches are still cached when the next read needs them.  rdids are left
+ * as they were so that the OutputQueue can restore input order.
+ *
+ * Reads with rdid < skip are dropped here, and no reads at or past upto
+ * are buffered, since the search loop stops at the first such read.
+ */
+class SortedPatternSource : public PairedPatternSource {
+
+public:
+
+	SortedPatternSource(
+		PairedPatternSource* src, // source to wrap; we delete it
+		size_t window,            // # reads/pairs to sort at a time
+		TReadId skip,             // drop reads with rdid < skip
+		TReadId upto,             // stop before first read with rdid >= upto
+		const PatternParams& p) :
+		PairedPatternSource(p),
+		src_(src),
+		window_(window),
+		skip_(skip),
+		upto_(upto),
+		done_(false),
+		cur_(0),
+		bufa_(MISC_CAT),
+		bufb_(MISC_CAT),
+		paired_(MISC_CAT),
+		order_(MISC_CAT)
+	{
+		assert(src_ != NULL);
+		assert_gt(window_, 0);
+	}
+
+	virtual ~SortedPatternSource() {
+		delete src_;
+	}
+
+	virtual void addWrapper() {
+		src_->addWrapper();
+	}
+
+	virtual void reset() {
+		src_->reset();
+		bufa_.clear();
+		bufb_.clear();
+		paired_.clear();
+		order_.clear();
+		cur_ = 0;
+		done_ = false;
+	}
+
+	/**
+	 * Dispense the next read or pair in key order, refilling and sorting
+	 * the window first if it's used up.
+	 */
+	virtual bool nextReadPair(
+		Read& ra,
+		Read& rb,
+		TReadId& rdid,
+		TReadId& endid,
+		bool& success,
+		bool& done,
+		bool& paired,
+		bool fixName);
+
+	virtual pair<TReadId, TReadId> readCnt() const {
+		return src_->readCnt();
+	}
+
+	/**
+	 * Return the sort key for a read: the smallest hash of any canonical
+	 * k-mer with no Ns, or the max value if there isn't one.
+	 */
+	static uint64_t minimizer(const BTDnaString& seq);
+
+protected:
+
+	/**
+	 * Read up to window_ reads/pairs from src_ and sort them by key.
+	 */
+	void refill(Read& ra, Read& rb, bool fixName);
+
+	PairedPatternSource* src_;  // wrapped source
+	size_t  window_;            // # reads/pairs per window
+	TReadId skip_;              // drop reads with rdid < skip_
+	TReadId upto_;              // don't buffer reads with rdid >= upto_
+	bool    done_;              // src_ is exhausted
+	size_t  cur_;               // next element of order_ to dispense
+	EList<WindowRead> bufa_;    // mate 1s / unpaired reads in window
+	EList<WindowRead> bufb_;    // mate 2s in window
+	EList<bool>       paired_;  // whether each window entry is a pair
+	EList<pair<uint64_t, size_t> > order_; // (key, window idx), sorted
+};
+
 /**
  * Encapsulates a single thread's interaction with the PatternSource.
  * Most notably, this class holds the buffers into which the
@@ -665,6 +838,16 @@ static inline int peekOverNewline(FileBuf& in) {
 	}
 }
 
+/// Having just read the '\r' or '\n' in c that ends a line, also consume
+/// the '\n' of a "\r\n" pair, but don't look any further ahead.  Unlike
+/// peekOverNewline(), won't wait on input that hasn't arrived yet
+/// (except after a lone '\r').
+static inline void getRestOfNewline(FileBuf& in, int c) {
+	if(c == '\r' && in.peek() == '\n') {
+		in.get();
+	}
+}
+
 /// Skip to the end of the current line; return the first character
 /// of the next line or -1 for EOF
 static inline int getToEndOfLine(FileBuf& in) {
@@ -764,7 +947,8 @@ public:
 		filecur_(0),
 		fb_(),
 		skip_(p.skip),
-		first_(true)
+		first_(true),
+		stream_(p.stream)
 	{
 		assert_gt(infiles.size(), 0);
 		errs_.resize(infiles_.size());
@@ -896,6 +1080,7 @@ protected:
 				continue;
 			}
 			fb_.newFile(in);
+			fb_.setPartial(stream_);
 			return;
 		}
 		cerr << "Error: No input read files were valid" << endl;
@@ -909,6 +1094,7 @@ protected:
 	FileBuf fb_;             // read file currently being read from
 	TReadId skip_;           // number of reads to skip
 	bool first_;
+	bool stream_;            // don't wait for input beyond the current read
 };
 
 /**
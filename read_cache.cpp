@@ -0,0 +1,148 @@
+/*
+ * Copyright 2011, Ben Langmead <langmea@cs.jhu.edu>
+ *
+ * This file is part of Bowtie 2.
+ *
+ * Bowtie 2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bowtie 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bowtie 2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "read_cache.h"
+
+/**
+ * Hash the key fields of rd1/rd2: sequences, qualities, trimming, and the
+ * pseudo-random seed.
+ */
+uint64_t ReadResultCache::hashKey(
+	const Read& rd1,
+	const Read* rd2,
+	uint32_t seed)
+{
+	uint64_t h = 0xcbf29ce484222325llu; // FNV-1a
+	h = (h ^ (uint64_t)seed) * 0x100000001b3llu;
+	for(int mate = 0; mate < 2; mate++) {
+		const Read* rd = (mate == 0 ? &rd1 : rd2);
+		if(rd == NULL) {
+			break;
+		}
+		const size_t len = rd->patFw.length();
+		for(size_t i = 0; i < len; i++) {
+			h = (h ^ (uint64_t)rd->patFw[i]) * 0x100000001b3llu;
+		}
+		for(size_t i = 0; i < rd->qual.length(); i++) {
+			h = (h ^ (uint64_t)(uint8_t)rd->qual[i]) * 0x100000001b3llu;
+		}
+		h = (h ^ (uint64_t)len) * 0x100000001b3llu;
+		h = (h ^ (uint64_t)((rd->trimmed5 << 16) | rd->trimmed3)) * 0x100000001b3llu;
+	}
+	return h;
+}
+
+/**
+ * Return true iff entry e has the same key as rd1/rd2.
+ */
+bool ReadResultCache::matches(
+	const ReadResultEntry& e,
+	const Read& rd1,
+	const Read* rd2,
+	const bool* filt,
+	uint32_t seed)
+{
+	if(e.seed != seed ||
+	   e.paired != (rd2 != NULL) ||
+	   e.filt[0] != filt[0] ||
+	   e.filt[1] != filt[1] ||
+	   e.trim1[0] != rd1.trimmed5 ||
+	   e.trim1[1] != rd1.trimmed3)
+	{
+		return false;
+	}
+	if(!Read::same(rd1.patFw, rd1.qual, e.seq1, e.qual1, true)) {
+		return false;
+	}
+	if(rd2 != NULL) {
+		if(e.trim2[0] != rd2->trimmed5 || e.trim2[1] != rd2->trimmed3) {
+			return false;
+		}
+		if(!Read::same(rd2->patFw, rd2->qual, e.seq2, e.qual2, true)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Return the entry for a read or pair with the same key as rd1/rd2 and the
+ * same filter outcome, or NULL if there isn't one.
+ */
+const ReadResultEntry* ReadResultCache::lookup(
+	const Read& rd1,
+	const Read* rd2,
+	const bool* filt,
+	uint32_t seed)
+{
+	assert(enabled());
+	nlookup_++;
+	uint64_t h = hashKey(rd1, rd2, seed);
+	size_t mask = slots_.size() - 1;
+	for(size_t i = (size_t)(h & mask); slots_[i] != 0; i = (i + 1) & mask) {
+		const ReadResultEntry& e = entries_[slots_[i] - 1];
+		if(e.hash == h && matches(e, rd1, rd2, filt, seed)) {
+			nhit_++;
+			return &e;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Add the key for rd1/rd2 to the cache, clearing the cache first if it's
+ * full, and return the new entry for the caller to fill in.
+ */
+ReadResultEntry& ReadResultCache::insert(
+	const Read& rd1,
+	const Read* rd2,
+	const bool* filt,
+	uint32_t seed)
+{
+	assert(enabled());
+	if(entries_.size() >= max_) {
+		clear();
+	}
+	uint64_t h = hashKey(rd1, rd2, seed);
+	entries_.expand();
+	ReadResultEntry& e = entries_.back();
+	e.reset();
+	e.hash = h;
+	e.seed = seed;
+	e.paired = (rd2 != NULL);
+	e.filt[0] = filt[0];
+	e.filt[1] = filt[1];
+	e.seq1 = rd1.patFw;
+	e.qual1 = rd1.qual;
+	e.trim1[0] = rd1.trimmed5;
+	e.trim1[1] = rd1.trimmed3;
+	if(rd2 != NULL) {
+		e.seq2 = rd2->patFw;
+		e.qual2 = rd2->qual;
+		e.trim2[0] = rd2->trimmed5;
+		e.trim2[1] = rd2->trimmed3;
+	}
+	size_t mask = slots_.size() - 1;
+	size_t i = (size_t)(h & mask);
+	while(slots_[i] != 0) {
+		i = (i + 1) & mask;
+	}
+	slots_[i] = (uint32_t)entries_.size();
+	return e;
+}
@@ -0,0 +1,196 @@
+/*
+ * Copyright 2011, Ben Langmead <langmea@cs.jhu.edu>
+ *
+ * This file is part of Bowtie 2.
+ *
+ * Bowtie 2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bowtie 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bowtie 2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * read_cache.h
+ *
+ * A cache of final alignment results keyed on read sequence.  Where
+ * AlignmentCache remembers the BW ranges for seed sequences, the
+ * ReadResultCache remembers everything the aligner reported for a whole
+ * read or pair, so that a later read or pair with exactly the same
+ * sequence can skip seed search, seed extension and mate finding and
+ * simply replay the reported alignments into its AlnSinkWrap.
+ *
+ * The search draws on the read's pseudo-random generator, so the key also
+ * includes the seed the generator was initialized with, along with the
+ * sequences and qualities.  With the cache on, that seed is derived from
+ * the sequences and qualities alone, so duplicates under different names
+ * share an entry.  A hit thus replays exactly what searching again would
+ * have reported, and output doesn't depend on which reads share a
+ * thread's cache.  Everything downstream of the replay (selection of
+ * alignments to report, MAPQ, the SAM record) is done afresh for the new
+ * read, using the new read's name.
+ *
+ * Each search thread owns its own cache, so no locking is needed.  When a
+ * cache reaches its entry limit it is cleared and starts filling again.
+ */
+
+#ifndef READ_CACHE_H_
+#define READ_CACHE_H_
+
+#include "ds.h"
+#include "mem_ids.h"
+#include "read.h"
+#include "random_source.h"
+#include "aln_sink.h"
+
+/**
+ * Everything remembered about one read or pair.
+ */
+struct ReadResultEntry {
+
+	ReadResultEntry() { reset(); }
+
+	void reset() {
+		hash = 0;
+		seed = 0;
+		paired = false;
+		seq1.clear(); qual1.clear();
+		seq2.clear(); qual2.clear();
+		trim1[0] = trim1[1] = trim2[0] = trim2[1] = 0;
+		filt[0] = filt[1] = false;
+		exhaust[0] = exhaust[1] = false;
+		alns.clear();
+		prm.reset();
+	}
+
+	/**
+	 * Set the fields of 'prm' that describe the read rather than the work
+	 * done to align it (they go into the Xs:i and ZT:Z SAM fields) to
+	 * those from the original search.  Work counters are left alone.
+	 */
+	void restoreMetrics(PerReadMetrics& prm) const {
+		prm.bestLtMinscMate1 = this->prm.bestLtMinscMate1;
+		prm.bestLtMinscMate2 = this->prm.bestLtMinscMate2;
+		prm.seedPctUnique    = this->prm.seedPctUnique;
+		prm.seedPctRep       = this->prm.seedPctRep;
+		prm.seedHitAvg       = this->prm.seedHitAvg;
+		prm.seedsPerNuc      = this->prm.seedsPerNuc;
+	}
+
+	uint64_t     hash;       // hash of key fields
+	uint32_t     seed;       // seed of the search's pseudo-random generator
+	bool         paired;     // true iff entry is for a pair
+	BTDnaString  seq1;       // mate 1 sequence
+	BTString     qual1;      // mate 1 qualities
+	BTDnaString  seq2;       // mate 2 sequence
+	BTString     qual2;      // mate 2 qualities
+	int          trim1[2];   // 5'/3' bases trimmed from mate 1
+	int          trim2[2];   // 5'/3' bases trimmed from mate 2
+	bool         filt[2];    // whether each mate passed the filters
+	bool         exhaust[2]; // exhausted seed hits for each mate?
+	RandomSource rnd;        // pseudo-random generator after the search
+	ReportedAlns alns;       // alignments reported, in order
+	PerReadMetrics prm;      // per-read metrics from the original search
+};
+
+/**
+ * Per-thread cache of final results for reads and pairs, keyed on
+ * sequence, qualities and pseudo-random seed.
+ */
+class ReadResultCache {
+
+public:
+
+	/**
+	 * Create a cache holding up to maxEntries reads/pairs; 0 disables the
+	 * cache.
+	 */
+	explicit ReadResultCache(size_t maxEntries) :
+		max_(maxEntries),
+		entries_(RES_CAT),
+		slots_(RES_CAT),
+		nlookup_(0),
+		nhit_(0)
+	{
+		if(max_ > 0) {
+			size_t nslots = 64;
+			while(nslots < max_ * 2) nslots <<= 1;
+			slots_.resize(nslots);
+			slots_.fill(0);
+		}
+	}
+
+	/**
+	 * Return true iff the cache is turned on.
+	 */
+	bool enabled() const { return max_ > 0; }
+
+	/**
+	 * Return the entry for a read or pair with the same key as rd1/rd2,
+	 * the same filter outcome and the same pseudo-random seed, or NULL if
+	 * there isn't one.  rd2 is NULL for an unpaired read.
+	 */
+	const ReadResultEntry* lookup(
+		const Read& rd1,
+		const Read* rd2,
+		const bool* filt,
+		uint32_t seed);
+
+	/**
+	 * Add the results for rd1/rd2 to the cache, clearing it first if it's
+	 * full.  Returns the new entry, whose alignments, exhaust flags,
+	 * generator state and per-read metrics the caller fills in.
+	 */
+	ReadResultEntry& insert(
+		const Read& rd1,
+		const Read* rd2,
+		const bool* filt,
+		uint32_t seed);
+
+	/**
+	 * Forget all entries.
+	 */
+	void clear() {
+		entries_.clear();
+		slots_.fill(0);
+	}
+
+	size_t size()    const { return entries_.size(); }
+	size_t lookups() const { return nlookup_; }
+	size_t hits()    const { return nhit_; }
+
+protected:
+
+	/**
+	 * Hash the key fields of rd1/rd2.
+	 */
+	static uint64_t hashKey(
+		const Read& rd1,
+		const Read* rd2,
+		uint32_t seed);
+
+	/**
+	 * Return true iff entry e has the same key as rd1/rd2.
+	 */
+	static bool matches(
+		const ReadResultEntry& e,
+		const Read& rd1,
+		const Read* rd2,
+		const bool* filt,
+		uint32_t seed);
+
+	size_t                 max_;     // max # entries; 0 = disabled
+	EList<ReadResultEntry> entries_; // entries, in insertion order
+	EList<uint32_t>        slots_;   // open-addressed table: entry idx + 1
+	size_t                 nlookup_; // # calls to lookup()
+	size_t                 nhit_;    // # lookups that found an entry
+};
+
+#endif /*ndef READ_CACHE_H_*/
@@ -168,6 +168,15 @@ public:
 		return off_ >= inbegin && off_ + len <= inend;
 	}
 	
+	/**
+	 * Return a hash of this Coord for use with EHashSet.
+	 */
+	inline uint64_t hash() const {
+		uint64_t h = (uint64_t)off_;
+		h = h * 0x100000001B3llu + (uint64_t)ref_;
+		return (h << 1) | (orient_ == 1 ? 1 : 0);
+	}
+
 	inline TRefId  ref()    const { return ref_; }
 	inline TRefOff off()    const { return off_; }
 	inline int     orient() const { return orient_; }
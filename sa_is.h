@@ -0,0 +1,220 @@
+/*
+ * Copyright 2011, Ben Langmead <langmea@cs.jhu.edu>
+ *
+ * This file is part of Bowtie 2.
+ *
+ * Bowtie 2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bowtie 2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bowtie 2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * sa_is.h
+ *
+ * Linear-time suffix array construction by induced sorting (SA-IS), after
+ * Nong, Zhang and Chan, "Two Efficient Algorithms for Linear Time Suffix
+ * Array Construction".  The reduced problem at each level of recursion is
+ * stored in the SA array itself, so beyond the SA the only extra memory is
+ * a bit per text character for the S/L types and one bucket array per
+ * level.
+ *
+ * The input must end with a unique, smallest sentinel character (0).
+ */
+
+#ifndef SA_IS_H_
+#define SA_IS_H_
+
+#include <stdint.h>
+#include "assert_helpers.h"
+#include "btypes.h"
+#include "ds.h"
+#include "mem_ids.h"
+
+/**
+ * S/L types of text positions, one bit per position; set = S-type.
+ */
+class SaisTypes {
+public:
+	explicit SaisTypes(TIndexOffU n) : bits_((n >> 3) + 1, EBWTB_CAT) { }
+
+	bool get(TIndexOffU i) const {
+		return (bits_[i >> 3] & (1 << (i & 7))) != 0;
+	}
+
+	void set(TIndexOffU i, bool s) {
+		if(s) bits_[i >> 3] |=  (uint8_t)(1 << (i & 7));
+		else  bits_[i >> 3] &= (uint8_t)~(1 << (i & 7));
+	}
+
+	/// Return true iff position i is a leftmost S-type position
+	bool isLMS(TIndexOffU i) const {
+		return i > 0 && i != OFF_MASK && get(i) && !get(i-1);
+	}
+
+private:
+	AutoArray<uint8_t> bits_;
+};
+
+/**
+ * Set bkt[c] to the start (or, if end is true, one past the end) of
+ * character c's bucket.
+ */
+template<typename TChr>
+static void saisBuckets(
+	const TChr* s,
+	TIndexOffU n,
+	TIndexOffU K,
+	AutoArray<TIndexOffU>& bkt,
+	bool end)
+{
+	for(TIndexOffU c = 0; c <= K; c++) bkt[c] = 0;
+	for(TIndexOffU i = 0; i < n; i++) bkt[s[i]]++;
+	TIndexOffU sum = 0;
+	for(TIndexOffU c = 0; c <= K; c++) {
+		sum += bkt[c];
+		bkt[c] = end ? sum : sum - bkt[c];
+	}
+}
+
+/**
+ * Induce the order of L-type suffixes from the sorted suffixes already
+ * in SA, scanning left to right.
+ */
+template<typename TChr>
+static void saisInduceL(
+	const TChr* s,
+	TIndexOffU* SA,
+	TIndexOffU n,
+	TIndexOffU K,
+	const SaisTypes& t,
+	AutoArray<TIndexOffU>& bkt)
+{
+	saisBuckets(s, n, K, bkt, false);
+	for(TIndexOffU i = 0; i < n; i++) {
+		if(SA[i] == OFF_MASK || SA[i] == 0) continue;
+		TIndexOffU j = SA[i] - 1;
+		if(!t.get(j)) SA[bkt[s[j]]++] = j;
+	}
+}
+
+/**
+ * Induce the order of S-type suffixes from the sorted L-type suffixes,
+ * scanning right to left.
+ */
+template<typename TChr>
+static void saisInduceS(
+	const TChr* s,
+	TIndexOffU* SA,
+	TIndexOffU n,
+	TIndexOffU K,
+	const SaisTypes& t,
+	AutoArray<TIndexOffU>& bkt)
+{
+	saisBuckets(s, n, K, bkt, true);
+	for(TIndexOffU i = n; i-- > 0;) {
+		if(SA[i] == OFF_MASK || SA[i] == 0) continue;
+		TIndexOffU j = SA[i] - 1;
+		if(t.get(j)) SA[--bkt[s[j]]] = j;
+	}
+}
+
+/**
+ * Fill SA[0..n) with the suffix array of s[0..n), whose characters are in
+ * [0, K] and whose last character is a unique 0.  Throws bad_alloc if the
+ * type bits or bucket arrays don't fit.
+ */
+template<typename TChr>
+static void saisSort(
+	const TChr* s,
+	TIndexOffU* SA,
+	TIndexOffU n,
+	TIndexOffU K)
+{
+	assert_gt(n, 0);
+	assert_eq(0, s[n-1]);
+	if(n == 1) {
+		SA[0] = 0;
+		return;
+	}
+	// Classify positions as S-type or L-type
+	SaisTypes t(n);
+	t.set(n-1, true);
+	t.set(n-2, false);
+	for(TIndexOffU i = n-2; i-- > 0;) {
+		t.set(i, s[i] < s[i+1] || (s[i] == s[i+1] && t.get(i+1)));
+	}
+	// Stage 1: sort the LMS substrings by inducing from their bucket ends
+	AutoArray<TIndexOffU> bkt(K+1, EBWTB_CAT);
+	saisBuckets(s, n, K, bkt, true);
+	for(TIndexOffU i = 0; i < n; i++) SA[i] = OFF_MASK;
+	for(TIndexOffU i = 1; i < n; i++) {
+		if(t.isLMS(i)) SA[--bkt[s[i]]] = i;
+	}
+	saisInduceL(s, SA, n, K, t, bkt);
+	saisInduceS(s, SA, n, K, t, bkt);
+	// Compact the sorted LMS substrings into the first n1 slots
+	TIndexOffU n1 = 0;
+	for(TIndexOffU i = 0; i < n; i++) {
+		if(t.isLMS(SA[i])) SA[n1++] = SA[i];
+	}
+	assert_leq(n1, n/2);
+	// Name the LMS substrings; equal substrings get equal names.  No two
+	// LMS positions are adjacent, so pos/2 is a collision-free slot.
+	for(TIndexOffU i = n1; i < n; i++) SA[i] = OFF_MASK;
+	TIndexOffU name = 0, prev = OFF_MASK;
+	for(TIndexOffU i = 0; i < n1; i++) {
+		TIndexOffU pos = SA[i];
+		bool diff = false;
+		for(TIndexOffU d = 0; d < n; d++) {
+			if(prev == OFF_MASK ||
+			   s[pos+d] != s[prev+d] ||
+			   t.get(pos+d) != t.get(prev+d))
+			{
+				diff = true;
+				break;
+			} else if(d > 0 && (t.isLMS(pos+d) || t.isLMS(prev+d))) {
+				break;
+			}
+		}
+		if(diff) {
+			name++;
+			prev = pos;
+		}
+		SA[n1 + (pos >> 1)] = name - 1;
+	}
+	for(TIndexOffU i = n, j = n; i-- > n1;) {
+		if(SA[i] != OFF_MASK) SA[--j] = SA[i];
+	}
+	// Stage 2: sort the reduced string, recursing if names aren't unique
+	TIndexOffU *SA1 = SA, *s1 = SA + n - n1;
+	if(name < n1) {
+		saisSort<TIndexOffU>(s1, SA1, n1, name - 1);
+	} else {
+		for(TIndexOffU i = 0; i < n1; i++) SA1[s1[i]] = i;
+	}
+	// Stage 3: induce the full SA from the sorted LMS suffixes
+	saisBuckets(s, n, K, bkt, true);
+	for(TIndexOffU i = 1, j = 0; i < n; i++) {
+		if(t.isLMS(i)) s1[j++] = i;
+	}
+	for(TIndexOffU i = 0; i < n1; i++) SA1[i] = s1[SA1[i]];
+	for(TIndexOffU i = n1; i < n; i++) SA[i] = OFF_MASK;
+	for(TIndexOffU i = n1; i-- > 0;) {
+		TIndexOffU j = SA[i];
+		SA[i] = OFF_MASK;
+		SA[--bkt[s[j]]] = j;
+	}
+	saisInduceL(s, SA, n, K, t, bkt);
+	saisInduceS(s, SA, n, K, t, bkt);
+}
+
+#endif /*ndef SA_IS_H_*/
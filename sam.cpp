@@ -45,7 +45,7 @@ void SamConfig::printRefName(
  * Print a reference name given a reference index.
  */
 void SamConfig::printRefNameFromIndex(BTString& o, size_t i) const {
-	printRefName(o, refnames_[i]);
+	o.append(refnames_[i].c_str(), refnameLens_[i]);
 }
 
 /**
@@ -153,10 +153,9 @@ void SamConfig::printAlignedOptFlags(
 	}
 	if(print_as_) {
 		// AS:i: Alignment score generated by aligner
-		itoa10<TAlScore>(res.score().score(), buf);
 		WRITE_SEP();
 		o.append("AS:i:");
-		o.append(buf);
+		printNum<TAlScore>(o, res.score().score());
 	}
 	if(print_xs_) {
 		// XS:i: Suboptimal alignment score
@@ -167,18 +166,16 @@ void SamConfig::printAlignedOptFlags(
 			sco = summ.secbest(rd.mate < 2);
 		}
 		if(sco.valid()) {
-			itoa10<TAlScore>(sco.score(), buf);
 			WRITE_SEP();
 			o.append("XS:i:");
-			o.append(buf);
+			printNum<TAlScore>(o, sco.score());
 		}
 	}
 	if(print_xn_) {
 		// XN:i: Number of ambiguous bases in the referenece
-		itoa10<size_t>(res.refNs(), buf);
 		WRITE_SEP();
 		o.append("XN:i:");
-		o.append(buf);
+		printNum<size_t>(o, res.refNs());
 	}
 	if(print_x0_) {
 		// X0:i: Number of best hits
@@ -216,31 +213,27 @@ void SamConfig::printAlignedOptFlags(
 	}
 	if(print_xm_) {
 		// XM:i: Number of mismatches in the alignment
-		itoa10<size_t>(num_mm, buf);
 		WRITE_SEP();
 		o.append("XM:i:");
-		o.append(buf);
+		printNum<size_t>(o, num_mm);
 	}
 	if(print_xo_) {
 		// XO:i: Number of gap opens
-		itoa10<size_t>(num_go, buf);
 		WRITE_SEP();
 		o.append("XO:i:");
-		o.append(buf);
+		printNum<size_t>(o, num_go);
 	}
 	if(print_xg_) {
 		// XG:i: Number of gap extensions (incl. opens)
-		itoa10<size_t>(num_gx, buf);
 		WRITE_SEP();
 		o.append("XG:i:");
-		o.append(buf);
+		printNum<size_t>(o, num_gx);
 	}
 	if(print_nm_) {
 		// NM:i: Edit dist. to the ref, Ns count, clipping doesn't
-		itoa10<size_t>(res.ned().size(), buf);
 		WRITE_SEP();
 		o.append("NM:i:");
-		o.append(buf);
+		printNum<size_t>(o, res.ned().size());
 	}
 	if(print_md_) {
 		// MD:Z: String for mms. [0-9]+(([A-Z]|\^[A-Z]+)[0-9]+)*2
@@ -254,38 +247,33 @@ void SamConfig::printAlignedOptFlags(
 	if(print_ys_ && summ.paired()) {
 		// YS:i: Alignment score of opposite mate
 		assert(res.oscore().valid());
-		itoa10<TAlScore>(res.oscore().score(), buf);
 		WRITE_SEP();
 		o.append("YS:i:");
-		o.append(buf);
+		printNum<TAlScore>(o, res.oscore().score());
 	}
 	if(print_yn_) {
 		// YN:i: Minimum valid score for this mate
 		TAlScore mn = sc.scoreMin.f<TAlScore>(rd.length());
-		itoa10<TAlScore>(mn, buf);
 		WRITE_SEP();
 		o.append("YN:i:");
-		o.append(buf);
+		printNum<TAlScore>(o, mn);
 		// Yn:i: Perfect score for this mate
 		TAlScore pe = sc.perfectScore(rd.length());
-		itoa10<TAlScore>(pe, buf);
 		WRITE_SEP();
 		o.append("Yn:i:");
-		o.append(buf);
+		printNum<TAlScore>(o, pe);
 		if(summ.paired()) {
 			assert(rdo != NULL);
 			// ZN:i: Minimum valid score for opposite mate
 			TAlScore mn = sc.scoreMin.f<TAlScore>(rdo->length());
-			itoa10<TAlScore>(mn, buf);
 			WRITE_SEP();
 			o.append("ZN:i:");
-			o.append(buf);
+			printNum<TAlScore>(o, mn);
 			// Zn:i: Perfect score for opposite mate
 			TAlScore pe = sc.perfectScore(rdo->length());
-			itoa10<TAlScore>(pe, buf);
 			WRITE_SEP();
 			o.append("Zn:i:");
-			o.append(buf);
+			printNum<TAlScore>(o, pe);
 		}
 	}
 	if(print_xss_) {
@@ -296,28 +284,25 @@ void SamConfig::printAlignedOptFlags(
 		}
 		TAlScore bst = one ? prm.bestLtMinscMate1 : prm.bestLtMinscMate2;
 		if(bst > std::numeric_limits<TAlScore>::min()) {
-			itoa10<TAlScore>(bst, buf);
 			WRITE_SEP();
 			o.append("Xs:i:");
-			o.append(buf);
+			printNum<TAlScore>(o, bst);
 		}
 		if(flags.partOfPair()) {
 			// Ys:i: Best invalid alignment score of opposite mate
 			bst = one ? prm.bestLtMinscMate2 : prm.bestLtMinscMate1;
 			if(bst > std::numeric_limits<TAlScore>::min()) {
-				itoa10<TAlScore>(bst, buf);
 				WRITE_SEP();
 				o.append("Ys:i:");
-				o.append(buf);
+				printNum<TAlScore>(o, bst);
 			}
 		}
 	}
 	if(print_zs_) {
 		// ZS:i: Pseudo-random seed for read
-		itoa10<uint32_t>(rd.seed, buf);
 		WRITE_SEP();
 		o.append("ZS:i:");
-		o.append(buf);
+		printNum<uint32_t>(o, rd.seed);
 	}
 	if(print_yt_) {
 		// YT:Z: String representing alignment type
@@ -387,7 +372,7 @@ void SamConfig::printAlignedOptFlags(
 	}
 	if(!rgs_.empty()) {
 		WRITE_SEP();
-		o.append(rgs_.c_str());
+		o.append(rgs_.c_str(), rgs_.length());
 	}
 	if(print_xt_) {
 		// XT:i: Timing
@@ -555,23 +540,20 @@ void SamConfig::printEmptyOptFlags(
 	if(print_yn_) {
 		// YN:i: Minimum valid score for this mate
 		TAlScore mn = sc.scoreMin.f<TAlScore>(rd.length());
-		itoa10<TAlScore>(mn, buf);
 		WRITE_SEP();
 		o.append("YN:i:");
-		o.append(buf);
+		printNum<TAlScore>(o, mn);
 		// Yn:i: Perfect score for this mate
 		TAlScore pe = sc.perfectScore(rd.length());
-		itoa10<TAlScore>(pe, buf);
 		WRITE_SEP();
 		o.append("Yn:i:");
-		o.append(buf);
+		printNum<TAlScore>(o, pe);
 	}
 	if(print_zs_) {
 		// ZS:i: Pseudo-random seed for read
-		itoa10<uint32_t>(rd.seed, buf);
 		WRITE_SEP();
 		o.append("ZS:i:");
-		o.append(buf);
+		printNum<uint32_t>(o, rd.seed);
 	}
 	if(print_yt_) {
 		// YT:Z: String representing alignment type
@@ -594,7 +576,7 @@ void SamConfig::printEmptyOptFlags(
 	}
 	if(!rgs_.empty()) {
 		WRITE_SEP();
-		o.append(rgs_.c_str());
+		o.append(rgs_.c_str(), rgs_.length());
 	}
 	if(print_xt_) {
 		// XT:i: Timing
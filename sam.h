@@ -156,6 +156,14 @@ public:
 		print_zt_(print_zt)  // extra features for MAPQ estimation
 	{
 		assert_eq(refnames_.size(), reflens_.size());
+		// Precompute the printable length of each reference name (up to
+		// the first whitespace) so RNAME/RNEXT are a single append
+		for(size_t i = 0; i < refnames_.size(); i++) {
+			const std::string& name = refnames_[i];
+			size_t len = 0;
+			while(len < name.length() && !isspace(name[len])) len++;
+			refnameLens_.push_back(len);
+		}
 	}
 
 	/**
@@ -235,11 +243,39 @@ public:
 		if(truncQname_ && namelen > 255) {
 			namelen = 255;
 		}
-		for(size_t i = 0; i < namelen; i++) {
-			if(truncQname_ && isspace(name[i])) {
-				return;
+		if(truncQname_) {
+			for(size_t i = 0; i < namelen; i++) {
+				if(isspace(name[i])) {
+					namelen = i;
+					break;
+				}
 			}
-			o.append(name[i]);
+		}
+		o.append(name.buf(), namelen);
+	}
+
+	/**
+	 * Append the decimal representation of v.
+	 */
+	template<typename T>
+	static void printNum(BTString& o, const T& v) {
+		char buf[24];
+		char *end = itoa10<T>(v, buf);
+		o.append(buf, (size_t)(end - buf));
+	}
+
+	/**
+	 * Append a nucleotide sequence, decoding it straight into the output
+	 * buffer rather than through the string's print buffer.
+	 */
+	static void printSeq(BTString& o, const BTDnaString& seq) {
+		const size_t off = o.length(), len = seq.length();
+		o.resize(off + len);
+		char *w = o.wbuf() + off;
+		const char *s = seq.buf();
+		for(size_t i = 0; i < len; i++) {
+			assert_range(0, 4, (int)s[i]);
+			w[i] = "ACGTN"[(int)s[i]];
 		}
 	}
 
@@ -338,6 +374,7 @@ protected:
 	std::string rgs_;   // Read-group string to add to all records
 	const StrList& refnames_; // reference sequence names
 	const LenList& reflens_;  // reference sequence lengths
+	LenList refnameLens_;     // length of each name's SAM-printable prefix
 	
 	// Which alignment flags to print?
 
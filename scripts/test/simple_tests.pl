@@ -4817,4 +4817,194 @@ foreach my $large_idx (undef,1) {
 		}
     }
 }
+
+##
+# Options that only change how bowtie2-build lays out the index, or how
+# bowtie2 gets to its alignments, must not change the alignments.  Align
+# the same reads with and without each one and check the SAM output
+# (less the @PG line) is the same.
+#
+
+##
+# Write a list of [ name, sequence ] pairs to a FASTA file.
+#
+sub writeNamedFasta($$) {
+	my ($l, $fa) = @_;
+	open(FA, ">$fa") || die "Could not open $fa for writing";
+	for(@$l) { print FA ">".$_->[0]."\n".$_->[1]."\n"; }
+	close(FA);
+}
+
+##
+# Run a bowtie2-build command; die if it fails.
+#
+sub runBuild($) {
+	my $cmd = shift;
+	print "$cmd\n";
+	system($cmd);
+	($? == 0) || die "Bad exitlevel from bowtie2-build: $?";
+}
+
+##
+# Run bowtie2 and return its SAM output, less the @PG line, as a list of
+# lines.
+#
+sub samLines($) {
+	my $cmd = shift;
+	print "$cmd\n";
+	my @ls = ();
+	open(BT, "$cmd |") || die "Could not open pipe '$cmd |'";
+	while(<BT>) {
+		push @ls, $_ unless substr($_, 0, 3) eq "\@PG";
+	}
+	close(BT);
+	($? == 0) || die "bowtie2 aborted with exitlevel $?\n";
+	return \@ls;
+}
+
+##
+# Return the named field of the last line of a --met-stderr metrics file.
+#
+sub metricsField($$) {
+	my ($fn, $name) = @_;
+	my ($hd, $last) = (undef, undef);
+	open(MET, $fn) || die "Could not open $fn";
+	while(<MET>) {
+		chomp;
+		if(/^Time\t/) { $hd = $_; } else { $last = $_; }
+	}
+	close(MET);
+	defined($hd) && defined($last) || die "No metrics in $fn";
+	my @hd = split(/\t/, $hd);
+	my @vl = split(/\t/, $last);
+	for(0..$#hd) { return $vl[$_] if $hd[$_] eq $name; }
+	die "No $name field in $fn";
+}
+
+##
+# Die with the first differing line unless two SAM outputs are the same.
+# If $loose is set, records need only agree on the alignment reported:
+# not on MAPQ or XS:i, which depend on the second-best alignment found.
+# A read with several equally good alignments (MAPQ 0 or 1) may then be
+# placed on any of them.
+#
+sub sameSam($$$$) {
+	my ($name, $ex, $ls, $loose) = @_;
+	for(my $i = 0; $i < max(scalar(@$ex), scalar(@$ls)); $i++) {
+		my $e = $ex->[$i]; $e = "(none)\n" unless defined($e);
+		my $l = $ls->[$i]; $l = "(none)\n" unless defined($l);
+		if($loose && substr($e, 0, 1) ne "@") {
+			my @ef = split(/\t/, $e);
+			my @lf = split(/\t/, $l);
+			my ($eas) = grep { /^AS:i:/ } @ef;
+			my ($las) = grep { /^AS:i:/ } @lf;
+			my @cmp = ($ef[4] > 1 ? (0, 1, 2, 3, 5, 9, 10) : (0, 1, 5, 9, 10));
+			$e = join("\t", @ef[@cmp], $eas || "")."\n";
+			$l = join("\t", @lf[@cmp], $las || "")."\n";
+		}
+		$e eq $l || die "$name: line $i differs from what was expected:\n  expected: $e  got:      $l";
+	}
+	print "$name: as expected (".scalar(@$ls)." lines)\n";
+}
+
+{
+	srand(1);
+	my $randSeq = sub {
+		return join("", map { substr("ACGT", int(rand(4)), 1) } 1..$_[0]);
+	};
+	# A repeat with enough copies to get hot seeds and large ftab buckets
+	my $rep = $randSeq->(150);
+	my @refa = (
+		[ "a0", $randSeq->(4000) ],
+		[ "a1", join("", map { $randSeq->(200).$rep } 1..12).$randSeq->(200) ]);
+	my @refb = ( [ "b0", $randSeq->(4000) ] );
+	writeNamedFasta(\@refa, ".simple_tests.a.fa");
+	writeNamedFasta(\@refb, ".simple_tests.b.fa");
+	writeNamedFasta([ @refa, @refb ], ".simple_tests.ab.fa");
+	# Reads with a few mismatches from both strands of every sequence, and
+	# at the end, under names of their own, duplicates of some of them for
+	# --dedup-cache
+	my @reads = ();
+	my @dups = ();
+	for my $ref (@refa, @refb) {
+		my $s = $ref->[1];
+		for(1..40) {
+			my $rd = substr($s, int(rand(length($s) - 100)), 100);
+			for(1..int(rand(4))) {
+				substr($rd, int(rand(100)), 1) = substr("ACGT", int(rand(4)), 1);
+			}
+			$rd = DNA::revcomp($rd) if rand() < 0.5;
+			push @reads, $rd;
+			push @dups, $rd if rand() < 0.2;
+		}
+	}
+	# Reads from inside the repeat, where every exact match of up to 32 bp
+	# has 12 occurrences
+	for(1..5) {
+		my $rd = substr($rep, int(rand(length($rep) - 100)), 100);
+		$rd = DNA::revcomp($rd) if rand() < 0.5;
+		push @reads, $rd;
+	}
+	push @reads, @dups;
+	writeReads(\@reads, undef, undef, undef, undef, undef, undef,
+	           ".simple_tests.eq.fq", ".simple_tests.eq2.fq");
+	my $rdarg = "-U .simple_tests.eq.fq";
+	foreach my $large_idx (undef,1) {
+		my $idx_type = ($large_idx ? "--large-index" : "");
+		my $ext = ($large_idx ? "bt2l" : "bt2");
+		my $build = "$bowtie2_build $idx_type --quiet";
+		my $bt2 = "$bowtie2 $idx_type --quiet";
+		runBuild("$build .simple_tests.ab.fa .simple_tests.ab");
+		my $ex = samLines("$bt2 -x .simple_tests.ab $rdarg");
+		# Appending b to an index of a
+		runBuild("$build .simple_tests.a.fa .simple_tests.app");
+		runBuild("$build --append .simple_tests.b.fa .simple_tests.app");
+		sameSam("--append", $ex, samLines("$bt2 -x .simple_tests.app $rdarg"), 0);
+		# a and b as an index set
+		runBuild("$build .simple_tests.a.fa .simple_tests.a");
+		runBuild("$build .simple_tests.b.fa .simple_tests.b");
+		my $exa = samLines("$bt2 -x .simple_tests.a $rdarg");
+		sameSam("-x a,b", $ex, samLines("$bt2 -x .simple_tests.a,.simple_tests.b $rdarg"), 0);
+		# Aligner options
+		sameSam("--sort-window", $ex, samLines("$bt2 --sort-window 32 -x .simple_tests.ab $rdarg"), 0);
+		# --dedup-cache seeds the search from the sequence and qualities
+		# only, so repetitive reads can go elsewhere than by default.  With
+		# a 1-read cache nothing is reused; with a big one every duplicate
+		# is, and the output must be the same either way
+		my $dc = samLines("$bt2 --dedup-cache 1 --met-stderr -x .simple_tests.ab $rdarg 2>.simple_tests.met");
+		metricsField(".simple_tests.met", "SameRead") == 0 || die "--dedup-cache 1 reused results";
+		sameSam("--dedup-cache 1", $ex, $dc, 1);
+		sameSam("--dedup-cache 1000", $dc,
+		        samLines("$bt2 --dedup-cache 1000 --met-stderr -x .simple_tests.ab $rdarg 2>.simple_tests.met"), 0);
+		my $nhit = metricsField(".simple_tests.met", "SameRead");
+		$nhit == scalar(@dups) || die "--dedup-cache 1000 reused results for $nhit reads, expected ".scalar(@dups);
+		# SMEM seeds can miss a second-best alignment the default seeds
+		# find
+		sameSam("--smem-seeds", $ex, samLines("$bt2 --smem-seeds 500 -x .simple_tests.ab $rdarg"), 1);
+		# With fewer than the 12 copies of the repeat allowed, reads in it
+		# must still align
+		sameSam("--smem-seeds 8", $ex, samLines("$bt2 --smem-seeds 8 -x .simple_tests.ab $rdarg"), 1);
+		# Sidecar tables
+		runBuild("$build --hot-seeds 16 --hot-seed-min 8 --ftab2-chars 2 --ftab2-min 8 " .
+		         ".simple_tests.ab.fa .simple_tests.ab");
+		for(".hot.$ext", ".ftab2.$ext", ".rev.ftab2.$ext") {
+			-f ".simple_tests.ab$_" || die "bowtie2-build didn't write .simple_tests.ab$_";
+		}
+		sameSam("--hot-seeds --ftab2-chars", $ex, samLines("$bt2 -x .simple_tests.ab $rdarg"), 0);
+		sameSam("--no-hot-seeds", $ex, samLines("$bt2 --no-hot-seeds -x .simple_tests.ab $rdarg"), 0);
+		# Sidecars next to an index they weren't built from are ignored
+		for(".hot.$ext", ".ftab2.$ext", ".rev.ftab2.$ext") {
+			system("cp .simple_tests.ab$_ .simple_tests.a$_") == 0 || die;
+		}
+		sameSam("sidecars of another index", $exa, samLines("$bt2 -x .simple_tests.a $rdarg"), 0);
+		# Rebuilding over an index with sidecars, without the options,
+		# must remove them
+		runBuild("$build .simple_tests.ab.fa .simple_tests.ab");
+		for(".hot.$ext", ".ftab2.$ext", ".rev.ftab2.$ext") {
+			-e ".simple_tests.ab$_" && die "Rebuild left stale .simple_tests.ab$_ behind";
+		}
+		sameSam("rebuild without sidecars", $ex, samLines("$bt2 -x .simple_tests.ab $rdarg"), 0);
+	}
+}
+
 print "PASSED\n";
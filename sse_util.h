@@ -24,8 +24,83 @@
 #include "ds.h"
 #include "limit.h"
 #include <iostream>
+#include <algorithm>
 #include <emmintrin.h>
 
+/**
+ * Return a vector whose low nbytes bytes are all 1s and whose other bytes
+ * are all 0s, for masking off the padding lanes of a striped column.
+ */
+static inline __m128i sseLowBytesMask(size_t nbytes) {
+	static const uint8_t masks[32] = {
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+	assert_leq(nbytes, 16);
+	return _mm_loadu_si128(reinterpret_cast<const __m128i*>(masks + 16 - nbytes));
+}
+
+/**
+ * Element-wise max of unsigned 8-bit or signed 16-bit words; the third
+ * argument only selects the word type.
+ */
+static inline __m128i sseMaxWords(__m128i a, __m128i b, uint8_t) {
+	return _mm_max_epu8(a, b);
+}
+static inline __m128i sseMaxWords(__m128i a, __m128i b, int16_t) {
+	return _mm_max_epi16(a, b);
+}
+
+/**
+ * Return the largest score in rows [rlo, nrow) of a striped DP column of
+ * T words (uint8_t or int16_t), or lo if there are none.  Row r lives in
+ * word r / iter of vector pvH[(r % iter) * stride].  Words holding only
+ * rows in the range are reduced with SSE, masking off the others; the word
+ * holding row rlo and the word holding the last rows, which are only
+ * partly in the range, are checked cell by cell.  Used for the X-drop test
+ * of the end-to-end kernels.
+ */
+template<typename T>
+static inline int sseStripedColMax(
+	const __m128i* pvH,
+	size_t stride,
+	size_t iter,
+	size_t rlo,
+	size_t nrow,
+	int lo)
+{
+	const size_t wfirst = rlo / iter;  // word holding row rlo
+	const size_t nfull = nrow / iter;  // words wholly in the column
+	int colmax = lo;
+	if(wfirst + 1 < nfull) {
+		__m128i vcolmax = (sizeof(T) == 1) ?
+			_mm_set1_epi8((char)lo) : _mm_set1_epi16((short)lo);
+		for(size_t j = 0; j < iter; j++) {
+			vcolmax = sseMaxWords(vcolmax, pvH[j * stride], (T)0);
+		}
+		vcolmax = _mm_and_si128(vcolmax, _mm_andnot_si128(
+			sseLowBytesMask((wfirst + 1) * sizeof(T)),
+			sseLowBytesMask(nfull * sizeof(T))));
+		vcolmax = sseMaxWords(vcolmax, _mm_srli_si128(vcolmax, 8), (T)0);
+		vcolmax = sseMaxWords(vcolmax, _mm_srli_si128(vcolmax, 4), (T)0);
+		vcolmax = sseMaxWords(vcolmax, _mm_srli_si128(vcolmax, 2), (T)0);
+		if(sizeof(T) == 1) {
+			vcolmax = sseMaxWords(vcolmax, _mm_srli_si128(vcolmax, 1), (T)0);
+			colmax = _mm_extract_epi16(vcolmax, 0) & 0x00ff;
+		} else {
+			colmax = (int16_t)_mm_extract_epi16(vcolmax, 0);
+		}
+	}
+	size_t rhi = std::min<size_t>((wfirst + 1) * iter, nrow);
+	for(size_t r = rlo; r < rhi; r++) {
+		colmax = std::max<int>(colmax, ((const T*)(pvH + (r % iter) * stride))[r / iter]);
+	}
+	for(size_t r = std::max<size_t>(nfull * iter, rhi); r < nrow; r++) {
+		colmax = std::max<int>(colmax, ((const T*)(pvH + (r % iter) * stride))[r / iter]);
+	}
+	return colmax;
+}
+
 class EList_m128i {
 public:
 
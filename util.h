@@ -21,33 +21,58 @@
 #define UTIL_H_
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <limits>
 
 /**
- * C++ version char* style "itoa":
+ * C++ version char* style "itoa".  Digits are produced two at a time from
+ * a table, right to left into a scratch buffer, then copied to result.
+ * Returns a pointer to the terminating 0 written after the last digit, so
+ * callers can append result without a strlen.
  */
 template<typename T>
 char* itoa10(const T& value, char* result) {
-	// Check that base is valid
-	char* out = result;
-	T quotient = value;
-	if(std::numeric_limits<T>::is_signed) {
-		if(quotient <= 0) quotient = -quotient;
-	}
-	// Now write each digit from most to least significant
-	do {
-		*out = "0123456789"[quotient % 10];
-		++out;
-		quotient /= 10;
-	} while (quotient > 0);
-	// Only apply negative sign for base 10
+	static const char pairs[201] =
+		"00010203040506070809"
+		"10111213141516171819"
+		"20212223242526272829"
+		"30313233343536373839"
+		"40414243444546474849"
+		"50515253545556575859"
+		"60616263646566676869"
+		"70717273747576777879"
+		"80818283848586878889"
+		"90919293949596979899";
+	bool neg = false;
+	uint64_t quotient = (uint64_t)value;
 	if(std::numeric_limits<T>::is_signed) {
 		// Avoid compiler warning in cases where T is unsigned
-		if (value <= 0 && value != 0) *out++ = '-';
+		if(value <= 0 && value != 0) {
+			neg = true;
+			quotient = (uint64_t)0 - quotient;
+		}
+	}
+	char tmp[24];
+	char *p = tmp + sizeof(tmp);
+	while(quotient >= 100) {
+		const char *d = pairs + (quotient % 100) * 2;
+		quotient /= 100;
+		*--p = d[1];
+		*--p = d[0];
+	}
+	if(quotient >= 10) {
+		const char *d = pairs + quotient * 2;
+		*--p = d[1];
+		*--p = d[0];
+	} else {
+		*--p = (char)('0' + quotient);
 	}
-	reverse( result, out );
-	*out = 0; // terminator
-	return out;
+	if(neg) *--p = '-';
+	size_t len = (size_t)(tmp + sizeof(tmp) - p);
+	memcpy(result, p, len);
+	result[len] = 0; // terminator
+	return result + len;
 }
 
 #endif /*ndef UTIL_H_*/